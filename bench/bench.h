@@ -0,0 +1,87 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// =========================================
+// MICROBENCHMARK HELPER
+// - Chạy hàm theo lô: BENCH_SAMPLES mẫu, mỗi mẫu `batch` lần gọi, đo bằng CLOCK_MONOTONIC
+// - Kết quả mỗi case là 1 dòng JSON trên stdout (ns/op theo trung vị / p99 / min của các mẫu),
+//   so sánh 2 lần chạy bằng cách join theo "bench" + "case" + tham số
+// =========================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_SAMPLES 31
+#define BENCH_TARGET_NS 2000000     // Thời gian mục tiêu cho 1 mẫu (tự chọn batch)
+
+typedef void (*BenchFn)(void* arg);
+
+typedef struct {
+    uint64_t ops;           // Tổng số lần gọi đã đo
+    double p50_ns;          // ns / op
+    double p99_ns;
+    double min_ns;
+} BenchResult;
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Chức năng: Đo fn(arg)
+ * @param batch  Số lần gọi / mẫu, 0 = tự chọn để 1 mẫu ~BENCH_TARGET_NS
+ */
+static inline BenchResult bench_run(BenchFn fn, void* arg, uint64_t batch) {
+    BenchResult r = { 0, 0, 0, 0 };
+
+    // Làm nóng + ước lượng batch
+    if (batch == 0) {
+        batch = 1;
+        for (;;) {
+            uint64_t t0 = bench_now_ns();
+            for (uint64_t i = 0; i < batch; i++) fn(arg);
+            uint64_t dt = bench_now_ns() - t0;
+            if (dt >= BENCH_TARGET_NS / 4 || batch >= (1u << 24)) {
+                if (dt > 0) batch = batch * BENCH_TARGET_NS / dt;
+                if (batch == 0) batch = 1;
+                break;
+            }
+            batch *= 2;
+        }
+    }
+
+    double samples[BENCH_SAMPLES];
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        uint64_t t0 = bench_now_ns();
+        for (uint64_t i = 0; i < batch; i++) fn(arg);
+        samples[s] = (double)(bench_now_ns() - t0) / (double)batch;
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof(double), bench_cmp_double);
+
+    r.ops = batch * BENCH_SAMPLES;
+    r.min_ns = samples[0];
+    r.p50_ns = samples[BENCH_SAMPLES / 2];
+    r.p99_ns = samples[(int)(0.99 * (BENCH_SAMPLES - 1))];
+    return r;
+}
+
+// In phần chung của 1 dòng kết quả; caller in thêm tham số rồi gọi bench_print_end
+static inline void bench_print_begin(const char* bench, const char* name) {
+    printf("{\"bench\":\"%s\",\"case\":\"%s\"", bench, name);
+}
+
+static inline void bench_print_end(const BenchResult* r) {
+    printf(",\"ops\":%llu,\"ns_per_op\":%.1f,\"p99_ns\":%.1f,\"min_ns\":%.1f}\n",
+           (unsigned long long)r->ops, r->p50_ns, r->p99_ns, r->min_ns);
+    fflush(stdout);
+}
+
+#endif // BENCH_H
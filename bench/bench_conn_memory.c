@@ -0,0 +1,201 @@
+// Benchmark: bộ nhớ server (RSS) theo số kết nối đang mở nhưng rảnh
+//   Mở dần N kết nối tới server đang chạy, sau mỗi bước đọc VmRSS của tiến trình server
+//   trong /proc/<pid>/status => byte / kết nối = (RSS sau - RSS trước khi kết nối) / số kết nối
+//   -a K: K kết nối đầu REGISTER (mỗi lần chạy 1 prefix) + LOGIN => kết nối đã đăng nhập
+//         (LOGIN / REGISTER đi qua password pool nên K lớn thì chạy lâu)
+//   Kết nối tới 127.x: đổi địa chỉ nguồn 127.0.0.x mỗi CONN_PER_SOURCE kết nối (hết port tạm)
+//
+// Usage: bench_conn_memory [-H host] [-p port] [-n connections] [-a authenticated] [-s steps]
+//                          [-w settle_ms] [-P server_pid]
+//   Mặc định: 10000 kết nối, 0 đăng nhập, 10 bước, pid = tiến trình tên server_app
+// Output: mỗi bước 1 dòng JSON trên stdout
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../common/protocol.h"
+
+#define CONN_PER_SOURCE 20000       // < số port tạm mặc định (~28k) cho 1 địa chỉ nguồn
+#define SERVER_PROCESS_NAME "server_app"
+
+static const char* host = "127.0.0.1";
+static int port = 8888;
+static char prefix[32];
+
+// Tìm pid tiến trình server theo tên (comm), -1 nếu không thấy
+static int find_server_pid(void) {
+    DIR* dir = opendir("/proc");
+    if (!dir) return -1;
+    struct dirent* de;
+    int pid = -1;
+    while (pid < 0 && (de = readdir(dir)) != NULL) {
+        int candidate = atoi(de->d_name);
+        if (candidate <= 0) continue;
+        char path[64], comm[64] = "";
+        snprintf(path, sizeof(path), "/proc/%d/comm", candidate);
+        FILE* f = fopen(path, "r");
+        if (!f) continue;
+        if (fgets(comm, sizeof(comm), f)) comm[strcspn(comm, "\n")] = '\0';
+        fclose(f);
+        if (strcmp(comm, SERVER_PROCESS_NAME) == 0) pid = candidate;
+    }
+    closedir(dir);
+    return pid;
+}
+
+// VmRSS của tiến trình (KB), -1 nếu không đọc được
+static long read_rss_kb(int pid) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            kb = atol(line + 6);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+static int open_connection(int index) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    if (strncmp(host, "127.", 4) == 0) {
+        struct sockaddr_in src;
+        memset(&src, 0, sizeof(src));
+        src.sin_family = AF_INET;
+        src.sin_addr.s_addr = htonl(INADDR_LOOPBACK + (uint32_t)(index / CONN_PER_SOURCE));
+#ifdef IP_BIND_ADDRESS_NO_PORT
+        // Chọn port lúc connect theo cả 4-tuple (không đụng port TIME_WAIT của lần chạy trước)
+        int one = 1;
+        setsockopt(sock, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+#endif
+        if (bind(sock, (struct sockaddr*)&src, sizeof(src)) < 0) {
+            close(sock);
+            return -1;
+        }
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// REGISTER (409 = đã có) + LOGIN trên kết nối, 0 nếu đăng nhập được
+static int authenticate(int sock, int index) {
+    char username[MAX_USERNAME], email[MAX_EMAIL], message[256];
+    snprintf(username, sizeof(username), "%s_%d", prefix, index);
+    snprintf(email, sizeof(email), "%s@bench.test", username);
+    int code;
+
+    const char* reg[] = { username, "bench123", email };
+    if (send_request(sock, CMD_REGISTER, reg, 3) < 0) return -1;
+    free(receive_response(sock, &code, message, sizeof(message)));
+    if (code != RESPONSE_OK && code != RESPONSE_CONFLICT) return -1;
+
+    const char* login[] = { username, "bench123" };
+    if (send_request(sock, CMD_LOGIN, login, 2) < 0) return -1;
+    free(receive_response(sock, &code, message, sizeof(message)));
+    return code == RESPONSE_OK ? 0 : -1;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char** argv) {
+    int total = 10000, authenticated = 0, steps = 10, settle_ms = 1000, pid = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:n:a:s:w:P:")) != -1) {
+        switch (opt) {
+        case 'H': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'n': total = atoi(optarg); break;
+        case 'a': authenticated = atoi(optarg); break;
+        case 's': steps = atoi(optarg); break;
+        case 'w': settle_ms = atoi(optarg); break;
+        case 'P': pid = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-H host] [-p port] [-n connections] [-a authenticated] [-s steps] "
+                            "[-w settle_ms] [-P server_pid]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (total < 1 || steps < 1) return 1;
+    if (pid < 0) pid = find_server_pid();
+    if (pid < 0 || read_rss_kb(pid) < 0) {
+        fprintf(stderr, "cannot find server process (use -P pid)\n");
+        return 1;
+    }
+    snprintf(prefix, sizeof(prefix), "cm%lx", (unsigned long)time(NULL) & 0xffffff);
+
+    // Mỗi kết nối 1 fd ở phía benchmark
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    // Chừa fd cho /proc/<pid>/status
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < (rlim_t)total + 16) {
+        fprintf(stderr, "warning: open file limit %llu < %d connections (ulimit -n), using %llu\n",
+                (unsigned long long)rl.rlim_cur, total, (unsigned long long)rl.rlim_cur - 16);
+        total = (int)rl.rlim_cur - 16;
+    }
+
+    int* socks = malloc((size_t)total * sizeof(int));
+    if (!socks) return 1;
+
+    long base_kb = read_rss_kb(pid);
+    int opened = 0, logged_in = 0, failed = 0;
+    for (int step = 1; step <= steps; step++) {
+        int target = (int)((long long)total * step / steps);
+        while (opened < target) {
+            int sock = open_connection(opened);
+            if (sock < 0) {
+                perror("connect");
+                failed++;
+                break;
+            }
+            if (opened < authenticated) {
+                if (authenticate(sock, opened) == 0) logged_in++; else failed++;
+            }
+            socks[opened++] = sock;
+        }
+
+        sleep_ms(settle_ms);        // Chờ server accept hết
+        long rss_kb = read_rss_kb(pid);
+        printf("{\"bench\":\"conn_memory\",\"case\":\"%s\",\"connections\":%d,\"authenticated\":%d,"
+               "\"failed\":%d,\"base_rss_kb\":%ld,\"rss_kb\":%ld,\"bytes_per_conn\":%.0f}\n",
+               authenticated > 0 ? "authenticated" : "idle", opened, logged_in, failed, base_kb, rss_kb,
+               opened > 0 ? (double)(rss_kb - base_kb) * 1024.0 / opened : 0.0);
+        fflush(stdout);
+        if (opened < target) break;
+    }
+
+    // Đóng bằng RST: không để lại TIME_WAIT chiếm port tạm cho lần chạy sau
+    struct linger lg = { 1, 0 };
+    for (int i = 0; i < opened; i++) {
+        setsockopt(socks[i], SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        close(socks[i]);
+    }
+    free(socks);
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+// Benchmark: độ trễ LOGIN khi REGISTER (password_hash) làm bão hòa pool
+//   Mặc định: gọi password_verify / password_hash trực tiếp trên pool trong process
+//   -s: LOGIN round trip qua server đang chạy (REGISTER user mới liên tục để tạo tải băm trên
+//       pool của server; kích thước pool theo cấu hình server, mỗi LOGIN thread 1 user riêng,
+//       LOGOUT sau mỗi lần LOGIN, chỉ đo LOGIN)
+//
+// Usage: bench_password_pool [pool_threads] [queue_size] [flood_threads] [login_threads] [seconds]
+//        bench_password_pool -s [-H host] [-p port] [flood_threads] [login_threads] [seconds]
+// Output: 1 dòng JSON trên stdout
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../server/password_hash.h"
+#include "../common/protocol.h"
+
+#define MAX_SAMPLES 1000000
+#define LOGIN_THINK_US 10000   // Thời gian nghỉ giữa 2 lần LOGIN của 1 client
+#define BUSY_RETRY_US 1000     // Client thử lại sau khi bị từ chối
+#define BENCH_PASSWORD "secret"
+
+static int stop = 0;           // Đọc / ghi bằng __atomic
+static char stored_hash[PASSWORD_HASH_SIZE];
+
+// Chế độ server (-s)
+static int server_mode = 0;
+static const char* host = "127.0.0.1";
+static int port = 8888;
+static char prefix[32];
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static double* login_samples;   // micro giây
+static long login_count = 0;
+static long login_busy = 0;
+static long login_wrong = 0;
+static long hash_ok = 0;
+static long hash_busy = 0;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int stopping(void) {
+    return __atomic_load_n(&stop, __ATOMIC_ACQUIRE);
+}
+
+static int open_connection(void) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Gửi request, nhận response; return mã response (-1 nếu lỗi mạng), extra (nếu có) copy vào out
+static int exchange(int sock, const char* command, const char** fields, int count, char* out, size_t out_size) {
+    char message[256];
+    int code = -1;
+    if (send_request(sock, command, fields, count) < 0) return -1;
+    char* data = receive_response(sock, &code, message, sizeof(message));
+    if (out && out_size) snprintf(out, out_size, "%s", data ? data : "");
+    free(data);
+    return code;
+}
+
+static void login_username(int index, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s_l%d", prefix, index);
+}
+
+// REGISTER user của 1 LOGIN thread (trước khi đo)
+static int register_login_user(int sock, int index) {
+    char username[MAX_USERNAME], email[MAX_EMAIL];
+    login_username(index, username, sizeof(username));
+    snprintf(email, sizeof(email), "%s@bench.test", username);
+    const char* fields[] = { username, BENCH_PASSWORD, email };
+    int code;
+    while ((code = exchange(sock, CMD_REGISTER, fields, 3, NULL, 0)) == RESPONSE_SERVICE_UNAVAILABLE) {
+        usleep(BUSY_RETRY_US);
+    }
+    return code == RESPONSE_OK ? 0 : -1;
+}
+
+// 1 lần băm: 0 nếu thành công, PASSWORD_BUSY nếu bị từ chối, PASSWORD_ERROR nếu lỗi
+static int flood_once(int sock, int index, long seq) {
+    if (!server_mode) {
+        char out[PASSWORD_HASH_SIZE];
+        return password_hash("new-user-password", out, sizeof(out));
+    }
+    char username[MAX_USERNAME], email[MAX_EMAIL];
+    snprintf(username, sizeof(username), "%s_f%d_%ld", prefix, index, seq);
+    snprintf(email, sizeof(email), "%s@bench.test", username);
+    const char* fields[] = { username, "new-user-password", email };
+    int code = exchange(sock, CMD_REGISTER, fields, 3, NULL, 0);
+    if (code == RESPONSE_OK) return 0;
+    return code == RESPONSE_SERVICE_UNAVAILABLE ? PASSWORD_BUSY : PASSWORD_ERROR;
+}
+
+/**
+ * Chức năng: 1 lần LOGIN
+ * @param token  [out] Session token (chế độ server, khi thành công)
+ * @return 1 nếu đúng mật khẩu, 0 nếu sai, PASSWORD_BUSY, PASSWORD_ERROR
+ */
+static int login_once(int sock, int index, char* token, size_t token_size) {
+    if (!server_mode) return password_verify(BENCH_PASSWORD, stored_hash, NULL);
+
+    char username[MAX_USERNAME];
+    login_username(index, username, sizeof(username));
+    const char* fields[] = { username, BENCH_PASSWORD };
+    int code = exchange(sock, CMD_LOGIN, fields, 2, token, token_size);
+    if (code == RESPONSE_SERVICE_UNAVAILABLE) return PASSWORD_BUSY;
+    if (code < 0) return PASSWORD_ERROR;
+    if (code != RESPONSE_OK) return 0;
+    return 1;
+}
+
+// LOGOUT sau LOGIN thành công (để LOGIN lần sau trên cùng kết nối), không tính vào độ trễ
+static void logout_once(int sock, const char* token) {
+    const char* fields[] = { token };
+    exchange(sock, CMD_LOGOUT, fields, 1, NULL, 0);
+}
+
+static void* flood_thread(void* arg) {
+    int index = (int)(long)arg;
+    int sock = -1;
+    if (server_mode && (sock = open_connection()) < 0) {
+        perror("connect");
+        return NULL;
+    }
+    long seq = 0;
+    while (!stopping()) {
+        int rc = flood_once(sock, index, seq++);
+        pthread_mutex_lock(&stats_mutex);
+        if (rc == 0) hash_ok++; else if (rc == PASSWORD_BUSY) hash_busy++;
+        pthread_mutex_unlock(&stats_mutex);
+        if (rc == PASSWORD_ERROR && server_mode) break;    // Mất kết nối
+        if (rc == PASSWORD_BUSY) usleep(BUSY_RETRY_US);
+    }
+    if (sock >= 0) close(sock);
+    return NULL;
+}
+
+static void* login_thread(void* arg) {
+    int index = (int)(long)arg;
+    int sock = -1;
+    if (server_mode && (sock = open_connection()) < 0) {
+        perror("connect");
+        return NULL;
+    }
+    while (!stopping()) {
+        char token[MAX_SESSION_ID] = "";
+        double start = now_us();
+        int rc = login_once(sock, index, token, sizeof(token));
+        double elapsed = now_us() - start;
+
+        pthread_mutex_lock(&stats_mutex);
+        if (rc == PASSWORD_BUSY) {
+            login_busy++;
+        } else {
+            if (rc != 1) login_wrong++;
+            if (login_count < MAX_SAMPLES) login_samples[login_count] = elapsed;
+            login_count++;
+        }
+        pthread_mutex_unlock(&stats_mutex);
+
+        if (rc == PASSWORD_ERROR && server_mode) break;        // Mất kết nối
+        if (rc == 1 && server_mode) logout_once(sock, token);
+        usleep(rc == PASSWORD_BUSY ? BUSY_RETRY_US : LOGIN_THINK_US);
+    }
+    if (sock >= 0) close(sock);
+    return NULL;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, long n, double p) {
+    if (n == 0) return 0;
+    long idx = (long)(p * (n - 1));
+    return sorted[idx];
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "sH:p:")) != -1) {
+        switch (opt) {
+        case 's': server_mode = 1; break;
+        case 'H': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [pool_threads] [queue_size] [flood_threads] [login_threads] [seconds]\n"
+                            "       %s -s [-H host] [-p port] [flood_threads] [login_threads] [seconds]\n",
+                    argv[0], argv[0]);
+            return 1;
+        }
+    }
+    // Chế độ server: pool do cấu hình server quyết định => không có 2 tham số đầu
+    int arg = optind;
+    int pool_threads = PASSWORD_POOL_THREADS, queue_size = PASSWORD_POOL_QUEUE;
+    if (!server_mode) {
+        if (arg < argc) pool_threads = atoi(argv[arg++]);
+        if (arg < argc) queue_size = atoi(argv[arg++]);
+    }
+    int flood_threads = arg < argc ? atoi(argv[arg++]) : 16;
+    int login_threads = arg < argc ? atoi(argv[arg++]) : 8;
+    int seconds = arg < argc ? atoi(argv[arg++]) : 5;
+
+    login_samples = (double*)malloc(sizeof(double) * MAX_SAMPLES);
+    if (!login_samples) return 1;
+
+    // Chưa init pool => hash chạy trực tiếp, đồng thời đo chi phí 1 lần băm
+    double t0 = now_us();
+    if (password_hash(BENCH_PASSWORD, stored_hash, sizeof(stored_hash)) != 0) {
+        fprintf(stderr, "password_hash failed\n");
+        return 1;
+    }
+    double hash_cost_us = now_us() - t0;
+
+    if (server_mode) {
+        snprintf(prefix, sizeof(prefix), "pp%lx", (unsigned long)time(NULL) & 0xffffff);
+        int sock = open_connection();
+        if (sock < 0) {
+            perror("connect");
+            return 1;
+        }
+        for (int i = 0; i < login_threads; i++) {
+            if (register_login_user(sock, i) < 0) {
+                fprintf(stderr, "REGISTER failed for login user %d\n", i);
+                return 1;
+            }
+        }
+        close(sock);
+    } else if (password_pool_init(pool_threads, queue_size) < 0) {
+        fprintf(stderr, "password_pool_init failed\n");
+        return 1;
+    }
+
+    int total = flood_threads + login_threads;
+    pthread_t* threads = (pthread_t*)calloc((size_t)total, sizeof(pthread_t));
+    for (int i = 0; i < flood_threads; i++) {
+        pthread_create(&threads[i], NULL, flood_thread, (void*)(long)i);
+    }
+    for (int i = 0; i < login_threads; i++) {
+        pthread_create(&threads[flood_threads + i], NULL, login_thread, (void*)(long)i);
+    }
+
+    sleep((unsigned)seconds);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < total; i++) pthread_join(threads[i], NULL);
+    if (!server_mode) password_pool_destroy();
+
+    long n = login_count < MAX_SAMPLES ? login_count : MAX_SAMPLES;
+    qsort(login_samples, (size_t)n, sizeof(double), cmp_double);
+
+    // Chế độ server: pool_threads / queue = 0 (theo cấu hình server), login_* là round trip LOGIN
+    printf("{\"bench\":\"password_pool\",\"case\":\"%s\",\"pool_threads\":%d,\"queue\":%d,"
+           "\"flood_threads\":%d,\"login_threads\":%d,\"seconds\":%d,"
+           "\"hash_cost_us\":%.0f,\"hash_ok\":%ld,\"hash_busy\":%ld,"
+           "\"login_ok\":%ld,\"login_busy\":%ld,\"login_wrong\":%ld,"
+           "\"login_p50_us\":%.0f,\"login_p99_us\":%.0f,\"login_max_us\":%.0f}\n",
+           server_mode ? "server" : "direct",
+           server_mode ? 0 : pool_threads, server_mode ? 0 : queue_size,
+           flood_threads, login_threads, seconds,
+           hash_cost_us, hash_ok, hash_busy,
+           login_count, login_busy, login_wrong,
+           percentile(login_samples, n, 0.50), percentile(login_samples, n, 0.99),
+           n > 0 ? login_samples[n - 1] : 0.0);
+
+    free(threads);
+    free(login_samples);
+    return 0;
+}
@@ -0,0 +1,215 @@
+// Benchmark: các hàm nóng của common/protocol.c
+//   parse_request     theo số field và độ dài field (malloc / arena của kết nối)
+//   send_response     (chuỗi extra) và send_response_data (Buffer) theo độ dài extra,
+//                     qua socketpair có thread đọc bỏ
+//   receive_message   qua socketpair, message gửi thành nhiều mảnh (fragment byte / lần send)
+//
+// Usage: bench_protocol [case]      case: parse | send | receive (mặc định: tất cả)
+// Output: mỗi case 1 dòng JSON trên stdout (xem bench.h)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "bench.h"
+#include "../common/protocol.h"
+
+#define RECV_MAX_FRAGMENTS 64     // Giới hạn số mảnh / message (socket buffer của 1 thread)
+
+// ---------- parse_request ----------
+
+typedef struct {
+    char* line;
+    Arena arena;
+} ParseArg;
+
+static void run_parse(void* p) {
+    ParseArg* a = (ParseArg*)p;
+    char command[MAX_COMMAND];
+    int field_count;
+    char** fields = parse_request(a->line, command, &field_count);
+    free_fields(fields, field_count);
+}
+
+static void run_parse_arena(void* p) {
+    ParseArg* a = (ParseArg*)p;
+    char command[MAX_COMMAND];
+    int field_count;
+    parse_request_arena(&a->arena, a->line, command, &field_count);
+    arena_reset(&a->arena);
+}
+
+static void bench_parse(void) {
+    static const int field_counts[] = { 1, 4, 16, 64 };
+    static const int field_sizes[] = { 8, 64, 256 };
+
+    for (size_t i = 0; i < sizeof(field_counts) / sizeof(field_counts[0]); i++) {
+        for (size_t j = 0; j < sizeof(field_sizes) / sizeof(field_sizes[0]); j++) {
+            int n = field_counts[i], size = field_sizes[j];
+            size_t len = strlen(CMD_CREATE_EVENT) + (size_t)n * (size + 1) + 1;
+            if (len >= MAX_BUFFER) continue;
+
+            ParseArg a;
+            a.line = malloc(len);
+            if (!a.line) return;
+            char* p = a.line + sprintf(a.line, "%s", CMD_CREATE_EVENT);
+            for (int f = 0; f < n; f++) {
+                *p++ = '|';
+                memset(p, 'a' + f % 26, (size_t)size);
+                p += size;
+            }
+            *p = '\0';
+
+            BenchResult r = bench_run(run_parse, &a, 0);
+            bench_print_begin("protocol", "parse_request");
+            printf(",\"fields\":%d,\"field_bytes\":%d,\"line_bytes\":%zu", n, size, strlen(a.line));
+            bench_print_end(&r);
+
+            arena_init(&a.arena);
+            r = bench_run(run_parse_arena, &a, 0);
+            bench_print_begin("protocol", "parse_request_arena");
+            printf(",\"fields\":%d,\"field_bytes\":%d,\"line_bytes\":%zu", n, size, strlen(a.line));
+            bench_print_end(&r);
+            arena_free(&a.arena);
+            free(a.line);
+        }
+    }
+}
+
+// ---------- send_response / send_response_data ----------
+
+static void* drain_thread(void* arg) {
+    int sock = *(int*)arg;
+    char buf[65536];
+    while (recv(sock, buf, sizeof(buf), 0) > 0) { }
+    return NULL;
+}
+
+typedef struct {
+    int sock;
+    char* extra;            // NULL = không có extra
+    size_t extra_len;
+} SendArg;
+
+static void run_send_response(void* p) {
+    SendArg* a = (SendArg*)p;
+    send_response(a->sock, RESPONSE_OK, "Event list retrieved successfully", a->extra);
+}
+
+static void run_send_response_data(void* p) {
+    SendArg* a = (SendArg*)p;
+    send_response_data(a->sock, RESPONSE_OK, "Event list retrieved successfully", a->extra, a->extra_len);
+}
+
+static void bench_send(void) {
+    static const size_t extra_sizes[] = { 0, 64, 4096, 60000 };
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return;
+    }
+    pthread_t drain;
+    pthread_create(&drain, NULL, drain_thread, &fds[1]);
+
+    for (size_t i = 0; i < sizeof(extra_sizes) / sizeof(extra_sizes[0]); i++) {
+        SendArg a = { fds[0], NULL, extra_sizes[i] };
+        if (a.extra_len > 0) {
+            a.extra = malloc(a.extra_len + 1);
+            if (!a.extra) break;
+            memset(a.extra, 'x', a.extra_len);
+            a.extra[a.extra_len] = '\0';
+        }
+
+        BenchResult r = bench_run(run_send_response, &a, 0);
+        bench_print_begin("protocol", "send_response");
+        printf(",\"extra_bytes\":%zu", a.extra_len);
+        bench_print_end(&r);
+
+        r = bench_run(run_send_response_data, &a, 0);
+        bench_print_begin("protocol", "send_response_data");
+        printf(",\"extra_bytes\":%zu", a.extra_len);
+        bench_print_end(&r);
+        free(a.extra);
+    }
+
+    shutdown(fds[0], SHUT_WR);
+    pthread_join(drain, NULL);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// ---------- receive_message ----------
+
+typedef struct {
+    int writer;
+    int reader;
+    char* message;          // Kết thúc bằng \r\n
+    size_t len;
+    size_t fragment;        // Byte / lần send
+    char* buffer;           // MAX_BUFFER
+} RecvArg;
+
+// Mỗi lần: gửi 1 message thành nhiều mảnh rồi receive_message
+// (receive_message bỏ phần đọc lố sau \r\n nên không gửi trước nhiều message)
+static void run_receive(void* p) {
+    RecvArg* a = (RecvArg*)p;
+    for (size_t off = 0; off < a->len; off += a->fragment) {
+        size_t n = a->len - off < a->fragment ? a->len - off : a->fragment;
+        send(a->writer, a->message + off, n, 0);
+    }
+    receive_message(a->reader, a->buffer, MAX_BUFFER);
+}
+
+static void bench_receive(void) {
+    static const size_t message_sizes[] = { 64, 1024, 16384 };
+    static const size_t fragments[] = { 0, 1024, 64, 16 };     // 0 = cả message 1 lần
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(message_sizes) / sizeof(message_sizes[0]); i++) {
+        for (size_t j = 0; j < sizeof(fragments) / sizeof(fragments[0]); j++) {
+            RecvArg a;
+            a.writer = fds[0];
+            a.reader = fds[1];
+            a.len = message_sizes[i];
+            if (fragments[j] >= a.len) continue;      // Trùng với trường hợp cả message
+            a.fragment = fragments[j] ? fragments[j] : a.len;
+            if (a.len / a.fragment > RECV_MAX_FRAGMENTS) continue;
+
+            a.message = malloc(a.len);
+            a.buffer = malloc(MAX_BUFFER);
+            if (!a.message || !a.buffer) {
+                free(a.message);
+                free(a.buffer);
+                break;
+            }
+            memcpy(a.message, CMD_GET_EVENTS "|", strlen(CMD_GET_EVENTS) + 1);
+            memset(a.message + strlen(CMD_GET_EVENTS) + 1, 'k', a.len - strlen(CMD_GET_EVENTS) - 3);
+            memcpy(a.message + a.len - 2, "\r\n", 2);
+
+            BenchResult r = bench_run(run_receive, &a, 0);
+            bench_print_begin("protocol", "receive_message");
+            printf(",\"message_bytes\":%zu,\"fragment_bytes\":%zu", a.len, a.fragment);
+            bench_print_end(&r);
+            free(a.message);
+            free(a.buffer);
+        }
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char** argv) {
+    const char* only = argc > 1 ? argv[1] : NULL;
+
+    if (!only || strcmp(only, "parse") == 0) bench_parse();
+    if (!only || strcmp(only, "send") == 0) bench_send();
+    if (!only || strcmp(only, "receive") == 0) bench_receive();
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Benchmark: server/session.c theo số session đang active trong bảng
+//   session_create + session_destroy   (tạo 1 session mới rồi hủy, bảng giữ nguyên kích thước)
+//   session_find_by_token              token có trong bảng (lần lượt) / token không tồn tại
+//   session_find_by_socket
+//   session_validate
+//
+// Usage: bench_session [table_size ...]    (mặc định: 16 128 MAX_SESSIONS-1)
+// Output: mỗi case 1 dòng JSON trên stdout (xem bench.h)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../server/session.h"
+
+typedef struct {
+    SessionManager* sm;
+    char (*tokens)[MAX_TOKEN];
+    int count;
+    int next;               // Vòng qua các session để không luôn trúng cùng 1 slot
+} SessionArg;
+
+static void run_create_destroy(void* p) {
+    SessionArg* a = (SessionArg*)p;
+    char* token = session_create(a->sm, 1, -1);
+    if (token) session_destroy(a->sm, token);
+}
+
+static void run_find_hit(void* p) {
+    SessionArg* a = (SessionArg*)p;
+    session_find_by_token(a->sm, a->tokens[a->next]);
+    if (++a->next == a->count) a->next = 0;
+}
+
+static void run_find_miss(void* p) {
+    SessionArg* a = (SessionArg*)p;
+    session_find_by_token(a->sm, "no-such-session-token-000000000");
+}
+
+static void run_find_socket(void* p) {
+    SessionArg* a = (SessionArg*)p;
+    session_find_by_socket(a->sm, a->next + 1000);
+    if (++a->next == a->count) a->next = 0;
+}
+
+static void run_validate(void* p) {
+    SessionArg* a = (SessionArg*)p;
+    session_validate(a->sm, a->tokens[a->next]);
+    if (++a->next == a->count) a->next = 0;
+}
+
+static void print_case(const char* name, int size, BenchFn fn, SessionArg* a) {
+    a->next = 0;
+    BenchResult r = bench_run(fn, a, 0);
+    bench_print_begin("session", name);
+    printf(",\"sessions\":%d", size);
+    bench_print_end(&r);
+}
+
+static int bench_table(int size) {
+    SessionManager* sm = malloc(sizeof(SessionManager));
+    SessionArg a = { sm, malloc((size_t)size * MAX_TOKEN), 0, 0 };
+    if (!sm || !a.tokens) {
+        free(sm);
+        free(a.tokens);
+        return -1;
+    }
+
+    session_init(sm);
+    for (int i = 0; i < size; i++) {
+        // Socket giả 1000 + i để session_find_by_socket có thể tìm
+        char* token = session_create(sm, i + 1, 1000 + i);
+        if (!token) break;
+        strcpy(a.tokens[a.count++], token);
+    }
+
+    print_case("create_destroy", a.count, run_create_destroy, &a);
+    print_case("find_by_token_hit", a.count, run_find_hit, &a);
+    print_case("find_by_token_miss", a.count, run_find_miss, &a);
+    print_case("find_by_socket", a.count, run_find_socket, &a);
+    print_case("validate", a.count, run_validate, &a);
+
+    free(a.tokens);
+    free(sm);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            int size = atoi(argv[i]);
+            if (size < 1 || size >= MAX_SESSIONS) {
+                fprintf(stderr, "table size must be 1..%d\n", MAX_SESSIONS - 1);
+                return 1;
+            }
+            if (bench_table(size) < 0) return 1;
+        }
+        return 0;
+    }
+
+    int sizes[] = { 16, 128, MAX_SESSIONS - 1 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (bench_table(sizes[i]) < 0) return 1;
+    }
+    return 0;
+}
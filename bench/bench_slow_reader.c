@@ -0,0 +1,219 @@
+// Benchmark: độ trễ của client bình thường khi có client gửi request nhưng không đọc response
+//   -n kết nối "kẹt": SO_RCVBUF nhỏ, mỗi kết nối 1 user có STALL_EVENTS event (response lớn),
+//   dồn GET_EVENTS (pipelined) tới khi server ngừng đọc (buffer gửi phía server đầy, worker bị
+//   chặn khi gửi) và không bao giờ đọc response
+//   Trong lúc đó 1 kết nối đo gửi STATS tuần tự -d giây: nếu mọi worker bị kẹt, request đo
+//   không được trả lời (lỗi sau PROBE_TIMEOUT_MS); server ngắt kết nối kẹt => closed_by_server
+//   Nên chọn -n lớn hơn số worker của server (worker_threads, mặc định 32)
+//
+// Usage: bench_slow_reader [-H host] [-p port] [-n stalled] [-d seconds]
+//   Mặc định: 64 kết nối kẹt, đo 10 giây
+// Output: 1 dòng JSON trên stdout
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../common/protocol.h"
+
+#define STALLED_RCVBUF 4096         // Buffer nhận nhỏ: phía server đầy nhanh
+#define STALL_EVENTS 50             // Event của mỗi user kẹt (<= PAGE_DEFAULT_LIMIT: 1 trang)
+#define STALL_EVENT_TIME "2099-01-01 10:00:00"
+#define PUMP_IDLE_MS 500            // Không gửi thêm được byte nào trong khoảng này = server ngừng đọc
+#define PUMP_MAX_MS 120000          // Dồn request tối đa
+#define PROBE_TIMEOUT_MS 30000      // Request đo chờ response tối đa
+#define MAX_PROBES 100000
+
+static const char* host = "127.0.0.1";
+static int port = 8888;
+static char prefix[32];
+
+static int open_connection(int rcvbuf) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    // Phải đặt trước connect (window scale chọn lúc bắt tay)
+    if (rcvbuf > 0) setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Gửi request, nhận response; return mã response (-1 nếu lỗi mạng), extra (nếu có) copy vào out
+static int exchange(int sock, const char* command, const char** fields, int count, char* out, size_t out_size) {
+    char message[256];
+    int code = -1;
+    if (send_request(sock, command, fields, count) < 0) return -1;
+    char* data = receive_response(sock, &code, message, sizeof(message));
+    if (out && out_size) snprintf(out, out_size, "%s", data ? data : "");
+    free(data);
+    return code;
+}
+
+/**
+ * Chức năng: REGISTER + LOGIN user riêng của kết nối, tạo STALL_EVENTS event
+ * @param request  [out] Dòng GET_EVENTS có token (để dồn)
+ * @return 0 nếu thành công, -1 nếu lỗi
+ */
+static int prepare(int sock, int index, char* request, size_t request_size) {
+    char username[MAX_USERNAME], email[MAX_EMAIL], token[MAX_SESSION_ID];
+    snprintf(username, sizeof(username), "%s_%d", prefix, index);
+    snprintf(email, sizeof(email), "%s@bench.test", username);
+
+    const char* reg[] = { username, "bench123", email };
+    if (exchange(sock, CMD_REGISTER, reg, 3, NULL, 0) != RESPONSE_OK) return -1;
+    const char* login[] = { username, "bench123" };
+    if (exchange(sock, CMD_LOGIN, login, 2, token, sizeof(token)) != RESPONSE_OK) return -1;
+
+    char description[201];
+    memset(description, 'x', sizeof(description) - 1);
+    description[sizeof(description) - 1] = '\0';
+    for (int i = 0; i < STALL_EVENTS; i++) {
+        char title[MAX_USERNAME + 32];
+        snprintf(title, sizeof(title), "Slow reader %s #%d", username, i);
+        const char* fields[] = { token, title, STALL_EVENT_TIME, "Hall A", "public", description };
+        if (exchange(sock, CMD_CREATE_EVENT, fields, 6, NULL, 0) != RESPONSE_OK) return -1;
+    }
+    snprintf(request, request_size, "%s|%s\r\n", CMD_GET_EVENTS, token);
+    return 0;
+}
+
+// Gửi request (không chặn) tới khi buffer gửi đầy
+// @return số byte đã gửi, -1 nếu kết nối đã bị đóng
+static long pump(int sock, const char* request) {
+    size_t len = strlen(request);
+    long sent = 0;
+    for (;;) {
+        ssize_t n = send(sock, request, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? sent : -1;
+        sent += n;
+    }
+}
+
+// Server đã đóng kết nối (RST / FIN) chưa
+static int closed_by_peer(int sock) {
+    struct pollfd pfd = { sock, POLLRDHUP, 0 };
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & (POLLHUP | POLLERR | POLLRDHUP));
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv) {
+    int stalled = 64, seconds = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:n:d:")) != -1) {
+        switch (opt) {
+        case 'H': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'n': stalled = atoi(optarg); break;
+        case 'd': seconds = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-H host] [-p port] [-n stalled] [-d seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (stalled < 1 || seconds < 1) return 1;
+
+    snprintf(prefix, sizeof(prefix), "sr%lx", (unsigned long)time(NULL) & 0xffffff);
+
+    int* socks = malloc((size_t)stalled * sizeof(int));
+    char (*requests)[128] = malloc((size_t)stalled * sizeof(*requests));
+    double* latencies = malloc(MAX_PROBES * sizeof(double));
+    if (!socks || !requests || !latencies) return 1;
+
+    for (int i = 0; i < stalled; i++) {
+        socks[i] = open_connection(STALLED_RCVBUF);
+        if (socks[i] < 0) {
+            perror("connect");
+            return 1;
+        }
+        if (prepare(socks[i], i, requests[i], sizeof(requests[i])) < 0) {
+            fprintf(stderr, "setup failed on connection %d\n", i);
+            return 1;
+        }
+    }
+    // Server đọc tiếp khi còn gửi được response: dồn nhiều vòng tới khi cả 2 phía đầy
+    double pump_start = now_ms(), last_progress = pump_start;
+    while (now_ms() - last_progress < PUMP_IDLE_MS && now_ms() - pump_start < PUMP_MAX_MS) {
+        for (int i = 0; i < stalled; i++) {
+            if (pump(socks[i], requests[i]) > 0) last_progress = now_ms();
+        }
+        usleep(10000);
+    }
+    double pump_ms = now_ms() - pump_start;
+
+    int probe = open_connection(0);
+    if (probe < 0) {
+        perror("connect");
+        return 1;
+    }
+    struct timeval tv = { PROBE_TIMEOUT_MS / 1000, (PROBE_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(probe, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    int count = 0, errors = 0;
+    double end = now_ms() + seconds * 1000.0;
+    while (now_ms() < end && count < MAX_PROBES) {
+        char message[256];
+        int code = 0;
+        double t0 = now_ms();
+        if (send_request(probe, CMD_STATS, NULL, 0) < 0) {
+            errors++;
+            break;
+        }
+        char* data = receive_response(probe, &code, message, sizeof(message));
+        free(data);
+        if (code != RESPONSE_OK) {
+            errors++;
+            break;                  // Timeout / mất kết nối: kết nối đo không dùng tiếp được
+        }
+        latencies[count++] = now_ms() - t0;
+    }
+
+    int closed = 0;
+    for (int i = 0; i < stalled; i++) {
+        if (closed_by_peer(socks[i])) closed++;
+    }
+
+    qsort(latencies, (size_t)count, sizeof(double), cmp_double);
+    printf("{\"bench\":\"slow_reader\",\"case\":\"stalled\",\"stalled\":%d,\"pump_ms\":%.0f,\"closed_by_server\":%d,"
+           "\"probe_requests\":%d,\"probe_errors\":%d,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+           stalled, pump_ms, closed, count, errors,
+           count ? latencies[count / 2] : 0.0,
+           count ? latencies[(count * 99 - 1) / 100] : 0.0,
+           count ? latencies[count - 1] : 0.0);
+
+    // Đóng bằng RST (còn dữ liệu chưa đọc)
+    struct linger lg = { 1, 0 };
+    for (int i = 0; i < stalled; i++) {
+        setsockopt(socks[i], SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        close(socks[i]);
+    }
+    close(probe);
+    free(socks);
+    free(requests);
+    free(latencies);
+    return errors > 0 ? 1 : 0;
+}
@@ -413,35 +413,58 @@ void do_create_event() {
     free(extra);
 }
 
+// Lấy danh sách theo từng trang (GET_EVENTS / GET_FRIENDS) để mỗi response luôn vừa MAX_BUFFER
+// return: số bản ghi đã in, -1 nếu server trả lỗi
+int print_paged_list(const char* command, const char* title) {
+    char cursor[PAGE_CURSOR_SIZE] = "";
+    char limit[16];
+    snprintf(limit, sizeof(limit), "%d", PAGE_DEFAULT_LIMIT);
+    int i = 1;
+
+    while (1) {
+        const char* fields[] = { session_id, limit, cursor };
+        send_request(client_sock, command, fields, cursor[0] ? 3 : 2);
+
+        int code;
+        char message[MAX_BUFFER];
+        char* extra = receive_response(client_sock, &code, message, MAX_BUFFER);
+
+        if (code != RESPONSE_OK) {
+            printf("[SERVER] (%d) %s\n", code, message);
+            free(extra);
+            return -1;
+        }
+        if (i == 1) printf("[SERVER] (%d) %s\n", code, message);
+
+        // Mỗi dòng 1 bản ghi, dòng "next=<cursor>" cho biết trang sau
+        cursor[0] = '\0';
+        char* line = extra ? strtok(extra, "\n") : NULL;
+        while (line) {
+            if (strncmp(line, PAGE_NEXT_PREFIX, strlen(PAGE_NEXT_PREFIX)) == 0) {
+                snprintf(cursor, sizeof(cursor), "%s", line + strlen(PAGE_NEXT_PREFIX));
+            } else {
+                if (i == 1) printf("=== %s ===\n", title);
+                printf("%d) %s\n", i++, line);
+            }
+            line = strtok(NULL, "\n");
+        }
+        free(extra);
+
+        if (cursor[0] == '\0') break;
+    }
+    return i - 1;
+}
+
 void do_get_events() {
     if (strlen(session_id) == 0) {
         printf("[ERROR] You must login first.\n");
         return;
     }
 
-    const char* fields[] = { session_id };
-    send_request(client_sock, CMD_GET_EVENTS, fields, 1);
-
-    int code;
-    char message[MAX_BUFFER];
-    char* extra = receive_response(client_sock, &code, message, MAX_BUFFER);
-
-    printf("[SERVER] (%d) %s\n", code, message);
-
-    if (code == RESPONSE_OK && extra && strlen(extra) > 0) {
-        printf("=== Your events ===\n");
-        // mỗi dòng 1 event, fields cách nhau bởi ';'
-        char* line = strtok(extra, "\n");
-        int i = 1;
-        while (line) {
-            printf("%d) %s\n", i++, line);
-            line = strtok(NULL, "\n");
-        }
-    } else if (code == RESPONSE_OK) {
+    // mỗi dòng 1 event, fields cách nhau bởi ';'
+    if (print_paged_list(CMD_GET_EVENTS, "Your events") == 0) {
         printf("You have no events.\n");
     }
-
-    free(extra);
 }
 // hàm này lấy sự kiện do user tạo
 void do_get_events_crebyuser() {
@@ -654,28 +677,9 @@ void do_get_friends() {
         return;
     }
 
-    const char* fields[] = { session_id };
-    send_request(client_sock, CMD_GET_FRIENDS, fields, 1);
-
-    int code;
-    char message[MAX_BUFFER];
-    char* extra = receive_response(client_sock, &code, message, MAX_BUFFER);
-
-    printf("[SERVER] (%d) %s\n", code, message);
-
-    if (code == RESPONSE_OK && extra && strlen(extra) > 0) {
-        printf("=== Your friends ===\n");
-        char* line = strtok(extra, "\n");
-        int i = 1;
-        while (line) {
-            printf("%d) %s\n", i++, line);
-            line = strtok(NULL, "\n");
-        }
-    } else if (code == RESPONSE_OK) {
+    if (print_paged_list(CMD_GET_FRIENDS, "Your friends") == 0) {
         printf("You have no friends.\n");
     }
-
-    free(extra);
 }
 void do_send_invitation_event(){
     if (strlen(session_id) == 0) {
@@ -0,0 +1,573 @@
+// Load generator (closed-loop) cho server_app
+//   - N kết nối song song, mỗi kết nối 1 user tổng hợp: REGISTER, LOGIN, tạo 1 event public +
+//     1 event private, kết bạn với kết nối kế tiếp (vòng tròn) rồi chạy mix lệnh theo trọng số
+//   - Theo vòng: JOIN_EVENT xin vào event private của kết nối trước, ACCEPT_JOIN_REQUEST duyệt
+//     yêu cầu của kết nối sau; UNFRIEND hủy bạn với kết nối sau rồi kết bạn lại
+//   - Mỗi kết nối gửi 1 request, chờ response rồi mới gửi tiếp; -r giới hạn tổng tốc độ
+//     (chia đều cho các kết nối), 0 = chạy nhanh nhất có thể
+//   - Kết quả: throughput + p50/p90/p99/max theo từng lệnh (chỉ tính pha chạy, không tính setup)
+//
+// Usage: loadgen_app [-H host] [-p port] [-c connections] [-d seconds] [-r total_rps]
+//                    [-m CMD=weight,...] [-P user_prefix] [-j]
+//   -m  thay toàn bộ mix mặc định, VD: -m GET_EVENTS=70,GET_EVENT_DETAIL=30
+//   -j  in kết quả dạng JSON (1 dòng / lệnh + 1 dòng tổng)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../common/protocol.h"
+#include "../common/histogram.h"
+
+#define LOADGEN_CONNECTIONS 16
+#define LOADGEN_SECONDS 10
+#define LOADGEN_PASSWORD "loadgen123"
+#define LOADGEN_EVENT_TIME "2099-01-01 10:00:00"
+#define LOADGEN_PAGE_LIMIT "50"
+#define LOADGEN_RECV_TIMEOUT 10     // Giây chờ response, quá thì coi như lỗi mạng
+#define LOADGEN_MESSAGE_SIZE 512
+
+// Thứ tự trùng với op_names
+enum {
+    OP_REGISTER, OP_LOGIN, OP_LOGOUT, OP_CREATE_EVENT, OP_GET_EVENTS, OP_GET_EVENT_DETAIL,
+    OP_UPDATE_EVENT, OP_DELETE_EVENT, OP_GET_FRIENDS, OP_SEND_INVITATION_EVENT,
+    OP_ACCEPT_INVITATION_REQUEST, OP_JOIN_EVENT, OP_ACCEPT_JOIN_REQUEST, OP_SEND_FRIEND_REQUEST,
+    OP_ACCEPT_FRIEND_REQUEST, OP_REJECT_FRIEND_REQUEST, OP_UNFRIEND, OP_GET_EVENTS_CREBYUSER,
+    OP_COUNT
+};
+
+static const char* op_names[OP_COUNT] = {
+    CMD_REGISTER, CMD_LOGIN, CMD_LOGOUT, CMD_CREATE_EVENT, CMD_GET_EVENTS, CMD_GET_EVENT_DETAIL,
+    CMD_UPDATE_EVENT, CMD_DELETE_EVENT, CMD_GET_FRIENDS, CMD_SEND_INVITATION_EVENT,
+    CMD_ACCEPT_INVITATION_REQUEST, CMD_JOIN_EVENT, CMD_ACCEPT_JOIN_REQUEST, CMD_SEND_FRIEND_REQUEST,
+    CMD_ACCEPT_FRIEND_REQUEST, CMD_REJECT_FRIEND_REQUEST, CMD_UNFRIEND, CMD_GET_EVENTS_CREBYUSER
+};
+
+// Mix mặc định: chủ yếu là đọc, giống 1 phiên dùng thật
+static const int default_weights[OP_COUNT] = {
+    [OP_REGISTER] = 1, [OP_LOGIN] = 1, [OP_CREATE_EVENT] = 5, [OP_GET_EVENTS] = 30,
+    [OP_GET_EVENT_DETAIL] = 20, [OP_UPDATE_EVENT] = 4, [OP_DELETE_EVENT] = 2, [OP_GET_FRIENDS] = 15,
+    [OP_SEND_INVITATION_EVENT] = 3, [OP_ACCEPT_INVITATION_REQUEST] = 2, [OP_JOIN_EVENT] = 4,
+    [OP_ACCEPT_JOIN_REQUEST] = 2, [OP_SEND_FRIEND_REQUEST] = 2, [OP_ACCEPT_FRIEND_REQUEST] = 1,
+    [OP_REJECT_FRIEND_REQUEST] = 1, [OP_UNFRIEND] = 1, [OP_GET_EVENTS_CREBYUSER] = 6
+};
+
+// Mã response được đếm riêng; NET = lỗi kết nối / timeout
+static const int code_values[] = { 200, 400, 401, 404, 409, 422, 500, 503 };
+#define KNOWN_CODES ((int)(sizeof(code_values) / sizeof(code_values[0])))
+#define CODE_OTHER KNOWN_CODES
+#define CODE_NET (KNOWN_CODES + 1)
+#define CODE_SLOTS (KNOWN_CODES + 2)
+
+typedef struct {
+    uint64_t codes[CODE_SLOTS];
+    Histogram latency;              // micro giây
+} OpStats;
+
+typedef struct {
+    int id;
+    int sock;
+    char username[MAX_USERNAME];
+    char email[MAX_EMAIL];
+    char token[MAX_SESSION_ID];
+    int event_id;                   // Event tạo lúc setup (các kết nối khác dùng)
+    int extra_event_id;             // Event tạo trong pha chạy (DELETE_EVENT xóa)
+    int private_event_id;           // Event private nhận JOIN_EVENT (đổi sau mỗi lần duyệt, đọc/ghi atomic)
+    int refriend_pending;           // Kết nối trước đã UNFRIEND + gửi lại lời mời: chấp nhận trước thao tác kế tiếp
+    int registered;                 // Số user phụ đã REGISTER
+    unsigned int seed;
+    int recording;                  // 0 trong pha setup
+    int dead;                       // Mất kết nối
+    OpStats* stats;                 // OP_COUNT phần tử
+} Worker;
+
+static const char* host = "127.0.0.1";
+static int port = 8888;
+static int connections = LOADGEN_CONNECTIONS;
+static int seconds = LOADGEN_SECONDS;
+static double rate = 0;
+static const char* prefix = NULL;
+static int json = 0;
+static int weights[OP_COUNT];
+static int weight_total = 0;
+
+static Worker* workers;
+static pthread_barrier_t barrier;
+static uint64_t run_start_us;
+static uint64_t run_end_us;
+
+static int code_index(int code) {
+    if (code < 0) return CODE_NET;
+    for (int i = 0; i < KNOWN_CODES; i++) {
+        if (code_values[i] == code) return i;
+    }
+    return CODE_OTHER;
+}
+
+static int connect_server(void) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { LOADGEN_RECV_TIMEOUT, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+/**
+ * Chức năng: Gửi 1 request, chờ response, ghi thống kê (khi đang ở pha chạy)
+ * @param extra_out  Nhận extra của response (có thể NULL)
+ * @return mã response, -1 nếu lỗi mạng
+ */
+static int request(Worker* w, int op, const char** fields, int field_count, char* extra_out, size_t extra_size) {
+    if (w->dead) return -1;
+
+    char message[LOADGEN_MESSAGE_SIZE];
+    int code = -1;
+    uint64_t start = hist_now_us();
+    char* extra = NULL;
+    if (send_request(w->sock, op_names[op], fields, field_count) >= 0) {
+        extra = receive_response(w->sock, &code, message, sizeof(message));
+    }
+    uint64_t elapsed = hist_now_us() - start;
+
+    if (code < 0) w->dead = 1;
+    if (extra_out && extra_size > 0) {
+        snprintf(extra_out, extra_size, "%s", extra ? extra : "");
+    }
+    free(extra);
+
+    if (w->recording) {
+        OpStats* s = &w->stats[op];
+        s->codes[code_index(code)]++;
+        hist_record(&s->latency, elapsed);
+    }
+    return code;
+}
+
+static int do_login(Worker* w) {
+    const char* fields[] = { w->username, LOADGEN_PASSWORD };
+    char extra[MAX_SESSION_ID];
+    int code = request(w, OP_LOGIN, fields, 2, extra, sizeof(extra));
+    if (code == RESPONSE_OK) snprintf(w->token, sizeof(w->token), "%s", extra);
+    return code;
+}
+
+static int do_logout(Worker* w) {
+    const char* fields[] = { w->token };
+    return request(w, OP_LOGOUT, fields, 1, NULL, 0);
+}
+
+static int do_create_event(Worker* w, const char* type, int* event_id) {
+    char title[64];
+    snprintf(title, sizeof(title), "Load test %s", w->username);
+    const char* fields[] = { w->token, title, LOADGEN_EVENT_TIME, "Hall A", type, "Generated by loadgen" };
+    char extra[32];
+    int code = request(w, OP_CREATE_EVENT, fields, 6, extra, sizeof(extra));
+    if (code == RESPONSE_OK && event_id) *event_id = atoi(extra);
+    return code;
+}
+
+static Worker* pick_other(Worker* w) {
+    if (connections == 1) return w;
+    int i = (int)(rand_r(&w->seed) % (unsigned)(connections - 1));
+    return &workers[i >= w->id ? i + 1 : i];
+}
+
+// 1 thao tác theo mix (vài thao tác cần nhiều request, mỗi request ghi theo lệnh của nó)
+static void run_op(Worker* w, int op) {
+    Worker* other = pick_other(w);
+    Worker* next = &workers[(w->id + 1) % connections];
+    Worker* prev = &workers[(w->id + connections - 1) % connections];
+    char own_event[16], prev_event[16];
+    snprintf(own_event, sizeof(own_event), "%d", w->event_id);
+    snprintf(prev_event, sizeof(prev_event), "%d", prev->event_id);
+
+    // Kết nối trước vừa UNFRIEND: chấp nhận lời mời kết bạn lại để giữ vòng bạn bè
+    if (__atomic_exchange_n(&w->refriend_pending, 0, __ATOMIC_ACQ_REL)) {
+        const char* fields[] = { w->token, prev->username };
+        request(w, OP_ACCEPT_FRIEND_REQUEST, fields, 2, NULL, 0);
+    }
+
+    switch (op) {
+    case OP_REGISTER: {
+        // Server không cho REGISTER khi đang đăng nhập: LOGOUT, REGISTER user phụ, LOGIN lại
+        char username[MAX_USERNAME + 16], email[MAX_USERNAME + 32];
+        snprintf(username, sizeof(username), "%s_r%d", w->username, ++w->registered);
+        snprintf(email, sizeof(email), "%s@load.test", username);
+        const char* fields[] = { username, LOADGEN_PASSWORD, email };
+        do_logout(w);
+        request(w, OP_REGISTER, fields, 3, NULL, 0);
+        do_login(w);
+        break;
+    }
+    case OP_LOGIN:
+    case OP_LOGOUT:
+        do_logout(w);
+        do_login(w);
+        break;
+    case OP_CREATE_EVENT:
+        do_create_event(w, "public", &w->extra_event_id);
+        break;
+    case OP_GET_EVENTS: {
+        const char* fields[] = { w->token, LOADGEN_PAGE_LIMIT };
+        request(w, op, fields, 2, NULL, 0);
+        break;
+    }
+    case OP_GET_EVENT_DETAIL: {
+        // Server chỉ trả chi tiết event cho người tạo
+        const char* fields[] = { w->token, own_event };
+        request(w, op, fields, 2, NULL, 0);
+        break;
+    }
+    case OP_UPDATE_EVENT: {
+        char title[64];
+        snprintf(title, sizeof(title), "Load test %s #%u", w->username, rand_r(&w->seed) % 1000);
+        const char* fields[] = { w->token, own_event, title, "Updated by loadgen", "Hall B",
+                                 LOADGEN_EVENT_TIME, "public" };
+        request(w, op, fields, 7, NULL, 0);
+        break;
+    }
+    case OP_DELETE_EVENT: {
+        if (!w->extra_event_id) do_create_event(w, "public", &w->extra_event_id);
+        char event[16];
+        snprintf(event, sizeof(event), "%d", w->extra_event_id);
+        const char* fields[] = { w->token, event };
+        request(w, op, fields, 2, NULL, 0);
+        w->extra_event_id = 0;
+        break;
+    }
+    case OP_GET_FRIENDS: {
+        const char* fields[] = { w->token, LOADGEN_PAGE_LIMIT };
+        request(w, op, fields, 2, NULL, 0);
+        break;
+    }
+    case OP_SEND_INVITATION_EVENT: {
+        const char* fields[] = { w->token, next->username, own_event };
+        request(w, op, fields, 3, NULL, 0);
+        break;
+    }
+    case OP_ACCEPT_INVITATION_REQUEST: {
+        const char* fields[] = { w->token, prev->username, prev_event };
+        request(w, op, fields, 3, NULL, 0);
+        break;
+    }
+    case OP_JOIN_EVENT: {
+        // Event public không cần xin (409): xin vào event private của kết nối trước
+        char event[16];
+        snprintf(event, sizeof(event), "%d", __atomic_load_n(&prev->private_event_id, __ATOMIC_ACQUIRE));
+        const char* fields[] = { w->token, event };
+        request(w, op, fields, 2, NULL, 0);
+        break;
+    }
+    case OP_ACCEPT_JOIN_REQUEST: {
+        // Duyệt yêu cầu của kết nối sau; duyệt xong đổi sang event private mới để JOIN tiếp theo
+        // lại tạo yêu cầu (trên event cũ kết nối sau đã là participant)
+        char event[16];
+        snprintf(event, sizeof(event), "%d", w->private_event_id);
+        const char* fields[] = { w->token, event, next->username };
+        int event_id;
+        if (request(w, op, fields, 3, NULL, 0) == RESPONSE_OK &&
+            do_create_event(w, "private", &event_id) == RESPONSE_OK) {
+            __atomic_store_n(&w->private_event_id, event_id, __ATOMIC_RELEASE);
+        }
+        break;
+    }
+    case OP_UNFRIEND: {
+        // Hủy bạn vòng (kết nối sau) rồi gửi lại lời mời; kết nối sau chấp nhận ở thao tác kế tiếp
+        const char* fields[] = { w->token, next->username };
+        if (request(w, op, fields, 2, NULL, 0) == RESPONSE_OK && next != w &&
+            request(w, OP_SEND_FRIEND_REQUEST, fields, 2, NULL, 0) == RESPONSE_OK) {
+            __atomic_store_n(&next->refriend_pending, 1, __ATOMIC_RELEASE);
+        }
+        break;
+    }
+    case OP_SEND_FRIEND_REQUEST:
+    case OP_ACCEPT_FRIEND_REQUEST:
+    case OP_REJECT_FRIEND_REQUEST: {
+        const char* fields[] = { w->token, other->username };
+        request(w, op, fields, 2, NULL, 0);
+        break;
+    }
+    case OP_GET_EVENTS_CREBYUSER: {
+        const char* fields[] = { w->token };
+        request(w, op, fields, 1, NULL, 0);
+        break;
+    }
+    }
+}
+
+static int pick_op(Worker* w) {
+    int r = (int)(rand_r(&w->seed) % (unsigned)weight_total);
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (r < weights[op]) return op;
+        r -= weights[op];
+    }
+    return OP_GET_EVENTS;
+}
+
+static void sleep_until(uint64_t target_us) {
+    uint64_t now = hist_now_us();
+    if (target_us <= now) return;
+    struct timespec ts = { (time_t)((target_us - now) / 1000000), (long)((target_us - now) % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) { }
+}
+
+// Setup: user + event + vòng bạn bè (id -> id+1); các bước cách nhau bằng barrier
+static void setup(Worker* w) {
+    w->sock = connect_server();
+    if (w->sock < 0) {
+        w->dead = 1;
+    } else {
+        const char* fields[] = { w->username, LOADGEN_PASSWORD, w->email };
+        int code = request(w, OP_REGISTER, fields, 3, NULL, 0);
+        if ((code != RESPONSE_OK && code != RESPONSE_CONFLICT) || do_login(w) != RESPONSE_OK ||
+            do_create_event(w, "public", &w->event_id) != RESPONSE_OK ||
+            do_create_event(w, "private", &w->private_event_id) != RESPONSE_OK) {
+            w->dead = 1;
+        }
+    }
+    pthread_barrier_wait(&barrier);
+
+    if (connections > 1) {
+        const char* fields[] = { w->token, workers[(w->id + 1) % connections].username };
+        request(w, OP_SEND_FRIEND_REQUEST, fields, 2, NULL, 0);
+    }
+    pthread_barrier_wait(&barrier);
+
+    if (connections > 1) {
+        const char* fields[] = { w->token, workers[(w->id + connections - 1) % connections].username };
+        request(w, OP_ACCEPT_FRIEND_REQUEST, fields, 2, NULL, 0);
+    }
+    pthread_barrier_wait(&barrier);
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    setup(w);
+
+    // Thread 0 đặt mốc bắt đầu cho tất cả
+    if (w->id == 0) {
+        run_start_us = hist_now_us();
+        run_end_us = run_start_us + (uint64_t)seconds * 1000000;
+    }
+    pthread_barrier_wait(&barrier);
+
+    if (w->dead) {
+        fprintf(stderr, "[LOADGEN] connection %d failed during setup\n", w->id);
+        return NULL;
+    }
+
+    w->recording = 1;
+    uint64_t interval_us = rate > 0 ? (uint64_t)(connections * 1e6 / rate) : 0;
+    // Lệch pha các kết nối để không gửi cùng lúc
+    uint64_t next = run_start_us + (interval_us ? interval_us * (uint64_t)w->id / (uint64_t)connections : 0);
+
+    while (!w->dead && hist_now_us() < run_end_us) {
+        if (interval_us) {
+            sleep_until(next);
+            next += interval_us;
+        }
+        run_op(w, pick_op(w));
+    }
+    w->recording = 0;
+    if (!w->dead) do_logout(w);
+    close(w->sock);
+    return NULL;
+}
+
+// "CMD=weight,CMD=weight" -> weights
+static int parse_mix(const char* spec) {
+    memset(weights, 0, sizeof(weights));
+    char* copy = strdup(spec);
+    if (!copy) return -1;
+
+    int rc = 0;
+    char* save = NULL;
+    for (char* item = strtok_r(copy, ",", &save); item && rc == 0; item = strtok_r(NULL, ",", &save)) {
+        char* eq = strchr(item, '=');
+        int weight = eq ? atoi(eq + 1) : 1;
+        if (eq) *eq = '\0';
+        rc = -1;
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (strcmp(item, op_names[op]) == 0 && weight >= 0) {
+                weights[op] = weight;
+                rc = 0;
+            }
+        }
+        if (rc < 0) fprintf(stderr, "Unknown command or weight in mix: %s\n", item);
+    }
+    free(copy);
+    return rc;
+}
+
+static void report(void) {
+    OpStats* total = calloc(OP_COUNT, sizeof(OpStats));
+    Histogram* all = malloc(sizeof(Histogram));
+    if (!total || !all) return;
+    hist_init(all);
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        hist_init(&total[op].latency);
+        for (int i = 0; i < connections; i++) {
+            for (int k = 0; k < CODE_SLOTS; k++) total[op].codes[k] += workers[i].stats[op].codes[k];
+            hist_merge(&total[op].latency, &workers[i].stats[op].latency);
+        }
+        hist_merge(all, &total[op].latency);
+    }
+
+    double elapsed_s = (double)(run_end_us - run_start_us) / 1e6;
+    int alive = 0;
+    for (int i = 0; i < connections; i++) alive += !workers[i].dead;
+
+    if (!json) {
+        printf("%-26s %9s %9s %7s %9s %9s %9s %9s  codes\n",
+               "command", "count", "req/s", "err%", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    }
+    for (int op = -1; op < OP_COUNT; op++) {
+        const Histogram* h = op < 0 ? all : &total[op].latency;
+        if (op >= 0 && h->total == 0) continue;
+
+        uint64_t errors = 0;
+        char codes[256];
+        int len = 0;
+        codes[0] = '\0';
+        for (int k = 0; k < CODE_SLOTS; k++) {
+            uint64_t n = 0;
+            if (op < 0) {
+                for (int o = 0; o < OP_COUNT; o++) n += total[o].codes[k];
+            } else {
+                n = total[op].codes[k];
+            }
+            if (n == 0) continue;
+            if (k >= CODE_OTHER || code_values[k] >= 500) errors += n;
+
+            char label[16];
+            if (k == CODE_NET) snprintf(label, sizeof(label), "net");
+            else if (k == CODE_OTHER) snprintf(label, sizeof(label), "other");
+            else snprintf(label, sizeof(label), "%d", code_values[k]);
+            len += snprintf(codes + len, sizeof(codes) - (size_t)len,
+                            json ? "%s\"%s\":%llu" : "%s%s=%llu", len ? (json ? "," : " ") : "",
+                            label, (unsigned long long)n);
+            if (len >= (int)sizeof(codes)) len = (int)sizeof(codes) - 1;
+        }
+
+        const char* name = op < 0 ? "TOTAL" : op_names[op];
+        double rps = elapsed_s > 0 ? (double)h->total / elapsed_s : 0;
+        double err_pct = h->total ? 100.0 * (double)errors / (double)h->total : 0;
+        if (json) {
+            printf("{\"bench\":\"loadgen\",\"command\":\"%s\",\"connections\":%d,\"alive\":%d,"
+                   "\"seconds\":%.2f,\"target_rps\":%.0f,\"count\":%llu,\"rps\":%.1f,\"errors\":%llu,"
+                   "\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f,\"codes\":{%s}}\n",
+                   name, connections, alive, elapsed_s, rate, (unsigned long long)h->total, rps,
+                   (unsigned long long)errors, hist_percentile(h, 50) / 1000.0,
+                   hist_percentile(h, 90) / 1000.0, hist_percentile(h, 99) / 1000.0, h->max / 1000.0, codes);
+        } else {
+            printf("%-26s %9llu %9.1f %7.2f %9.3f %9.3f %9.3f %9.3f  %s\n",
+                   name, (unsigned long long)h->total, rps, err_pct,
+                   hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+                   hist_percentile(h, 99) / 1000.0, h->max / 1000.0, codes);
+        }
+    }
+    if (!json) {
+        printf("\nconnections=%d alive=%d duration=%.2fs target_rps=%.0f (err%% = 5xx + network)\n",
+               connections, alive, elapsed_s, rate);
+    }
+
+    free(total);
+    free(all);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-H host] [-p port] [-c connections] [-d seconds] [-r total_rps]\n"
+                    "          [-m CMD=weight,...] [-P user_prefix] [-j]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    memcpy(weights, default_weights, sizeof(weights));
+
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:c:d:r:m:P:j")) != -1) {
+        switch (opt) {
+        case 'H': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'c': connections = atoi(optarg); break;
+        case 'd': seconds = atoi(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 'm':
+            if (parse_mix(optarg) < 0) return 1;
+            break;
+        case 'P': prefix = optarg; break;
+        case 'j': json = 1; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    for (int op = 0; op < OP_COUNT; op++) weight_total += weights[op];
+    if (connections < 1 || seconds < 1 || weight_total <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Tên user mặc định khác nhau giữa các lần chạy
+    char default_prefix[32];
+    if (!prefix) {
+        snprintf(default_prefix, sizeof(default_prefix), "lg%lx", (unsigned long)time(NULL) & 0xffffff);
+        prefix = default_prefix;
+    }
+
+    workers = calloc((size_t)connections, sizeof(Worker));
+    pthread_t* threads = calloc((size_t)connections, sizeof(pthread_t));
+    if (!workers || !threads) return 1;
+    for (int i = 0; i < connections; i++) {
+        Worker* w = &workers[i];
+        w->id = i;
+        w->sock = -1;
+        w->seed = (unsigned int)time(NULL) ^ (unsigned int)(i * 2654435761u);
+        snprintf(w->username, sizeof(w->username), "%s_%d", prefix, i);
+        snprintf(w->email, sizeof(w->email), "%s@load.test", w->username);
+        w->stats = calloc(OP_COUNT, sizeof(OpStats));
+        if (!w->stats) return 1;
+        for (int op = 0; op < OP_COUNT; op++) hist_init(&w->stats[op].latency);
+    }
+
+    if (!json) {
+        fprintf(stderr, "[LOADGEN] %s:%d connections=%d duration=%ds target_rps=%.0f (0 = unlimited)\n",
+                host, port, connections, seconds, rate);
+    }
+
+    pthread_barrier_init(&barrier, NULL, (unsigned)connections);
+    for (int i = 0; i < connections; i++) {
+        if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < connections; i++) pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    report();
+
+    for (int i = 0; i < connections; i++) free(workers[i].stats);
+    free(workers);
+    free(threads);
+    return 0;
+}
@@ -0,0 +1,688 @@
+// Replay activity log (log_nhom3.txt) vào 1 server
+//   Dòng log: [dd/mm/YYYY HH:MM:SS]$ip$REQUEST$CODE|MESSAGE[|EXTRA]
+//
+//   1) Phân tích: gán mỗi username trong log 1 user mới <prefix>_u<N>; session token
+//      trong log được gắn với user qua response của LOGIN (token không rõ gốc -> user ẩn danh;
+//      lần dùng đầu bị 401 -> token không hợp lệ, replay gửi token sai);
+//      event id trong log gắn với event tạo bởi CREATE_EVENT khi replay
+//   2) Seed: REGISTER các user chưa được REGISTER thành công trong log, đăng nhập user ẩn danh,
+//      tạo trước các event được dùng mà không được tạo trong log
+//   3) Replay theo đúng thứ tự log, mỗi user 1 kết nối (LOGIN lại = kết nối mới),
+//      REGISTER trên 1 kết nối chưa đăng nhập; thay token / username / event id / mật khẩu
+//      (LOGIN thành công trong log dùng mật khẩu seed, thất bại dùng mật khẩu sai)
+//   4) So mã response với mã đã ghi, in thống kê độ trễ + số lần lệch theo lệnh
+//
+//   Request gửi tuần tự (giữ quan hệ nhân quả giữa các user); chạy nhiều tiến trình với
+//   -P khác nhau để tăng tải. Cursor phân trang trong log được gửi nguyên văn.
+//
+// Usage: replay_app [-H host] [-p port] [-s speed] [-g max_gap] [-P prefix] [-v] [-j] [log_file]
+//   -s  1 = tốc độ gốc, 10 = nhanh gấp 10, 0 = không chờ (mặc định)
+//   -g  khoảng nghỉ tối đa giữa 2 request (giây, theo thời gian log), mặc định 5
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../common/protocol.h"
+#include "../common/histogram.h"
+
+#define REPLAY_PASSWORD "replay123"
+#define REPLAY_WRONG_PASSWORD "replay-wrong"
+#define REPLAY_INVALID_TOKEN "replay-invalid-token"     // User chưa / không còn đăng nhập
+#define REPLAY_EVENT_TIME "2099-01-01 10:00:00"
+#define REPLAY_MAX_FIELDS 16
+#define REPLAY_MAX_GAP 5            // Giây
+#define REPLAY_RECV_TIMEOUT 10
+#define REPLAY_MESSAGE_SIZE 512
+#define REPLAY_SHOW_MISMATCH 20     // Số dòng lệch in ra khi không có -v
+#define REPLAY_MAX_COMMANDS 32
+
+typedef struct {
+    time_t ts;
+    int line;
+    char* request;
+    int code;                       // Mã đã ghi
+    char* extra;                    // Extra của response đã ghi ("" nếu không có)
+} Record;
+
+typedef struct {
+    char mapped[MAX_USERNAME];
+    int seed;                       // 1 = REGISTER trước khi replay
+    int anonymous;                  // Chỉ biết qua token: đăng nhập lúc seed nếu seed = 1
+    int sock;
+    char token[MAX_SESSION_ID];     // Token thật hiện tại ("" = chưa đăng nhập)
+} User;
+
+typedef struct {
+    char mapped[16];                // Event id thật ("" = chưa tạo)
+    int seed_owner;                 // User tạo lúc seed, -1 = tạo trong log
+} Event;
+
+// Bảng băm chuỗi -> chỉ số (khóa được strdup)
+typedef struct {
+    char** keys;
+    int* values;
+    size_t cap;
+    size_t count;
+} StrMap;
+
+typedef struct {
+    const char* command;
+    uint64_t mismatches;
+    Histogram latency;
+} CommandStats;
+
+static const char* host = "127.0.0.1";
+static int port = 8888;
+static double speed = 0;
+static int max_gap = REPLAY_MAX_GAP;
+static const char* prefix = NULL;
+static int verbose = 0;
+static int json = 0;
+
+static Record* records = NULL;
+static int record_count = 0;
+static User* users = NULL;
+static int user_count = 0;
+static Event* events = NULL;
+static int event_count = 0;
+static StrMap user_map, token_map, event_map;
+static StrMap registered_map;       // Username có REGISTER thành công trong log
+static int guest_sock = -1;
+static int seed_owner = -1;         // User tạo các event không rõ người tạo
+static int last_user = -1;          // User đăng nhập gửi request gần nhất
+static CommandStats command_stats[REPLAY_MAX_COMMANDS];
+static int command_count = 0;
+
+// ---------- StrMap ----------
+
+static uint64_t hash_str(const char* s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 1099511628211ULL;
+    return h;
+}
+
+static int map_grow(StrMap* m) {
+    size_t cap = m->cap ? m->cap * 2 : 256;
+    char** keys = calloc(cap, sizeof(char*));
+    int* values = calloc(cap, sizeof(int));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return -1;
+    }
+    for (size_t i = 0; i < m->cap; i++) {
+        if (!m->keys[i]) continue;
+        size_t j = hash_str(m->keys[i]) & (cap - 1);
+        while (keys[j]) j = (j + 1) & (cap - 1);
+        keys[j] = m->keys[i];
+        values[j] = m->values[i];
+    }
+    free(m->keys);
+    free(m->values);
+    m->keys = keys;
+    m->values = values;
+    m->cap = cap;
+    return 0;
+}
+
+static int map_get(const StrMap* m, const char* key) {
+    if (!m->cap) return -1;
+    for (size_t j = hash_str(key) & (m->cap - 1); m->keys[j]; j = (j + 1) & (m->cap - 1)) {
+        if (strcmp(m->keys[j], key) == 0) return m->values[j];
+    }
+    return -1;
+}
+
+static int map_put(StrMap* m, const char* key, int value) {
+    if ((m->count + 1) * 2 > m->cap && map_grow(m) < 0) return -1;
+    size_t j = hash_str(key) & (m->cap - 1);
+    while (m->keys[j]) {
+        if (strcmp(m->keys[j], key) == 0) {
+            m->values[j] = value;
+            return 0;
+        }
+        j = (j + 1) & (m->cap - 1);
+    }
+    m->keys[j] = strdup(key);
+    if (!m->keys[j]) return -1;
+    m->values[j] = value;
+    m->count++;
+    return 0;
+}
+
+static void map_free(StrMap* m) {
+    for (size_t i = 0; i < m->cap; i++) free(m->keys[i]);
+    free(m->keys);
+    free(m->values);
+}
+
+// ---------- Đọc log ----------
+
+static int parse_line(char* line, int line_no, Record* r) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(line, "[%d/%d/%d %d:%d:%d]", &tm.tm_mday, &tm.tm_mon, &tm.tm_year,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return -1;
+    }
+    tm.tm_mon -= 1;
+    tm.tm_year -= 1900;
+    tm.tm_isdst = -1;
+
+    // '$' trong nội dung đã bị thay bằng '_' khi ghi log
+    char* ip = strchr(line, '$');
+    char* request = ip ? strchr(ip + 1, '$') : NULL;
+    char* response = request ? strchr(request + 1, '$') : NULL;
+    if (!response) return -1;
+    *request++ = '\0';
+    *response++ = '\0';
+
+    char* msg = strchr(response, '|');
+    char* extra = msg ? strchr(msg + 1, '|') : NULL;
+
+    r->ts = mktime(&tm);
+    r->line = line_no;
+    r->code = atoi(response);
+    r->request = strdup(request);
+    r->extra = strdup(extra ? extra + 1 : "");
+    return (r->request && r->extra) ? 0 : -1;
+}
+
+static int load_log(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    int cap = 0, line_no = 0, skipped = 0;
+    char line[2048];
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        if (record_count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            Record* grown = realloc(records, (size_t)cap * sizeof(Record));
+            if (!grown) {
+                fclose(f);
+                return -1;
+            }
+            records = grown;
+        }
+        if (parse_line(line, line_no, &records[record_count]) == 0) {
+            record_count++;
+        } else {
+            skipped++;
+        }
+    }
+    fclose(f);
+    if (skipped) fprintf(stderr, "[REPLAY] skipped %d malformed line(s)\n", skipped);
+    return 0;
+}
+
+// ---------- Ánh xạ ----------
+
+static int split_request(char* request, char** fields) {
+    int n = 0;
+    char* save = NULL;
+    for (char* tok = strtok_r(request, "|", &save); tok && n < REPLAY_MAX_FIELDS; tok = strtok_r(NULL, "|", &save)) {
+        fields[n++] = tok;
+    }
+    return n;
+}
+
+static int add_user(int seed, int anonymous) {
+    if (user_count % 256 == 0) {
+        User* grown = realloc(users, (size_t)(user_count + 256) * sizeof(User));
+        if (!grown) return -1;
+        users = grown;
+    }
+    User* u = &users[user_count];
+    memset(u, 0, sizeof(*u));
+    snprintf(u->mapped, sizeof(u->mapped), "%s_%c%d", prefix, anonymous ? 'a' : 'u', user_count);
+    u->seed = seed;
+    u->anonymous = anonymous;
+    u->sock = -1;
+    return user_count++;
+}
+
+// User theo username trong log (tạo nếu chưa có)
+// Chỉ seed user không có REGISTER thành công nào trong log (có thì replay tự tạo)
+static int user_by_name(const char* name) {
+    int u = map_get(&user_map, name);
+    if (u >= 0) return u;
+    u = add_user(map_get(&registered_map, name) < 0, 0);
+    if (u >= 0) map_put(&user_map, name, u);
+    return u;
+}
+
+// User theo token trong log; token không rõ gốc -> user ẩn danh
+// valid = 0 (lần dùng đầu bị 401): không seed / đăng nhập => replay cũng nhận 401
+static int user_by_token(const char* token, int valid) {
+    int u = map_get(&token_map, token);
+    if (u >= 0) return u;
+    u = add_user(valid, 1);
+    if (u >= 0) map_put(&token_map, token, u);
+    return u;
+}
+
+static int event_by_id(const char* id, int owner_if_new) {
+    int e = map_get(&event_map, id);
+    if (e >= 0) return e;
+    if (event_count % 256 == 0) {
+        Event* grown = realloc(events, (size_t)(event_count + 256) * sizeof(Event));
+        if (!grown) return -1;
+        events = grown;
+    }
+    e = event_count++;
+    events[e].mapped[0] = '\0';
+    events[e].seed_owner = owner_if_new;
+    map_put(&event_map, id, e);
+    return e;
+}
+
+// Vị trí field của event id / username theo lệnh (-1 = không có)
+static void field_positions(const char* command, int* event_pos, int* user_pos) {
+    *event_pos = -1;
+    *user_pos = -1;
+    if (strcmp(command, CMD_GET_EVENT_DETAIL) == 0 || strcmp(command, CMD_UPDATE_EVENT) == 0 ||
+        strcmp(command, CMD_DELETE_EVENT) == 0 || strcmp(command, CMD_JOIN_EVENT) == 0) {
+        *event_pos = 1;
+    } else if (strcmp(command, CMD_SEND_INVITATION_EVENT) == 0 ||
+               strcmp(command, CMD_ACCEPT_INVITATION_REQUEST) == 0) {
+        *user_pos = 1;
+        *event_pos = 2;
+    } else if (strcmp(command, CMD_ACCEPT_JOIN_REQUEST) == 0) {
+        *event_pos = 1;
+        *user_pos = 2;
+    } else if (strcmp(command, CMD_SEND_FRIEND_REQUEST) == 0 || strcmp(command, CMD_ACCEPT_FRIEND_REQUEST) == 0 ||
+               strcmp(command, CMD_REJECT_FRIEND_REQUEST) == 0 || strcmp(command, CMD_UNFRIEND) == 0) {
+        *user_pos = 1;
+    }
+}
+
+// Lệnh chỉ người tạo event dùng được: event chưa biết thì seed với người gửi là chủ
+static int owner_command(const char* command) {
+    return strcmp(command, CMD_GET_EVENT_DETAIL) == 0 || strcmp(command, CMD_UPDATE_EVENT) == 0 ||
+           strcmp(command, CMD_DELETE_EVENT) == 0 || strcmp(command, CMD_SEND_INVITATION_EVENT) == 0 ||
+           strcmp(command, CMD_ACCEPT_JOIN_REQUEST) == 0;
+}
+
+static int is_session_command(const char* command) {
+    return strcmp(command, CMD_REGISTER) != 0 && strcmp(command, CMD_LOGIN) != 0 &&
+           strcmp(command, CMD_STATS) != 0;
+}
+
+// Duyệt log: dựng ánh xạ user / token / event và danh sách cần seed
+static int analyze(void) {
+    // Lượt 1: username được REGISTER thành công (dù xuất hiện trước đó ở LOGIN / target)
+    for (int i = 0; i < record_count; i++) {
+        Record* r = &records[i];
+        if (r->code != RESPONSE_OK) continue;
+        char* copy = strdup(r->request);
+        char* fields[REPLAY_MAX_FIELDS + 1];
+        if (!copy) return -1;
+        int n = split_request(copy, fields);
+        if (n >= 2 && strcmp(fields[0], CMD_REGISTER) == 0) map_put(&registered_map, fields[1], 1);
+        free(copy);
+    }
+
+    // Lượt 2: ánh xạ theo thứ tự log
+    for (int i = 0; i < record_count; i++) {
+        Record* r = &records[i];
+        char* copy = strdup(r->request);
+        char* fields[REPLAY_MAX_FIELDS + 1];
+        if (!copy) return -1;
+        int n = split_request(copy, fields);
+        if (n == 0) {
+            free(copy);
+            continue;
+        }
+        const char* command = fields[0];
+        char** args = fields + 1;
+        int nargs = n - 1;
+
+        if (strcmp(command, CMD_REGISTER) == 0 && nargs >= 1) {
+            user_by_name(args[0]);
+        } else if (strcmp(command, CMD_LOGIN) == 0 && nargs >= 1) {
+            int u = user_by_name(args[0]);
+            if (r->code == RESPONSE_OK && r->extra[0] && u >= 0) map_put(&token_map, r->extra, u);
+        } else if (is_session_command(command) && nargs >= 1) {
+            int u = user_by_token(args[0], r->code != RESPONSE_UNAUTHORIZED);
+            int event_pos, user_pos;
+            field_positions(command, &event_pos, &user_pos);
+            if (user_pos >= 0 && user_pos < nargs) user_by_name(args[user_pos]);
+            if (event_pos >= 0 && event_pos < nargs) {
+                if (owner_command(command)) {
+                    event_by_id(args[event_pos], u);
+                } else {
+                    if (seed_owner < 0 && map_get(&event_map, args[event_pos]) < 0) seed_owner = add_user(1, 0);
+                    event_by_id(args[event_pos], seed_owner);
+                }
+            }
+            if (strcmp(command, CMD_CREATE_EVENT) == 0 && r->code == RESPONSE_OK && r->extra[0] &&
+                map_get(&event_map, r->extra) < 0) {
+                event_by_id(r->extra, -1);
+            }
+        }
+        free(copy);
+    }
+    return 0;
+}
+
+// ---------- Mạng ----------
+
+static int connect_server(void) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { REPLAY_RECV_TIMEOUT, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+static int user_sock(User* u) {
+    if (u->sock < 0) u->sock = connect_server();
+    return u->sock;
+}
+
+// Gửi 1 request; extra_out nhận extra của response; return mã response, -1 nếu lỗi mạng
+static int exchange(int* sock, const char* command, const char** fields, int n, uint64_t* elapsed_us,
+                    char* extra_out, size_t extra_size) {
+    char message[REPLAY_MESSAGE_SIZE];
+    int code = -1;
+    char* extra = NULL;
+    uint64_t start = hist_now_us();
+    if (*sock >= 0 && send_request(*sock, command, fields, n) >= 0) {
+        extra = receive_response(*sock, &code, message, sizeof(message));
+    }
+    if (elapsed_us) *elapsed_us = hist_now_us() - start;
+    if (code < 0 && *sock >= 0) {
+        close(*sock);
+        *sock = -1;
+    }
+    if (extra_out && extra_size > 0) snprintf(extra_out, extra_size, "%s", extra ? extra : "");
+    free(extra);
+    return code;
+}
+
+static int login_user(User* u) {
+    const char* fields[] = { u->mapped, REPLAY_PASSWORD };
+    char token[MAX_SESSION_ID];
+    user_sock(u);
+    int code = exchange(&u->sock, CMD_LOGIN, fields, 2, NULL, token, sizeof(token));
+    if (code == RESPONSE_OK) snprintf(u->token, sizeof(u->token), "%s", token);
+    return code;
+}
+
+static int seed(void) {
+    guest_sock = connect_server();
+    if (guest_sock < 0) {
+        fprintf(stderr, "[REPLAY] cannot connect to %s:%d\n", host, port);
+        return -1;
+    }
+
+    int registered = 0, seeded_events = 0, failed = 0;
+    for (int i = 0; i < user_count; i++) {
+        if (!users[i].seed) continue;
+        char email[MAX_EMAIL];
+        snprintf(email, sizeof(email), "%s@replay.test", users[i].mapped);
+        const char* fields[] = { users[i].mapped, REPLAY_PASSWORD, email };
+        int code = exchange(&guest_sock, CMD_REGISTER, fields, 3, NULL, NULL, 0);
+        if (code == RESPONSE_OK || code == RESPONSE_CONFLICT) registered++; else failed++;
+    }
+
+    for (int e = 0; e < event_count; e++) {
+        if (events[e].seed_owner < 0) continue;
+        User* owner = &users[events[e].seed_owner];
+        if (!owner->token[0] && login_user(owner) != RESPONSE_OK) {
+            failed++;
+            continue;
+        }
+        const char* fields[] = { owner->token, "Replay seed", REPLAY_EVENT_TIME, "Seed hall", "public", "Seeded by replay" };
+        char id[16];
+        if (exchange(&owner->sock, CMD_CREATE_EVENT, fields, 6, NULL, id, sizeof(id)) == RESPONSE_OK) {
+            snprintf(events[e].mapped, sizeof(events[e].mapped), "%s", id);
+            seeded_events++;
+        } else {
+            failed++;
+        }
+    }
+
+    for (int i = 0; i < user_count; i++) {
+        if (users[i].anonymous && users[i].seed && !users[i].token[0] && login_user(&users[i]) != RESPONSE_OK) failed++;
+    }
+
+    fprintf(stderr, "[REPLAY] seeded %d user(s), %d event(s), %d failure(s); %d users total\n",
+            registered, seeded_events, failed, user_count);
+    return 0;
+}
+
+// ---------- Replay ----------
+
+static CommandStats* stats_for(const char* command) {
+    for (int i = 0; i < command_count; i++) {
+        if (strcmp(command_stats[i].command, command) == 0) return &command_stats[i];
+    }
+    if (command_count == REPLAY_MAX_COMMANDS) return NULL;
+    CommandStats* s = &command_stats[command_count++];
+    s->command = strdup(command);
+    s->mismatches = 0;
+    hist_init(&s->latency);
+    return s;
+}
+
+static void sleep_until(uint64_t target_us) {
+    uint64_t now = hist_now_us();
+    if (target_us <= now) return;
+    struct timespec ts = { (time_t)((target_us - now) / 1000000), (long)((target_us - now) % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) { }
+}
+
+static void replay_record(const Record* r, uint64_t* mismatches) {
+    char* copy = strdup(r->request);
+    char* fields[REPLAY_MAX_FIELDS + 1];
+    if (!copy) return;
+    int n = split_request(copy, fields);
+    if (n == 0) {
+        free(copy);
+        return;
+    }
+    const char* command = fields[0];
+    const char* args[REPLAY_MAX_FIELDS];
+    int nargs = n - 1;
+    for (int i = 0; i < nargs; i++) args[i] = fields[i + 1];
+
+    int* sock = &guest_sock;
+    User* user = NULL;
+    char email[MAX_EMAIL];
+
+    if (strcmp(command, CMD_REGISTER) == 0 && nargs >= 1) {
+        user = &users[map_get(&user_map, fields[1])];
+        args[0] = user->mapped;
+        if (nargs >= 2) args[1] = REPLAY_PASSWORD;
+        if (nargs >= 3) {
+            snprintf(email, sizeof(email), "%s@replay.test", user->mapped);
+            args[2] = email;
+        }
+        if (guest_sock < 0) guest_sock = connect_server();
+        // 400 trong log = client đang đăng nhập: gửi trên kết nối đã đăng nhập để không tạo user
+        if (r->code == RESPONSE_BAD_REQUEST && last_user >= 0 && users[last_user].token[0] &&
+            users[last_user].sock >= 0) {
+            sock = &users[last_user].sock;
+        }
+        user = NULL;
+    } else if (strcmp(command, CMD_LOGIN) == 0 && nargs >= 1) {
+        user = &users[map_get(&user_map, fields[1])];
+        args[0] = user->mapped;
+        if (nargs >= 2) args[1] = r->code == RESPONSE_OK ? REPLAY_PASSWORD : REPLAY_WRONG_PASSWORD;
+        // LOGIN thành công trong log = client mới: đóng kết nối cũ (server hủy session)
+        if (r->code == RESPONSE_OK && user->token[0] && user->sock >= 0) {
+            close(user->sock);
+            user->sock = -1;
+            user->token[0] = '\0';
+        }
+        sock = &user->sock;
+        user_sock(user);
+    } else if (is_session_command(command) && nargs >= 1) {
+        user = &users[map_get(&token_map, fields[1])];
+        args[0] = user->token[0] ? user->token : REPLAY_INVALID_TOKEN;
+        int event_pos, user_pos;
+        field_positions(command, &event_pos, &user_pos);
+        if (user_pos >= 0 && user_pos < nargs) args[user_pos] = users[map_get(&user_map, fields[user_pos + 1])].mapped;
+        if (event_pos >= 0 && event_pos < nargs) {
+            const Event* e = &events[map_get(&event_map, fields[event_pos + 1])];
+            if (e->mapped[0]) args[event_pos] = e->mapped;
+        }
+        sock = &user->sock;
+        user_sock(user);
+    }
+
+    char extra[MAX_SESSION_ID];
+    uint64_t elapsed = 0;
+    int code = exchange(sock, command, args, nargs, &elapsed, extra, sizeof(extra));
+
+    if (user && code == RESPONSE_OK) {
+        if (strcmp(command, CMD_LOGIN) == 0) {
+            snprintf(user->token, sizeof(user->token), "%s", extra);
+        } else if (strcmp(command, CMD_LOGOUT) == 0) {
+            user->token[0] = '\0';
+        } else if (strcmp(command, CMD_CREATE_EVENT) == 0 && r->code == RESPONSE_OK && r->extra[0]) {
+            int e = map_get(&event_map, r->extra);
+            if (e >= 0) snprintf(events[e].mapped, sizeof(events[e].mapped), "%.15s", extra);
+        }
+    }
+    if (user && user->token[0]) last_user = (int)(user - users);
+
+    CommandStats* s = stats_for(command);
+    if (s) hist_record(&s->latency, elapsed);
+    if (code != r->code) {
+        if (s) s->mismatches++;
+        if (verbose || *mismatches < REPLAY_SHOW_MISMATCH) {
+            fprintf(stderr, "[REPLAY] line %d %s: recorded %d, got %d\n", r->line, command, r->code, code);
+        }
+        (*mismatches)++;
+    }
+    free(copy);
+}
+
+static void report(double elapsed_s, uint64_t mismatches) {
+    Histogram* all = malloc(sizeof(Histogram));
+    if (!all) return;
+    hist_init(all);
+    for (int i = 0; i < command_count; i++) hist_merge(all, &command_stats[i].latency);
+
+    if (!json) {
+        printf("%-26s %9s %9s %9s %9s %9s %9s\n", "command", "count", "mismatch", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    }
+    for (int i = -1; i < command_count; i++) {
+        const Histogram* h = i < 0 ? all : &command_stats[i].latency;
+        const char* name = i < 0 ? "TOTAL" : command_stats[i].command;
+        uint64_t mis = i < 0 ? mismatches : command_stats[i].mismatches;
+        if (json) {
+            printf("{\"bench\":\"replay\",\"command\":\"%s\",\"count\":%llu,\"mismatches\":%llu,\"seconds\":%.2f,"
+                   "\"p50_ms\":%.3f,\"p90_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+                   name, (unsigned long long)h->total, (unsigned long long)mis, elapsed_s,
+                   hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+                   hist_percentile(h, 99) / 1000.0, h->max / 1000.0);
+        } else {
+            printf("%-26s %9llu %9llu %9.3f %9.3f %9.3f %9.3f\n",
+                   name, (unsigned long long)h->total, (unsigned long long)mis,
+                   hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+                   hist_percentile(h, 99) / 1000.0, h->max / 1000.0);
+        }
+    }
+    if (!json) {
+        printf("\nreplayed %llu request(s) in %.2fs, %llu response code mismatch(es)\n",
+               (unsigned long long)all->total, elapsed_s, (unsigned long long)mismatches);
+    }
+    free(all);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-H host] [-p port] [-s speed] [-g max_gap] [-P prefix] [-v] [-j] [log_file]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:s:g:P:vj")) != -1) {
+        switch (opt) {
+        case 'H': host = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 's': speed = atof(optarg); break;
+        case 'g': max_gap = atoi(optarg); break;
+        case 'P': prefix = optarg; break;
+        case 'v': verbose = 1; break;
+        case 'j': json = 1; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    const char* path = optind < argc ? argv[optind] : LOG_FILE_NAME;
+
+    // Tên user mặc định khác nhau giữa các lần chạy
+    char default_prefix[32];
+    if (!prefix) {
+        snprintf(default_prefix, sizeof(default_prefix), "rp%lx", (unsigned long)time(NULL) & 0xffffff);
+        prefix = default_prefix;
+    }
+
+    if (load_log(path) < 0 || analyze() < 0) return 1;
+    fprintf(stderr, "[REPLAY] %d request(s) from %s, %d user(s), %d event(s)\n",
+            record_count, path, user_count, event_count);
+    if (record_count == 0 || seed() < 0) return 1;
+
+    uint64_t mismatches = 0;
+    uint64_t start = hist_now_us();
+    uint64_t offset_us = 0;
+    for (int i = 0; i < record_count; i++) {
+        if (speed > 0 && i > 0) {
+            time_t gap = records[i].ts - records[i - 1].ts;
+            if (gap < 0) gap = 0;
+            if (gap > max_gap) gap = max_gap;
+            offset_us += (uint64_t)((double)gap * 1e6 / speed);
+            sleep_until(start + offset_us);
+        }
+        replay_record(&records[i], &mismatches);
+    }
+    double elapsed_s = (double)(hist_now_us() - start) / 1e6;
+
+    report(elapsed_s, mismatches);
+
+    for (int i = 0; i < user_count; i++) {
+        if (users[i].sock >= 0) close(users[i].sock);
+    }
+    if (guest_sock >= 0) close(guest_sock);
+    for (int i = 0; i < record_count; i++) {
+        free(records[i].request);
+        free(records[i].extra);
+    }
+    for (int i = 0; i < command_count; i++) free((char*)command_stats[i].command);
+    free(records);
+    free(users);
+    free(events);
+    map_free(&user_map);
+    map_free(&token_map);
+    map_free(&event_map);
+    map_free(&registered_map);
+    return 0;
+}
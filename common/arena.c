@@ -0,0 +1,71 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+static ArenaChunk* chunk_new(size_t cap) {
+    ArenaChunk* c = (ArenaChunk*)malloc(sizeof(ArenaChunk) + cap);
+    if (c == NULL) return NULL;
+    c->next = NULL;
+    c->cap = cap;
+    c->used = 0;
+    return c;
+}
+
+void arena_init(Arena* arena) {
+    arena->head = NULL;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk* c = arena->head;
+    if (c == NULL || c->cap - c->used < size) {
+        // Chunk mới gấp đôi chunk hiện tại => số chunk tăng theo log(kích thước request)
+        size_t cap = c ? c->cap * 2 : ARENA_CHUNK_SIZE;
+        while (cap < size) cap *= 2;
+        ArenaChunk* grown = chunk_new(cap);
+        if (grown == NULL) return NULL;
+        grown->next = c;
+        arena->head = grown;
+        c = grown;
+    }
+
+    void* p = c->data + c->used;
+    c->used += size;
+    return p;
+}
+
+char* arena_strndup(Arena* arena, const char* s, size_t n) {
+    char* copy = (char*)arena_alloc(arena, n + 1);
+    if (copy == NULL) return NULL;
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    return copy;
+}
+
+void arena_reset(Arena* arena) {
+    ArenaChunk* c = arena->head;
+    if (c == NULL) return;
+    if (c->next == NULL) {
+        c->used = 0;
+        return;
+    }
+
+    // Request vừa rồi cần nhiều chunk: thay bằng 1 chunk đủ chứa tất cả (giới hạn ARENA_KEEP_MAX)
+    size_t total = 0;
+    for (ArenaChunk* it = c; it != NULL; it = it->next) total += it->cap;
+    arena_free(arena);
+    size_t cap = ARENA_CHUNK_SIZE;
+    while (cap < total && cap < ARENA_KEEP_MAX) cap *= 2;
+    arena->head = chunk_new(cap);
+}
+
+void arena_free(Arena* arena) {
+    ArenaChunk* c = arena->head;
+    while (c != NULL) {
+        ArenaChunk* next = c->next;
+        free(c);
+        c = next;
+    }
+    arena->head = NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// =========================================
+// ARENA (bump allocator) cho bộ nhớ tạm của 1 request
+// - Mỗi kết nối giữ 1 arena: cấp phát = tăng con trỏ, không free từng phần tử
+// - arena_reset() sau mỗi request: gom lại thành 1 chunk (tối đa ARENA_KEEP_MAX) dùng cho
+//   request sau => request thông thường không gọi malloc/free, không tranh chấp allocator
+// - Không thread-safe: chỉ thread đang xử lý kết nối dùng arena của kết nối đó
+// =========================================
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE 4096       // Chunk nhỏ nhất
+#define ARENA_KEEP_MAX 65536        // Chunk giữ lại sau reset không lớn hơn (request lớn bất thường)
+#define ARENA_ALIGN 16
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;        // Chunk cấp trước đó
+    size_t cap;
+    size_t used;
+    _Alignas(ARENA_ALIGN) char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk* head;               // Chunk đang cấp phát (NULL = chưa cấp)
+} Arena;
+
+void arena_init(Arena* arena);
+
+/**
+ * Chức năng: Cấp phát size byte (căn ARENA_ALIGN), sống đến arena_reset / arena_free
+ * @return con trỏ vùng nhớ, NULL nếu hết bộ nhớ
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+// Copy n byte đầu của s (thêm '\0') vào arena
+char* arena_strndup(Arena* arena, const char* s, size_t n);
+
+// Thu hồi mọi vùng đã cấp; giữ lại 1 chunk đủ cho request lớn nhất vừa qua (<= ARENA_KEEP_MAX)
+void arena_reset(Arena* arena);
+
+void arena_free(Arena* arena);
+
+#endif // ARENA_H
@@ -0,0 +1,110 @@
+#include "histogram.h"
+#include <string.h>
+#include <time.h>
+
+#define HIST_MAX_VALUE ((UINT64_C(1) << HIST_MAX_BITS) - 1)
+
+// Vị trí bucket của value
+//   value < 2*SUB: chính nó
+//   còn lại: shift = msb - SUB_BITS, bucket = (shift + 1) * SUB + (value >> shift) - SUB
+static int bucket_index(uint64_t value) {
+    if (value < 2 * HIST_SUB_COUNT) return (int)value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB_COUNT + (int)(value >> shift) - HIST_SUB_COUNT;
+}
+
+// Giá trị lớn nhất rơi vào bucket idx
+static uint64_t bucket_upper(int idx) {
+    if (idx < 2 * HIST_SUB_COUNT) return (uint64_t)idx;
+    int shift = idx / HIST_SUB_COUNT - 1;
+    uint64_t sub = (uint64_t)(idx % HIST_SUB_COUNT + HIST_SUB_COUNT);
+    return ((sub + 1) << shift) - 1;
+}
+
+void hist_init(Histogram* h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;    // Chưa có giá trị; chỉ đọc min khi total > 0
+}
+
+void hist_record(Histogram* h, uint64_t value) {
+    if (value > HIST_MAX_VALUE) value = HIST_MAX_VALUE;
+    h->counts[bucket_index(value)]++;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+    h->total++;
+    h->sum += value;
+}
+
+void hist_record_atomic(Histogram* h, uint64_t value) {
+    if (value > HIST_MAX_VALUE) value = HIST_MAX_VALUE;
+    __atomic_fetch_add(&h->counts[bucket_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+
+    uint64_t cur = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while (value < cur) {
+        if (__atomic_compare_exchange_n(&h->min, &cur, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    cur = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > cur) {
+        if (__atomic_compare_exchange_n(&h->max, &cur, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    __atomic_fetch_add(&h->total, 1, __ATOMIC_RELEASE);
+}
+
+void hist_merge(Histogram* dst, const Histogram* src) {
+    if (src->total == 0) return;
+    for (int i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+void hist_merge_atomic(Histogram* dst, const Histogram* src) {
+    uint64_t total = __atomic_load_n(&src->total, __ATOMIC_ACQUIRE);
+    if (total == 0) return;
+    // Tổng các bucket có thể lệch total vài đơn vị khi đang có thread ghi: lấy theo bucket
+    uint64_t counted = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        uint64_t c = __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+        dst->counts[i] += c;
+        counted += c;
+    }
+    uint64_t min = __atomic_load_n(&src->min, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    if (min < dst->min) dst->min = min;
+    if (max > dst->max) dst->max = max;
+    dst->total += counted;
+    dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+}
+
+uint64_t hist_percentile(const Histogram* h, double p) {
+    if (h->total == 0) return 0;
+    if (p <= 0) return h->min;
+    if (p >= 100) return h->max;
+
+    // Số giá trị cần vượt qua (làm tròn lên, tối thiểu 1)
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->total + 0.999999);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_upper(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+uint64_t hist_mean(const Histogram* h) {
+    return h->total ? h->sum / h->total : 0;
+}
+
+uint64_t hist_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
@@ -0,0 +1,52 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+// =========================================
+// LATENCY HISTOGRAM (kiểu HDR: log-linear)
+// - Giá trị < 2^(HIST_SUB_BITS+1) đếm chính xác từng giá trị
+// - Lớn hơn: mỗi khoảng [2^k, 2^(k+1)) chia thành 2^HIST_SUB_BITS bucket đều nhau
+//   => sai số tương đối tối đa ~ 1 / 2^HIST_SUB_BITS (~3%) trên toàn dải giá trị
+// - Bộ nhớ cố định, record O(1), không cấp phát; không thread-safe (caller tự lock)
+// Đơn vị do caller chọn (server dùng micro giây)
+// =========================================
+#include <stdint.h>
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 36                          // Giá trị lớn hơn 2^36 - 1 bị kẹp lại
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;     // Số giá trị đã ghi
+    uint64_t sum;       // Tổng (để tính trung bình)
+    uint64_t min;       // UINT64_MAX khi rỗng
+    uint64_t max;
+} Histogram;
+
+// Phải gọi trước khi dùng (không dùng được histogram chỉ memset 0)
+void hist_init(Histogram* h);
+void hist_record(Histogram* h, uint64_t value);
+
+// Như hist_record nhưng dùng atomic (relaxed): nhiều thread ghi cùng histogram không cần lock
+void hist_record_atomic(Histogram* h, uint64_t value);
+
+// Cộng toàn bộ src vào dst
+void hist_merge(Histogram* dst, const Histogram* src);
+
+// Như hist_merge nhưng đọc src bằng atomic (src đang được hist_record_atomic ghi)
+void hist_merge_atomic(Histogram* dst, const Histogram* src);
+
+/**
+ * Chức năng: Giá trị tại phân vị p (0..100)
+ * @return cận trên của bucket chứa phân vị (không vượt max), 0 nếu histogram rỗng
+ */
+uint64_t hist_percentile(const Histogram* h, double p);
+
+// Trung bình, 0 nếu rỗng
+uint64_t hist_mean(const Histogram* h);
+
+// Thời điểm hiện tại theo CLOCK_MONOTONIC (micro giây), dùng để đo độ trễ
+uint64_t hist_now_us(void);
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,42 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// =========================================
+// USDT PROBES (provider "eventsrv")
+// - Có <sys/sdt.h> (apt install systemtap-sdt-dev) thì Makefile tự thêm -DHAVE_SYS_SDT_H:
+//   mỗi probe chỉ là 1 lệnh nop + ghi chú ELF, attach lúc đang chạy không cần build lại
+//     bpftrace -l 'usdt:./server_app:eventsrv:*'
+//     bpftrace -e 'usdt:./server_app:eventsrv:request__done { @[str(arg0)] = hist(arg3); }'
+// - Không có thì macro rỗng (không tính tham số)
+// - Tham số chỉ là giá trị đã có sẵn (con trỏ, số), không tính thêm gì cho probe
+//
+// Probe (tham số theo thứ tự):
+//   request__start    (command, user_id)                 sau khi parse (không lộ mật khẩu / token)
+//   request__done     (command, user_id, response_code, elapsed_us)
+//   session__create   (user_id, socket, token)           token NULL nếu hết slot
+//   session__lookup   (token, user_id)                   user_id -1 = không tìm thấy
+//   session__validate (token, valid)
+//   session__destroy  (user_id, socket)
+//   db__start         (db_function, sql)                 mọi backend (db_probe_start, server/db_common.h):
+//                                                        postgres mỗi câu lệnh, memory / embedded mỗi
+//                                                        lần giữ lock dữ liệu (sql "(in-memory)")
+//   db__done          (db_function, failed, elapsed_us)   lệnh ghi gom lô: chỉ có db__done
+//   send__message     (socket, bytes)                    send_message
+//   send__response    (socket, response_code, bytes)     send_response_data
+//   receive__message  (socket, bytes)                    receive_message, mỗi recv của reactor
+//                                                        (0: đóng, < 0: lỗi / chưa có dữ liệu)
+// =========================================
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define PROBE2(name, a, b)          DTRACE_PROBE2(eventsrv, name, a, b)
+#define PROBE3(name, a, b, c)       DTRACE_PROBE3(eventsrv, name, a, b, c)
+#define PROBE4(name, a, b, c, d)    DTRACE_PROBE4(eventsrv, name, a, b, c, d)
+#else
+#define PROBE2(name, a, b)          do { } while (0)
+#define PROBE3(name, a, b, c)       do { } while (0)
+#define PROBE4(name, a, b, c, d)    do { } while (0)
+#endif
+
+#endif // PROBES_H
@@ -1,5 +1,98 @@
 #include "protocol.h"
+#include "probes.h"
 #include <arpa/inet.h>
+#include <sys/uio.h>
+
+// Mốc thời gian cho trace (chỉ đo khi server bật trace)
+static int phase_timing = 0;
+static __thread uint64_t tls_receive_start_us = 0;
+static __thread uint64_t tls_send_start_us = 0;
+static __thread uint64_t tls_send_end_us = 0;
+
+static uint64_t phase_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void buffer_init(Buffer* buf) {
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+int buffer_reserve(Buffer* buf, size_t extra) {
+    size_t need = buf->len + extra + 1; // + '\0'
+    if (need <= buf->cap) return 0;
+    
+    size_t cap = buf->cap ? buf->cap : 256;
+    while (cap < need) cap *= 2;
+    
+    char* data = (char*)realloc(buf->data, cap);
+    if (data == NULL) {
+        fprintf(stderr, "[ERROR] Memory allocation failed for buffer\n");
+        return -1;
+    }
+    buf->data = data;
+    buf->cap = cap;
+    return 0;
+}
+
+int buffer_append(Buffer* buf, const char* data, size_t n) {
+    if (buffer_reserve(buf, n) < 0) return -1;
+    memcpy(buf->data + buf->len, data, n);
+    buf->len += n;
+    buf->data[buf->len] = '\0';
+    return 0;
+}
+
+int buffer_append_str(Buffer* buf, const char* s) {
+    return buffer_append(buf, s, strlen(s));
+}
+
+void buffer_reset(Buffer* buf) {
+    buf->len = 0;
+    if (buf->data) buf->data[0] = '\0';
+}
+
+void buffer_free(Buffer* buf) {
+    free(buf->data);
+    buffer_init(buf);
+}
+
+// Gửi hết các iovec (xử lý gửi thiếu)
+// MSG_NOSIGNAL: peer đã reset thì trả lỗi EPIPE thay vì SIGPIPE giết tiến trình
+static int send_iov(int sock, struct iovec* iov, int iovcnt) {
+    int total = 0;
+    
+    while (iovcnt > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iovcnt;
+        ssize_t n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0) {
+                perror("[ERROR] send failed");
+            }
+            return -1;
+        }
+        total += (int)n;
+        
+        // Bỏ qua phần đã gửi
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    
+    return total;
+}
 
 // Gửi chuỗi message qua socket
 int send_message(int sock, const char* message) {
@@ -17,6 +110,7 @@ int send_message(int sock, const char* message) {
         sent += n;
     }
     
+    PROBE2(send__message, sock, sent);
     return sent;
 }
 
@@ -41,10 +135,12 @@ int receive_message(int sock, char* buffer, int buffer_size) {
             if (bytes < 0) {
                 perror("[ERROR] recv failed");
             }
+            PROBE2(receive__message, sock, bytes);
             return bytes;
         }
         
         recv_buff[bytes] = '\0';
+        if (total_len == 0 && phase_timing) tls_receive_start_us = phase_now_us();
         
         int space_left = buffer_size - total_len - 1;
         if (space_left > 0) {
@@ -59,63 +155,100 @@ int receive_message(int sock, char* buffer, int buffer_size) {
         *delimiter = '\0';
     }
     
-    return strlen(buffer);
+    int len = strlen(buffer);
+    PROBE2(receive__message, sock, len);
+    return len;
 }
 
 // Parse request: COMMAND|FIELD1|FIELD2|... (cấp phát động)
+//   1 bản copy trên heap thay cho 2 buffer MAX_BUFFER trên stack (thread nào cũng gọi được)
 char** parse_request(const char* buffer, char* command, int* field_count) {
-    char temp[MAX_BUFFER];
-    strncpy(temp, buffer, MAX_BUFFER - 1);
-    temp[MAX_BUFFER - 1] = '\0';
-    
     *field_count = 0;
+    command[0] = '\0';
     
-    // Đếm số lượng fields trước
-    char temp2[MAX_BUFFER];
-    strcpy(temp2, temp);
-    char* token = strtok(temp2, "|");
-    if (token == NULL) {
-        command[0] = '\0';
+    char* temp = strndup(buffer, MAX_BUFFER - 1);
+    if (temp == NULL) {
+        fprintf(stderr, "[ERROR] Memory allocation failed for request copy\n");
         return NULL;
     }
     
+    // Số field tối đa = số dấu '|'
     int count = 0;
-    while (strtok(NULL, "|") != NULL) {
+    for (const char* p = temp; (p = strchr(p, '|')) != NULL; p++) {
         count++;
     }
     
-    // Cấp phát mảng con trỏ
-    char** fields = (char**)malloc(count * sizeof(char*));
-    if (fields == NULL) {
-        fprintf(stderr, "[ERROR] Memory allocation failed for fields array\n");
-        command[0] = '\0';
+    char* save = NULL;
+    char* token = strtok_r(temp, "|", &save);
+    if (token == NULL) {
+        free(temp);
         return NULL;
     }
     
-    // Parse lại để lấy dữ liệu
-    token = strtok(temp, "|");
-    
     // Token đầu tiên là command
     strncpy(command, token, MAX_COMMAND - 1);
     command[MAX_COMMAND - 1] = '\0';
     
+    // Cấp phát mảng con trỏ
+    char** fields = (char**)malloc((count > 0 ? count : 1) * sizeof(char*));
+    if (fields == NULL) {
+        fprintf(stderr, "[ERROR] Memory allocation failed for fields array\n");
+        command[0] = '\0';
+        free(temp);
+        return NULL;
+    }
+    
     // Các token còn lại là fields
     int i = 0;
-    while ((token = strtok(NULL, "|")) != NULL && i < count) {
-        fields[i] = (char*)malloc(strlen(token) + 1);
+    while (i < count && (token = strtok_r(NULL, "|", &save)) != NULL) {
+        fields[i] = strdup(token);
         if (fields[i] == NULL) {
             fprintf(stderr, "[ERROR] Memory allocation failed for field %d\n", i);
-            // Free các fields đã cấp phát
-            for (int j = 0; j < i; j++) {
-                free(fields[j]);
-            }
-            free(fields);
+            free_fields(fields, i);
+            free(temp);
             return NULL;
         }
-        strcpy(fields[i], token);
         i++;
     }
     
+    free(temp);
+    *field_count = i;
+    return fields;
+}
+
+// Parse request vào arena: tách tại chỗ trên bản copy (cùng quy tắc strtok: bỏ field rỗng)
+char** parse_request_arena(Arena* arena, const char* buffer, char* command, int* field_count) {
+    *field_count = 0;
+    command[0] = '\0';
+    
+    size_t len = strnlen(buffer, MAX_BUFFER - 1);
+    char* line = arena_strndup(arena, buffer, len);
+    if (line == NULL) return NULL;
+    
+    // Số field tối đa = số dấu '|'
+    int max_fields = 0;
+    for (const char* p = line; (p = strchr(p, '|')) != NULL; p++) {
+        max_fields++;
+    }
+    
+    char* save = NULL;
+    char* token = strtok_r(line, "|", &save);
+    if (token == NULL) return NULL;
+    strncpy(command, token, MAX_COMMAND - 1);
+    command[MAX_COMMAND - 1] = '\0';
+    
+    char** fields = (char**)arena_alloc(arena, (size_t)(max_fields > 0 ? max_fields : 1) * sizeof(char*));
+    if (fields == NULL) {
+        fprintf(stderr, "[ERROR] Memory allocation failed for fields array\n");
+        command[0] = '\0';
+        return NULL;
+    }
+    
+    int i = 0;
+    while (i < max_fields && (token = strtok_r(NULL, "|", &save)) != NULL) {
+        fields[i++] = token;
+    }
+    
     *field_count = i;
     return fields;
 }
@@ -176,31 +309,70 @@ int send_request(int sock, const char* command, const char** fields, int field_c
 
 // Gửi response (server)
 int send_response(int sock, int code, const char* message, const char* extra_data) {
-    // Tính kích thước cần thiết
-    int total_len = 50 + strlen(message); // code + | + message
-    if (extra_data != NULL) {
-        total_len += strlen(extra_data) + 1; // + | + extra_data
-    }
-    total_len += 3; // + \r\n\0
+    return send_response_data(sock, code, message, extra_data, extra_data ? strlen(extra_data) : 0);
+}
+
+// Mã response gần nhất của thread (server đếm metrics theo mã)
+static __thread int tls_last_response_code = 0;
+static __thread int tls_send_failed = 0;
+
+int protocol_take_response_code(void) {
+    int code = tls_last_response_code;
+    tls_last_response_code = 0;
+    return code;
+}
+
+int protocol_take_send_failed(void) {
+    int failed = tls_send_failed;
+    tls_send_failed = 0;
+    return failed;
+}
+
+void protocol_set_phase_timing(int enabled) {
+    phase_timing = enabled;
+}
+
+void protocol_mark_receive_start(void) {
+    if (phase_timing) tls_receive_start_us = phase_now_us();
+}
+
+void protocol_take_phase_times(uint64_t* receive_start, uint64_t* send_start, uint64_t* send_end) {
+    if (receive_start) *receive_start = tls_receive_start_us;
+    if (send_start) *send_start = tls_send_start_us;
+    if (send_end) *send_end = tls_send_end_us;
+    tls_send_start_us = tls_send_end_us = 0;
+}
+
+// Gửi response với extra_data có độ dài sẵn - không cấp phát, không copy payload
+int send_response_data(int sock, int code, const char* message, const char* extra_data, size_t extra_len) {
+    tls_last_response_code = code;
+    char code_buf[16];
+    int code_len = snprintf(code_buf, sizeof(code_buf), "%d|", code);
     
-    // Cấp phát buffer
-    char* buffer = (char*)malloc(total_len);
-    if (buffer == NULL) {
-        fprintf(stderr, "[ERROR] Memory allocation failed\n");
-        return -1;
+    // Format: CODE|MESSAGE|EXTRA_DATA\r\n (hoặc CODE|MESSAGE\r\n)
+    struct iovec iov[5];
+    int iovcnt = 0;
+    iov[iovcnt].iov_base = code_buf;
+    iov[iovcnt++].iov_len = (size_t)code_len;
+    iov[iovcnt].iov_base = (void*)message;
+    iov[iovcnt++].iov_len = strlen(message);
+    if (extra_data != NULL && extra_len > 0) {
+        iov[iovcnt].iov_base = "|";
+        iov[iovcnt++].iov_len = 1;
+        iov[iovcnt].iov_base = (void*)extra_data;
+        iov[iovcnt++].iov_len = extra_len;
     }
+    iov[iovcnt].iov_base = "\r\n";
+    iov[iovcnt++].iov_len = 2;
     
-    // Build response
-    if (extra_data != NULL && strlen(extra_data) > 0) {
-        snprintf(buffer, total_len, "%d|%s|%s\r\n", code, message, extra_data);
-    } else {
-        snprintf(buffer, total_len, "%d|%s\r\n", code, message);
+    uint64_t send_start = phase_timing ? phase_now_us() : 0;
+    int sent = send_iov(sock, iov, iovcnt);
+    if (sent < 0) tls_send_failed = 1;
+    if (send_start) {
+        tls_send_start_us = send_start;
+        tls_send_end_us = phase_now_us();
     }
-    
-    // Gửi
-    int sent = send_message(sock, buffer);
-    free(buffer);
-    
+    PROBE3(send__response, sock, code, sent);
     return sent;
 }
 
@@ -264,9 +436,18 @@ char* receive_response(int sock, int* code, char* message, int message_size) {
     return extra_data; 
 }
 static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+// File log mở 1 lần, giữ suốt đời tiến trình (không fopen/fclose mỗi response);
+// buffer stdio tĩnh => ghi log không gọi malloc
+static FILE* g_log_file = NULL;
+static char g_log_file_buf[BUFSIZ];
 
 // thread-local request: mỗi thread client giữ request riêng
 static __thread const char* tls_current_request = NULL;
+static ActivityLogHook g_activity_hook = NULL;
+
+void protocol_set_activity_log_hook(ActivityLogHook hook) {
+    g_activity_hook = hook;
+}
 
 void protocol_set_current_request_for_log(const char* request_line) {
     tls_current_request = request_line;
@@ -323,21 +504,34 @@ static void write_activity_log_line(int client_sock, const char* request, const
     sanitize_for_log(res_buf);
 
     pthread_mutex_lock(&g_log_mutex);
-    FILE* f = fopen(LOG_FILE_NAME, "a");
-    if (f) {
-        fprintf(f, "[%s]$%s$%s$%s\n", time_buf, ip, req_buf, res_buf);
-        fclose(f);
+    if (g_log_file == NULL) {
+        g_log_file = fopen(LOG_FILE_NAME, "a");
+        if (g_log_file) setvbuf(g_log_file, g_log_file_buf, _IOFBF, sizeof(g_log_file_buf));
+    }
+    if (g_log_file) {
+        fprintf(g_log_file, "[%s]$%s$%s$%s\n", time_buf, ip, req_buf, res_buf);
+        fflush(g_log_file);     // Mỗi dòng 1 write như khi còn fclose
     }
     pthread_mutex_unlock(&g_log_mutex);
+
+    if (g_activity_hook) {
+        g_activity_hook(client_sock, ip, req_buf, res_buf);
+    }
 }
 
 // Wrapper: gửi response rồi log
 int send_response_with_log(int client_sock, int code, const char* message, const char* extra_data) {
-    int sent = send_response(client_sock, code, message, extra_data);
+    return send_response_data_with_log(client_sock, code, message, extra_data,
+                                       extra_data ? strlen(extra_data) : 0);
+}
+
+int send_response_data_with_log(int client_sock, int code, const char* message, const char* extra_data, size_t extra_len) {
+    int sent = send_response_data(client_sock, code, message, extra_data, extra_len);
 
     char result[768];
-    if (extra_data && extra_data[0] != '\0') {
-        snprintf(result, sizeof(result), "%d|%s|%s", code, message ? message : "", extra_data);
+    if (extra_data && extra_len > 0) {
+        snprintf(result, sizeof(result), "%d|%s|%.*s", code, message ? message : "",
+                 (int)(extra_len < sizeof(result) ? extra_len : sizeof(result)), extra_data);
     } else {
         snprintf(result, sizeof(result), "%d|%s", code, message ? message : "");
     }
@@ -5,11 +5,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h> 
+#include <stdint.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <pthread.h>
+#include "arena.h"
 
 #define MAX_BUFFER 65536  // 64KB - Đủ lớn cho danh sách bạn bè, events, etc
 #define MAX_COMMAND 64
@@ -20,6 +22,15 @@
 #define MAX_SESSION_ID 64
 
 #define LOG_FILE_NAME "log_nhom3.txt"
+
+// Keyset pagination cho GET_EVENTS / GET_FRIENDS
+//   Request : CMD|session_id[|limit[|after]]  (không có limit => trả toàn bộ như cũ)
+//   Response: mỗi dòng 1 bản ghi, dòng cuối của extra là "next=<cursor>" (cursor rỗng nếu là trang cuối)
+//   Cursor  : GET_EVENTS "<event_time>,<event_id>", GET_FRIENDS "<username>,<user_id>"
+#define PAGE_DEFAULT_LIMIT 50
+#define PAGE_MAX_LIMIT 200      // limit lớn hơn sẽ bị giảm về giá trị này
+#define PAGE_CURSOR_SIZE 128
+#define PAGE_NEXT_PREFIX "next="
 // Command types
 #define CMD_REGISTER "REGISTER" 
 #define CMD_LOGIN "LOGIN"
@@ -39,6 +50,7 @@
 #define CMD_REJECT_FRIEND_REQUEST "REJECT_FRIEND_REQUEST"
 #define CMD_UNFRIEND "UNFRIEND"
 #define CMD_GET_EVENTS_CREBYUSER "GET_EVENTS_CREBYUSER"
+#define CMD_STATS "STATS"                 // Admin: số liệu server, chỉ nhận từ localhost
 
 // Response codes
 #define RESPONSE_OK 200
@@ -48,6 +60,24 @@
 #define RESPONSE_UNPROCESSABLE 422 // sai về định dạng mail, tên chứa kí tự đặc biệt
 #define RESPONSE_SERVER_ERROR 500
 #define RESPONSE_NOT_FOUND 404
+#define RESPONSE_SERVICE_UNAVAILABLE 503 // server quá tải tạm thời, client thử lại sau
+
+// Buffer động, dùng lại được giữa các request (VD: response buffer của mỗi kết nối)
+//   - data luôn kết thúc bằng '\0' (khi khác NULL)
+//   - buffer_reset() giữ lại vùng nhớ => request sau không phải cấp phát lại
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+void buffer_init(Buffer* buf);
+// Đảm bảo còn chỗ cho thêm extra byte (+ '\0'), trả về -1 nếu hết bộ nhớ
+int buffer_reserve(Buffer* buf, size_t extra);
+int buffer_append(Buffer* buf, const char* data, size_t n);
+int buffer_append_str(Buffer* buf, const char* s);
+void buffer_reset(Buffer* buf);
+void buffer_free(Buffer* buf);
 
 // Protocol functions - Xử lý protocol bằng chuỗi với cấp phát động
 
@@ -80,6 +110,24 @@ char* receive_response(int sock, int* code, char* message, int message_size);
 //   - Tự động free buffer sau khi gửi
 int send_response(int sock, int code, const char* message, const char* extra_data);
 
+// send_response_data: Giống send_response nhưng extra_data có độ dài sẵn (VD: Buffer.data/len)
+//   - Gửi CODE|MESSAGE|, extra_data và \r\n bằng 1 lời gọi writev, không copy
+int send_response_data(int sock, int code, const char* message, const char* extra_data, size_t extra_len);
+
+// Mã response gần nhất đã gửi trên thread hiện tại (0 nếu chưa gửi), đọc xong thì xóa
+int protocol_take_response_code(void);
+
+// 1 nếu có response gửi lỗi (peer đã đóng / reset) trên thread hiện tại từ lần đọc trước, đọc xong thì xóa
+int protocol_take_send_failed(void);
+
+// Mốc thời gian theo phase (CLOCK_MONOTONIC, micro giây) cho trace phía server, mặc định tắt
+//   receive_start: lúc nhận byte đầu tiên của request gần nhất
+//   send_start/send_end: quanh lần gửi response gần nhất (đọc xong thì xóa, 0 nếu chưa gửi)
+void protocol_set_phase_timing(int enabled);
+void protocol_take_phase_times(uint64_t* receive_start, uint64_t* send_start, uint64_t* send_end);
+// Server đọc socket không qua receive_message (reactor): đánh dấu receive_start = bây giờ
+void protocol_mark_receive_start(void);
+
 // parse_request: Parse chuỗi request thành command và fields (cấp phát động)
 //   - Format input: COMMAND|FIELD1|FIELD2|...
 //   - Tự động cấp phát mảng fields động (không giới hạn số lượng)
@@ -90,9 +138,21 @@ char** parse_request(const char* buffer, char* command, int* field_count);
 // free_fields: Giải phóng mảng fields được cấp phát từ parse_request
 void free_fields(char** fields, int field_count);
 
+// parse_request_arena: Giống parse_request nhưng mảng fields và các field nằm trong arena
+//   - 1 lần copy request + 1 mảng con trỏ, không dùng buffer tạm trên stack
+//   - Không gọi free_fields: vùng nhớ được thu hồi khi arena_reset()
+char** parse_request_arena(Arena* arena, const char* buffer, char* command, int* field_count);
+
 // Set request hiện tại (để log dòng này khi trả response)
 void protocol_set_current_request_for_log(const char* request_line);
 
+// Hook nhận từng dòng activity log (sau khi ghi file), VD: server đẩy thêm vào DB
+//   - request/result đã được cắt ngắn và bỏ ký tự xuống dòng
+//   - Gọi trên thread gửi response, không được chặn lâu
+typedef void (*ActivityLogHook)(int client_sock, const char* ip, const char* request, const char* result);
+void protocol_set_activity_log_hook(ActivityLogHook hook);
+
 // Send response + ghi log ra file log_nhom3.txt
 int send_response_with_log(int client_sock, int code, const char* message, const char* extra_data);
+int send_response_data_with_log(int client_sock, int code, const char* message, const char* extra_data, size_t extra_len);
 #endif 
\ No newline at end of file
@@ -0,0 +1,157 @@
+-- =========================================
+-- EXPLAIN regression: truy vấn nóng trên events / event_participants không được Seq Scan
+-- =========================================
+-- Chạy: make explain-check (nạp schema.sql vào DB thử EXPLAIN_DB rồi chạy file này)
+--   - Seed 10k users, 1M events, 2M event_participants bằng generate_series trong 1 transaction,
+--     ANALYZE, EXPLAIN (FORMAT JSON) từng truy vấn, cuối cùng ROLLBACK => DB không đổi
+--   - Có Seq Scan trên events / event_participants => RAISE EXCEPTION, psql thoát với mã lỗi
+--   - SQL giữ đồng bộ với server/postgres_db.c (tham số $n thay bằng giá trị cụ thể:
+--     server gửi qua PQexecParams không tên nên planner cũng thấy giá trị thật)
+\set ON_ERROR_STOP on
+\set users 10000
+\set events 1000000
+
+BEGIN;
+
+-- Seed không đi qua trigger (tạo participant / NOTIFY từng dòng): ghi thẳng cả 2 bảng
+ALTER TABLE events DISABLE TRIGGER USER;
+ALTER TABLE event_participants DISABLE TRIGGER USER;
+
+INSERT INTO users (username, password, email)
+SELECT 'explain_u' || g, 'x', 'explain_u' || g || '@explain.test'
+FROM generate_series(1, :users) g;
+
+SELECT min(user_id) AS u0 FROM users WHERE username LIKE 'explain\_u%' \gset
+
+-- Event g thuộc user (g % users), cứ 2 event có 1 private
+INSERT INTO events (creator_id, title, location, event_time, event_type)
+SELECT :u0 + g % :users, 'event ' || g, 'room ' || g % 100,
+       TIMESTAMP '2025-01-01' + g * INTERVAL '1 minute',
+       CASE WHEN g % 2 = 0 THEN 'public' ELSE 'private' END
+FROM generate_series(1, :events) g;
+
+-- Creator + 1 người tham gia khác
+INSERT INTO event_participants (event_id, user_id, role)
+SELECT event_id, creator_id, 'creator' FROM events
+UNION ALL
+SELECT event_id, :u0 + (creator_id - :u0 + 1 + event_id % 97) % :users, 'participant' FROM events;
+
+ANALYZE users;
+ANALYZE events;
+ANALYZE event_participants;
+
+-- User và event dùng cho các truy vấn
+SELECT :u0 + 42 AS uid \gset
+SELECT max(event_id) AS eid FROM events WHERE creator_id = :uid \gset
+
+-- EXPLAIN 1 truy vấn, trả về 1 nếu có Seq Scan trên events / event_participants
+CREATE FUNCTION pg_temp.explain_check(name TEXT, sql TEXT) RETURNS INTEGER AS $$
+DECLARE
+    plan JSONB;
+    scans TEXT;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || sql INTO plan;
+    SELECT string_agg(DISTINCT node->>'Relation Name', ', ') INTO scans
+    FROM jsonb_path_query(plan, 'strict $.**') node
+    WHERE jsonb_typeof(node) = 'object'
+      AND node->>'Node Type' = 'Seq Scan'
+      AND node->>'Relation Name' IN ('events', 'event_participants');
+    IF scans IS NOT NULL THEN
+        RAISE WARNING 'FAIL %: Seq Scan on %', name, scans;
+        RETURN 1;
+    END IF;
+    RAISE NOTICE 'ok   %', name;
+    RETURN 0;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TEMP TABLE explain_results (name TEXT, failed INTEGER);
+
+-- db_get_user_events (UNION creator / participant), toàn bộ - trang đầu - trang sau
+INSERT INTO explain_results SELECT 'get_user_events', pg_temp.explain_check('get_user_events', format($q$
+    SELECT * FROM (
+      (SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM events e
+       WHERE e.creator_id = %1$s)
+      UNION
+      (SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM event_participants ep
+       JOIN events e ON e.event_id = ep.event_id
+       WHERE ep.user_id = %1$s)
+    ) ue ORDER BY event_time, event_id $q$, :uid));
+
+INSERT INTO explain_results SELECT 'get_user_events_first', pg_temp.explain_check('get_user_events_first', format($q$
+    SELECT * FROM (
+      (SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM events e
+       WHERE e.creator_id = %1$s ORDER BY e.event_time, e.event_id LIMIT 20)
+      UNION
+      (SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM event_participants ep
+       JOIN events e ON e.event_id = ep.event_id
+       WHERE ep.user_id = %1$s ORDER BY e.event_time, e.event_id LIMIT 20)
+    ) ue ORDER BY event_time, event_id LIMIT 20 $q$, :uid));
+
+INSERT INTO explain_results SELECT 'get_user_events_after', pg_temp.explain_check('get_user_events_after', format($q$
+    SELECT * FROM (
+      (SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM events e
+       WHERE e.creator_id = %1$s AND (e.event_time, e.event_id) > ('2025-06-01'::timestamp, 0)
+       ORDER BY e.event_time, e.event_id LIMIT 20)
+      UNION
+      (SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM event_participants ep
+       JOIN events e ON e.event_id = ep.event_id
+       WHERE ep.user_id = %1$s AND (e.event_time, e.event_id) > ('2025-06-01'::timestamp, 0)
+       ORDER BY e.event_time, e.event_id LIMIT 20)
+    ) ue ORDER BY event_time, event_id LIMIT 20 $q$, :uid));
+
+-- db_get_user_events_crebyuser
+INSERT INTO explain_results SELECT 'get_user_events_crebyuser', pg_temp.explain_check('get_user_events_crebyuser', format($q$
+    SELECT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status FROM events e
+    WHERE e.creator_id = %s ORDER BY e.event_time, e.event_id $q$, :uid));
+
+-- db_get_event_detail_by_creator
+INSERT INTO explain_results SELECT 'get_event_detail_by_creator', pg_temp.explain_check('get_event_detail_by_creator', format($q$
+    SELECT event_id, title, COALESCE(description,''), COALESCE(location,''), event_time::text, event_type, status
+    FROM events WHERE creator_id = %s AND event_id = %s $q$, :uid, :eid));
+
+-- db_send_event_invitation: event + kiểm tra người tham gia (cũng dùng trong db_create_join_request)
+INSERT INTO explain_results SELECT 'invitation_event', pg_temp.explain_check('invitation_event', format($q$
+    SELECT creator_id, status FROM events WHERE event_id = %s $q$, :eid));
+
+INSERT INTO explain_results SELECT 'is_participant', pg_temp.explain_check('is_participant', format($q$
+    SELECT 1 FROM event_participants WHERE event_id = %s AND user_id = %s $q$, :eid, :uid));
+
+-- db_update_event / db_delete_event (EXPLAIN không chạy câu lệnh)
+INSERT INTO explain_results SELECT 'update_event', pg_temp.explain_check('update_event', format($q$
+    WITH upd AS (
+      UPDATE events SET title = 't', description = 'd', location = 'l',
+                        event_time = '2025-06-01 10:00', event_type = 'public'
+      WHERE creator_id = %s AND event_id = %s RETURNING event_id
+    )
+    SELECT ep.user_id FROM upd LEFT JOIN event_participants ep ON ep.event_id = upd.event_id $q$, :uid, :eid));
+
+INSERT INTO explain_results SELECT 'delete_event', pg_temp.explain_check('delete_event', format($q$
+    WITH del AS (
+      DELETE FROM events WHERE creator_id = %1$s AND event_id = %2$s RETURNING event_id
+    ), members AS (
+      SELECT user_id FROM event_participants WHERE event_id = %2$s
+    )
+    SELECT m.user_id FROM del LEFT JOIN members m ON TRUE $q$, :uid, :eid));
+
+-- db_create_join_request / db_approve_join_request_by_creator
+INSERT INTO explain_results SELECT 'join_request_event', pg_temp.explain_check('join_request_event', format($q$
+    SELECT event_type FROM events WHERE event_id = %s AND status = 'active' $q$, :eid));
+
+INSERT INTO explain_results SELECT 'accept_join_event', pg_temp.explain_check('accept_join_event', format($q$
+    SELECT 1 FROM events WHERE event_id = %s AND creator_id = %s AND status = 'active' $q$, :eid, :uid));
+
+-- Tổng kết: có truy vấn lỗi => exception (psql thoát khác 0), transaction bị hủy
+DO $$
+DECLARE
+    failed INTEGER;
+BEGIN
+    SELECT sum(r.failed) INTO failed FROM explain_results r;
+    IF failed > 0 THEN
+        RAISE EXCEPTION 'EXPLAIN regression: % query plan(s) scan events / event_participants', failed;
+    END IF;
+    RAISE NOTICE 'EXPLAIN regression: all % query plans use indexes', (SELECT count(*) FROM explain_results);
+END;
+$$;
+
+ROLLBACK;
@@ -8,6 +8,7 @@ DROP TABLE IF EXISTS event_join_requests CASCADE;
 DROP TABLE IF EXISTS event_invitations CASCADE;
 DROP TABLE IF EXISTS event_participants CASCADE;
 DROP TABLE IF EXISTS events CASCADE;
+DROP TABLE IF EXISTS friend_edges CASCADE;
 DROP TABLE IF EXISTS friendships CASCADE;
 DROP TABLE IF EXISTS friend_requests CASCADE;
 DROP TABLE IF EXISTS activity_logs CASCADE;
@@ -28,6 +29,8 @@ CREATE TABLE users (
 -- Index cho tìm kiếm nhanh
 CREATE INDEX idx_users_username ON users(username);
 CREATE INDEX idx_users_email ON users(email);
+-- Keyset pagination GET_FRIENDS: ORDER BY (username, user_id)
+CREATE INDEX idx_users_username_id ON users(username, user_id);
 
 -- =========================================
 -- 2. FRIEND_REQUESTS TABLE - Lời mời kết bạn
@@ -59,6 +62,18 @@ CREATE TABLE friendships (
 CREATE INDEX idx_friendships_user1 ON friendships(user1_id);
 CREATE INDEX idx_friendships_user2 ON friendships(user2_id);
 
+-- Bảng kề 2 chiều: mỗi friendship có 2 dòng (a -> b) và (b -> a), do trigger duy trì
+-- => "bạn bè của X" là 1 range scan trên PRIMARY KEY (user_id, friend_id),
+--    không cần OR / LEAST / GREATEST / UNION trên friendships
+-- KHÔNG ghi trực tiếp vào bảng này, chỉ ghi friendships
+CREATE TABLE friend_edges (
+    user_id INTEGER NOT NULL REFERENCES users(user_id) ON DELETE CASCADE,
+    friend_id INTEGER NOT NULL REFERENCES users(user_id) ON DELETE CASCADE,
+    friendship_id INTEGER NOT NULL REFERENCES friendships(friendship_id) ON DELETE CASCADE,
+    created_at TIMESTAMP,
+    PRIMARY KEY (user_id, friend_id)
+);
+
 -- =========================================
 -- 4. EVENTS TABLE - Quản lý sự kiện
 -- =========================================
@@ -75,6 +90,10 @@ CREATE TABLE events (
     updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP -- Thời gian cập nhật sự kiện
 );
 
+-- Sự kiện do user tạo, theo thứ tự keyset (event_time, event_id):
+-- GET_EVENTS (nhánh creator), GET_EVENTS_CREBYUSER, UPDATE/DELETE_EVENT, ON DELETE CASCADE từ users
+CREATE INDEX idx_events_creator_time ON events(creator_id, event_time, event_id);
+
 -- =========================================
 -- 5. EVENT_PARTICIPANTS TABLE - Người tham gia sự kiện
 -- =========================================
@@ -88,7 +107,10 @@ CREATE TABLE event_participants (
 );
 
 CREATE INDEX idx_event_participants_event ON event_participants(event_id);
-CREATE INDEX idx_event_participants_user ON event_participants(user_id);
+-- (user_id, event_id): nhánh "sự kiện tham gia" của GET_EVENTS là range scan trên index này
+-- rồi join events theo khóa chính (không index-only: cột hiển thị nằm ở events)
+-- Kiểm tra plan: make explain-check (database/explain_regression.sql)
+CREATE INDEX idx_event_participants_user ON event_participants(user_id, event_id);
 
 -- =========================================
 -- 6. EVENT_INVITATIONS TABLE - Lời mời tham gia sự kiện
@@ -126,18 +148,29 @@ CREATE INDEX idx_event_join_requests_user ON event_join_requests(user_id);
 -- =========================================
 -- 8. ACTIVITY_LOGS TABLE - Ghi log hoạt động
 -- =========================================
+-- Phân vùng theo ngày trên created_at (activity_logs_pYYYYMMDD)
+--   - Partition được tạo trước và xóa theo retention bằng activity_logs_maintain()
+--     (server gọi định kỳ, xem server/activity_log.h) => không cần DELETE log cũ
+--   - Index chỉ nằm trên từng partition nhỏ => chi phí ghi không tăng theo thời gian
 CREATE TABLE activity_logs (
-    log_id SERIAL PRIMARY KEY,
+    log_id BIGSERIAL,
     user_id INTEGER REFERENCES users(user_id) ON DELETE SET NULL,
     action VARCHAR(100) NOT NULL,  -- 'login', 'logout', 'create_event', 'send_friend_request', etc.
     details TEXT,  -- JSON hoặc text mô tả chi tiết
     ip_address VARCHAR(45),  -- Hỗ trợ IPv6
-    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-);
+    created_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (log_id, created_at)
+) PARTITION BY RANGE (created_at);
+
+-- Dòng không có partition tương ứng (VD: maintenance chưa chạy) vẫn ghi được
+--   - activity_logs_create_partitions() chuyển dòng của ngày sắp tạo partition ra khỏi đây
+--   - activity_logs_drop_partitions() xóa dòng quá retention theo created_at
+CREATE TABLE activity_logs_default PARTITION OF activity_logs DEFAULT;
 
 CREATE INDEX idx_activity_logs_user ON activity_logs(user_id);
 CREATE INDEX idx_activity_logs_action ON activity_logs(action);
-CREATE INDEX idx_activity_logs_time ON activity_logs(created_at);
+-- Dữ liệu ghi theo thứ tự thời gian => BRIN nhỏ và rẻ hơn B-tree
+CREATE INDEX idx_activity_logs_time ON activity_logs USING BRIN (created_at);
 
 -- =========================================
 -- VIEWS - Các view tiện ích
@@ -146,24 +179,14 @@ CREATE INDEX idx_activity_logs_time ON activity_logs(created_at);
 -- View: Danh sách bạn bè của user
 CREATE OR REPLACE VIEW user_friends AS
 SELECT 
-    f.friendship_id,
-    f.user1_id as user_id,
-    f.user2_id as friend_id,
-    u.username as friend_username,
-    u.email as friend_email,
-    f.created_at
-FROM friendships f
-JOIN users u ON f.user2_id = u.user_id
-UNION ALL
-SELECT 
-    f.friendship_id,
-    f.user2_id as user_id,
-    f.user1_id as friend_id,
+    fe.friendship_id,
+    fe.user_id,
+    fe.friend_id,
     u.username as friend_username,
     u.email as friend_email,
-    f.created_at
-FROM friendships f
-JOIN users u ON f.user1_id = u.user_id;
+    fe.created_at
+FROM friend_edges fe
+JOIN users u ON fe.friend_id = u.user_id;
 
 -- View: Danh sách sự kiện của user
 CREATE OR REPLACE VIEW user_events AS
@@ -192,12 +215,94 @@ CREATE OR REPLACE FUNCTION are_friends(uid1 INTEGER, uid2 INTEGER)
 RETURNS BOOLEAN AS $$
 BEGIN
     RETURN EXISTS (
-        SELECT 1 FROM friendships 
-        WHERE (user1_id = LEAST(uid1, uid2) AND user2_id = GREATEST(uid1, uid2))
+        SELECT 1 FROM friend_edges
+        WHERE user_id = uid1 AND friend_id = uid2
     );
 END;
 $$ LANGUAGE plpgsql;
 
+-- Function: Tạo partition activity_logs cho hôm nay và days_ahead ngày tới
+--   Dòng của ngày đó đã nằm trong activity_logs_default thì được chuyển sang partition mới
+--   (PostgreSQL không cho tạo partition khi DEFAULT đang giữ dòng thuộc khoảng của nó)
+-- return: số partition mới tạo
+CREATE OR REPLACE FUNCTION activity_logs_create_partitions(days_ahead INTEGER)
+RETURNS INTEGER AS $$
+DECLARE
+    d DATE;
+    part TEXT;
+    created INTEGER := 0;
+BEGIN
+    FOR i IN 0..days_ahead LOOP
+        d := CURRENT_DATE + i;
+        part := 'activity_logs_p' || to_char(d, 'YYYYMMDD');
+        CONTINUE WHEN to_regclass(part) IS NOT NULL;
+        BEGIN
+            -- Chặn ghi vào DEFAULT trong lúc chuyển (lock giữ đến hết transaction)
+            LOCK TABLE activity_logs_default IN EXCLUSIVE MODE;
+            IF EXISTS (SELECT 1 FROM activity_logs_default
+                       WHERE created_at >= d AND created_at < d + 1) THEN
+                CREATE TEMP TABLE activity_logs_moving (LIKE activity_logs);
+                WITH moved AS (
+                    DELETE FROM activity_logs_default
+                    WHERE created_at >= d AND created_at < d + 1
+                    RETURNING *
+                )
+                INSERT INTO activity_logs_moving SELECT * FROM moved;
+            END IF;
+
+            EXECUTE format('CREATE TABLE %I PARTITION OF activity_logs FOR VALUES FROM (%L) TO (%L)',
+                           part, d::TIMESTAMP, (d + 1)::TIMESTAMP);
+            created := created + 1;
+
+            IF to_regclass('pg_temp.activity_logs_moving') IS NOT NULL THEN
+                INSERT INTO activity_logs SELECT * FROM activity_logs_moving;
+                DROP TABLE activity_logs_moving;
+            END IF;
+        EXCEPTION WHEN OTHERS THEN
+            -- Lỗi thì cả khối được rollback: dòng vẫn ở activity_logs_default, lần sau thử lại
+            RAISE WARNING 'activity_logs: cannot create partition %: %', part, SQLERRM;
+        END;
+    END LOOP;
+    RETURN created;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Function: Xóa partition activity_logs cũ hơn retention_days ngày (DROP thay cho DELETE)
+--   activity_logs_default không DROP được: xóa dòng quá hạn theo created_at
+-- return: số partition đã xóa
+CREATE OR REPLACE FUNCTION activity_logs_drop_partitions(retention_days INTEGER)
+RETURNS INTEGER AS $$
+DECLARE
+    r RECORD;
+    dropped INTEGER := 0;
+BEGIN
+    FOR r IN
+        SELECT c.relname
+        FROM pg_inherits i
+        JOIN pg_class c ON c.oid = i.inhrelid
+        WHERE i.inhparent = 'activity_logs'::regclass
+          AND c.relname ~ '^activity_logs_p[0-9]{8}$'
+          AND to_date(substring(c.relname FROM 16), 'YYYYMMDD') < CURRENT_DATE - retention_days
+    LOOP
+        EXECUTE format('DROP TABLE %I', r.relname);
+        dropped := dropped + 1;
+    END LOOP;
+
+    DELETE FROM activity_logs_default WHERE created_at < CURRENT_DATE - retention_days;
+    RETURN dropped;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Function: Bảo trì activity_logs (nhiều server_app gọi cùng lúc cũng an toàn)
+CREATE OR REPLACE FUNCTION activity_logs_maintain(days_ahead INTEGER, retention_days INTEGER)
+RETURNS VOID AS $$
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('activity_logs_maintain'));
+    PERFORM activity_logs_create_partitions(days_ahead);
+    PERFORM activity_logs_drop_partitions(retention_days);
+END;
+$$ LANGUAGE plpgsql;
+
 -- =========================================
 -- TRIGGERS
 -- =========================================
@@ -231,3 +336,128 @@ AFTER INSERT ON events
 FOR EACH ROW
 EXECUTE FUNCTION add_creator_to_participants();
 
+-- Trigger: Đồng bộ friend_edges (2 chiều) theo friendships
+CREATE OR REPLACE FUNCTION sync_friend_edges()
+RETURNS TRIGGER AS $$
+BEGIN
+    IF TG_OP IN ('UPDATE', 'DELETE') THEN
+        DELETE FROM friend_edges
+        WHERE (user_id = OLD.user1_id AND friend_id = OLD.user2_id)
+           OR (user_id = OLD.user2_id AND friend_id = OLD.user1_id);
+    END IF;
+    IF TG_OP IN ('INSERT', 'UPDATE') THEN
+        INSERT INTO friend_edges (user_id, friend_id, friendship_id, created_at)
+        VALUES (NEW.user1_id, NEW.user2_id, NEW.friendship_id, NEW.created_at),
+               (NEW.user2_id, NEW.user1_id, NEW.friendship_id, NEW.created_at);
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER trigger_sync_friend_edges
+AFTER INSERT OR UPDATE OR DELETE ON friendships
+FOR EACH ROW
+EXECUTE FUNCTION sync_friend_edges();
+
+-- =========================================
+-- CACHE INVALIDATION (LISTEN/NOTIFY)
+-- Mỗi server_app giữ 1 kết nối LISTEN cache_invalidation và xóa cache tương ứng
+-- Payload:
+--   user:<user_id>:<username>   -> user cache
+--   friends:<id>,<id>,...       -> friend list cache của các user
+--   events:<id>,<id>,...        -> event list cache của các user
+--   friends:* / events:*        -> xóa toàn bộ cache loại đó
+-- NOTIFY chỉ được gửi khi transaction COMMIT
+-- =========================================
+
+-- Payload NOTIFY tối đa ~8000 byte, danh sách dài thì xóa toàn bộ
+CREATE OR REPLACE FUNCTION notify_cache_invalidation(kind TEXT, ids TEXT)
+RETURNS VOID AS $$
+BEGIN
+    IF ids IS NULL OR length(ids) > 7000 THEN
+        PERFORM pg_notify('cache_invalidation', kind || ':*');
+    ELSE
+        PERFORM pg_notify('cache_invalidation', kind || ':' || ids);
+    END IF;
+END;
+$$ LANGUAGE plpgsql;
+
+-- Trigger: users thay đổi (status, email, username, xóa)
+CREATE OR REPLACE FUNCTION notify_users_change()
+RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM pg_notify('cache_invalidation', 'user:' || OLD.user_id || ':' || OLD.username);
+    -- username/email nằm trong payload danh sách bạn bè của người khác
+    IF TG_OP = 'DELETE' OR NEW.username IS DISTINCT FROM OLD.username
+       OR NEW.email IS DISTINCT FROM OLD.email THEN
+        PERFORM pg_notify('cache_invalidation', 'friends:*');
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER trigger_notify_users_change
+AFTER UPDATE OR DELETE ON users
+FOR EACH ROW
+EXECUTE FUNCTION notify_users_change();
+
+-- Trigger: kết bạn / hủy kết bạn
+CREATE OR REPLACE FUNCTION notify_friendships_change()
+RETURNS TRIGGER AS $$
+DECLARE
+    r RECORD;
+BEGIN
+    IF TG_OP = 'DELETE' THEN r := OLD; ELSE r := NEW; END IF;
+    PERFORM notify_cache_invalidation('friends', r.user1_id || ',' || r.user2_id);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER trigger_notify_friendships_change
+AFTER INSERT OR UPDATE OR DELETE ON friendships
+FOR EACH ROW
+EXECUTE FUNCTION notify_friendships_change();
+
+-- Trigger: sửa / xóa event -> mọi người tham gia
+-- (INSERT và cascade DELETE được báo qua trigger của event_participants)
+CREATE OR REPLACE FUNCTION notify_events_change()
+RETURNS TRIGGER AS $$
+BEGIN
+    IF TG_OP = 'DELETE' THEN
+        PERFORM notify_cache_invalidation('events', OLD.creator_id::TEXT);
+    ELSE
+        PERFORM notify_cache_invalidation('events',
+            (SELECT string_agg(DISTINCT u::TEXT, ',')
+             FROM (SELECT user_id AS u FROM event_participants WHERE event_id = NEW.event_id
+                   UNION SELECT OLD.creator_id UNION SELECT NEW.creator_id) AS members));
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER trigger_notify_events_change
+AFTER UPDATE OR DELETE ON events
+FOR EACH ROW
+EXECUTE FUNCTION notify_events_change();
+
+-- Trigger: tham gia / rời event
+CREATE OR REPLACE FUNCTION notify_event_participants_change()
+RETURNS TRIGGER AS $$
+BEGIN
+    IF TG_OP IN ('UPDATE', 'DELETE') THEN
+        PERFORM notify_cache_invalidation('events', OLD.user_id::TEXT);
+    END IF;
+    IF TG_OP IN ('INSERT', 'UPDATE') THEN
+        PERFORM notify_cache_invalidation('events', NEW.user_id::TEXT);
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER trigger_notify_event_participants_change
+AFTER INSERT OR UPDATE OR DELETE ON event_participants
+FOR EACH ROW
+EXECUTE FUNCTION notify_event_participants_change();
+
+-- Partition ban đầu cho activity_logs
+SELECT activity_logs_maintain(7, 30);
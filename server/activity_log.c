@@ -0,0 +1,353 @@
+#include "activity_log.h"
+#include "../common/protocol.h"
+#include <libpq-fe.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#define ACTIVITY_ACTION_MAX 100   // activity_logs.action VARCHAR(100) (số ký tự)
+#define ACTIVITY_IP_MAX 45        // activity_logs.ip_address VARCHAR(45)
+#define UTF8_REPLACEMENT "\xEF\xBF\xBD"   // U+FFFD thay cho byte không hợp lệ
+
+#define ACTIVITY_COPY_SQL \
+    "COPY activity_logs (user_id, action, details, ip_address, created_at) FROM STDIN"
+
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static Buffer pending;            // Các dòng COPY (text format) chờ gửi
+static int pending_count = 0;
+static unsigned long dropped = 0;
+static int batch_size = ACTIVITY_LOG_BATCH;
+static int flush_ms = ACTIVITY_LOG_FLUSH_MS;
+static int shipper_running = 0;
+static int shipper_stop = 0;
+static pthread_t shipper_thread;
+static char* shipper_conninfo = NULL;
+
+// Độ dài chuỗi UTF-8 hợp lệ bắt đầu tại s (n byte còn lại), 0 nếu không hợp lệ
+// (như PostgreSQL: không nhận overlong, surrogate, > U+10FFFF)
+static size_t utf8_sequence_len(const unsigned char* s, size_t n) {
+    unsigned char c = s[0];
+    if (c < 0x80) return 1;
+
+    size_t len;
+    unsigned char lo = 0x80, hi = 0xBF;     // Khoảng hợp lệ của byte thứ 2
+    if (c >= 0xC2 && c <= 0xDF) {
+        len = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+    if (n < len || s[1] < lo || s[1] > hi) return 0;
+    for (size_t i = 2; i < len; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+    }
+    return len;
+}
+
+/**
+ * Chức năng: Ghi 1 field theo COPY text format (escape '\\', tab, xuống dòng; NULL => \N)
+ * - Dữ liệu từ client có thể không phải UTF-8: byte không hợp lệ thay bằng U+FFFD
+ *   (1 dòng lỗi encoding làm hỏng cả lệnh COPY)
+ * - Cắt theo ký tự, không cắt giữa 1 ký tự nhiều byte
+ * @param max_chars  Số ký tự tối đa (VARCHAR(n)), (size_t)-1 = không giới hạn
+ */
+static int append_copy_field(Buffer* b, const char* s, size_t max_chars) {
+    if (!s) return buffer_append(b, "\\N", 2);
+
+    const unsigned char* in = (const unsigned char*)s;
+    size_t n = strlen(s);
+    // Mỗi byte vào ra tối đa 3 byte (U+FFFD)
+    if (buffer_reserve(b, n * 3) < 0) return -1;
+
+    char* p = b->data + b->len;
+    for (size_t i = 0, chars = 0; i < n && chars < max_chars; chars++) {
+        size_t len = utf8_sequence_len(in + i, n - i);
+        if (len == 0) {
+            memcpy(p, UTF8_REPLACEMENT, 3);
+            p += 3;
+            i++;
+            continue;
+        }
+        if (len > 1) {
+            memcpy(p, in + i, len);
+            p += len;
+            i += len;
+            continue;
+        }
+        unsigned char ch = in[i++];
+        switch (ch) {
+            case '\\': *p++ = '\\'; *p++ = '\\'; break;
+            case '\t': *p++ = '\\'; *p++ = 't'; break;
+            case '\n': *p++ = '\\'; *p++ = 'n'; break;
+            case '\r': *p++ = '\\'; *p++ = 'r'; break;
+            default: *p++ = (char)ch; break;
+        }
+    }
+    *p = '\0';
+    b->len = (size_t)(p - b->data);
+    return 0;
+}
+
+void activity_log_record(int user_id, const char* action, const char* details, const char* ip) {
+    if (!action) return;
+
+    // created_at lấy lúc xảy ra, không phải lúc COPY
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    struct tm tm_now;
+    localtime_r(&tv.tv_sec, &tm_now);
+    char ts[40];
+    size_t ts_len = strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tm_now);
+    snprintf(ts + ts_len, sizeof(ts) - ts_len, ".%06ld", (long)tv.tv_usec);
+
+    char uid[20];
+    if (user_id > 0) snprintf(uid, sizeof(uid), "%d", user_id);
+
+    pthread_mutex_lock(&log_mutex);
+    if (!shipper_running || pending_count >= ACTIVITY_LOG_MAX_PENDING) {
+        if (shipper_running) dropped++;
+        pthread_mutex_unlock(&log_mutex);
+        return;
+    }
+
+    size_t start = pending.len;
+    int rc = 0;
+    rc |= user_id > 0 ? buffer_append_str(&pending, uid) : buffer_append(&pending, "\\N", 2);
+    rc |= buffer_append(&pending, "\t", 1);
+    rc |= append_copy_field(&pending, action, ACTIVITY_ACTION_MAX);
+    rc |= buffer_append(&pending, "\t", 1);
+    rc |= append_copy_field(&pending, details, (size_t)-1);
+    rc |= buffer_append(&pending, "\t", 1);
+    rc |= append_copy_field(&pending, ip, ACTIVITY_IP_MAX);
+    rc |= buffer_append(&pending, "\t", 1);
+    rc |= buffer_append_str(&pending, ts);
+    rc |= buffer_append(&pending, "\n", 1);
+
+    if (rc < 0) {
+        // Bỏ dòng ghi dở
+        pending.len = start;
+        if (pending.data) pending.data[start] = '\0';
+        dropped++;
+    } else if (++pending_count == batch_size) {
+        pthread_cond_signal(&log_cond);
+    }
+    pthread_mutex_unlock(&log_mutex);
+}
+
+// Gửi các dòng COPY trong data[0..len) bằng 1 lệnh COPY FROM STDIN, return 0 nếu thành công
+static int copy_rows(PGconn* c, const char* data, size_t len) {
+    PGresult* res = PQexec(c, ACTIVITY_COPY_SQL);
+    if (PQresultStatus(res) != PGRES_COPY_IN) {
+        fprintf(stderr, "[ACTIVITY_LOG] COPY failed: %s", PQerrorMessage(c));
+        PQclear(res);
+        return -1;
+    }
+    PQclear(res);
+
+    int ok = PQputCopyData(c, data, (int)len) == 1;
+    if (PQputCopyEnd(c, ok ? NULL : "client error") != 1) ok = 0;
+
+    while ((res = PQgetResult(c)) != NULL) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            fprintf(stderr, "[ACTIVITY_LOG] COPY failed: %s", PQerrorMessage(c));
+            ok = 0;
+        }
+        PQclear(res);
+    }
+    return ok ? 0 : -1;
+}
+
+/**
+ * Chức năng: COPY rows dòng trong data; lệnh COPY lỗi (1 dòng hỏng làm hỏng cả lệnh) thì chia đôi
+ *            và COPY lại từng nửa, tới khi chỉ bỏ đúng các dòng lỗi
+ * @return số dòng bị bỏ (mất kết nối: bỏ mọi dòng chưa ghi được)
+ */
+static int copy_batch(PGconn* c, const char* data, size_t len, int rows) {
+    if (copy_rows(c, data, len) == 0) return 0;
+    if (PQstatus(c) != CONNECTION_OK) return rows;
+    if (rows == 1) return 1;
+
+    // Mỗi dòng kết thúc bằng '\n' (dữ liệu đã escape)
+    int half = rows / 2;
+    const char* split = data;
+    for (int i = 0; i < half; i++) split = (const char*)memchr(split, '\n', len - (size_t)(split - data)) + 1;
+    size_t first_len = (size_t)(split - data);
+
+    int dropped_rows = copy_batch(c, data, first_len, half);
+    if (PQstatus(c) != CONNECTION_OK) return dropped_rows + (rows - half);
+    return dropped_rows + copy_batch(c, split, len - first_len, rows - half);
+}
+
+// Tạo partition sắp tới, xóa partition hết hạn
+static void maintain_partitions(PGconn* c) {
+    char ahead[12], retention[12];
+    snprintf(ahead, sizeof(ahead), "%d", ACTIVITY_LOG_PARTITION_DAYS);
+    snprintf(retention, sizeof(retention), "%d", ACTIVITY_LOG_RETENTION_DAYS);
+    const char* params[2] = { ahead, retention };
+
+    PGresult* res = PQexecParams(c, "SELECT activity_logs_maintain($1::int, $2::int)",
+                                 2, NULL, params, NULL, NULL, 0);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        fprintf(stderr, "[ACTIVITY_LOG] Partition maintenance failed: %s", PQerrorMessage(c));
+    }
+    PQclear(res);
+}
+
+static PGconn* shipper_connect(void) {
+    PGconn* c = PQconnectdb(shipper_conninfo);
+    if (PQstatus(c) != CONNECTION_OK) {
+        fprintf(stderr, "[ACTIVITY_LOG] Connection failed: %s", PQerrorMessage(c));
+        PQfinish(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void deadline_after_ms(struct timespec* ts, long ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void* shipper_main(void* arg) {
+    (void)arg;
+    PGconn* c = NULL;
+    Buffer batch;
+    buffer_init(&batch);
+    int backoff = 1;
+    time_t retry_at = 0;
+    time_t maintain_at = 0;
+
+    pthread_mutex_lock(&log_mutex);
+    while (1) {
+        // Chờ đủ lô hoặc hết thời gian; chưa có kết nối thì chỉ chờ theo thời gian
+        if (!shipper_stop && (pending_count < batch_size || !c)) {
+            struct timespec ts;
+            deadline_after_ms(&ts, flush_ms);
+            pthread_cond_timedwait(&log_cond, &log_mutex, &ts);
+        }
+        int stopping = shipper_stop;
+
+        if (!c && pending_count > 0 && time(NULL) >= retry_at) {
+            pthread_mutex_unlock(&log_mutex);
+            c = shipper_connect();
+            if (c) {
+                backoff = 1;
+            } else {
+                retry_at = time(NULL) + backoff;
+                backoff = backoff * 2 > ACTIVITY_LOG_MAX_BACKOFF ? ACTIVITY_LOG_MAX_BACKOFF : backoff * 2;
+            }
+            pthread_mutex_lock(&log_mutex);
+        }
+
+        if (c && !stopping && time(NULL) >= maintain_at) {
+            pthread_mutex_unlock(&log_mutex);
+            maintain_partitions(c);
+            maintain_at = time(NULL) + ACTIVITY_LOG_MAINTAIN_INTERVAL;
+            pthread_mutex_lock(&log_mutex);
+        }
+
+        if (pending_count == 0 || !c) {
+            if (stopping) break;
+            continue;
+        }
+
+        // Đổi buffer: thread request tiếp tục ghi vào buffer trống trong lúc COPY
+        Buffer tmp = pending;
+        pending = batch;
+        batch = tmp;
+        int n = pending_count;
+        pending_count = 0;
+        pthread_mutex_unlock(&log_mutex);
+
+        int lost = copy_batch(c, batch.data, batch.len, n);
+        if (lost > 0) fprintf(stderr, "[ACTIVITY_LOG] Dropped %d of %d records\n", lost, n);
+        if (PQstatus(c) != CONNECTION_OK) {
+            PQfinish(c);
+            c = NULL;
+        }
+        pthread_mutex_lock(&log_mutex);
+        dropped += (unsigned long)lost;
+        buffer_reset(&batch);
+
+        if (stopping && pending_count == 0) break;
+    }
+    if (pending_count > 0) dropped += (unsigned long)pending_count;
+    pending_count = 0;
+    buffer_reset(&pending);
+    pthread_mutex_unlock(&log_mutex);
+
+    if (c) PQfinish(c);
+    buffer_free(&batch);
+    return NULL;
+}
+
+int activity_log_start(const char* conninfo, int batch, int interval_ms) {
+    if (shipper_running || !conninfo || batch <= 0 || interval_ms <= 0) return -1;
+
+    shipper_conninfo = strdup(conninfo);
+    if (!shipper_conninfo) return -1;
+
+    pthread_mutex_lock(&log_mutex);
+    buffer_init(&pending);
+    pending_count = 0;
+    batch_size = batch;
+    flush_ms = interval_ms;
+    shipper_stop = 0;
+    shipper_running = 1;
+    pthread_mutex_unlock(&log_mutex);
+
+    if (pthread_create(&shipper_thread, NULL, shipper_main, NULL) != 0) {
+        perror("[ACTIVITY_LOG] Thread creation failed");
+        pthread_mutex_lock(&log_mutex);
+        shipper_running = 0;
+        pthread_mutex_unlock(&log_mutex);
+        free(shipper_conninfo);
+        shipper_conninfo = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void activity_log_stop(void) {
+    pthread_mutex_lock(&log_mutex);
+    if (!shipper_running) {
+        pthread_mutex_unlock(&log_mutex);
+        return;
+    }
+    shipper_stop = 1;
+    pthread_cond_signal(&log_cond);
+    pthread_mutex_unlock(&log_mutex);
+
+    pthread_join(shipper_thread, NULL);
+
+    pthread_mutex_lock(&log_mutex);
+    shipper_running = 0;
+    buffer_free(&pending);
+    pthread_mutex_unlock(&log_mutex);
+
+    free(shipper_conninfo);
+    shipper_conninfo = NULL;
+}
+
+unsigned long activity_log_dropped(void) {
+    pthread_mutex_lock(&log_mutex);
+    unsigned long n = dropped;
+    pthread_mutex_unlock(&log_mutex);
+    return n;
+}
@@ -0,0 +1,50 @@
+#ifndef ACTIVITY_LOG_H
+#define ACTIVITY_LOG_H
+
+// =========================================
+// ACTIVITY LOG SHIPPER
+// Ghi log hoạt động vào bảng activity_logs (database/schema.sql)
+// - activity_log_record() chỉ nối 1 dòng COPY vào buffer trong bộ nhớ (không gọi DB)
+// - Thread riêng, kết nối PostgreSQL riêng, đẩy cả lô bằng COPY ... FROM STDIN
+//   khi đủ ACTIVITY_LOG_BATCH bản ghi hoặc sau ACTIVITY_LOG_FLUSH_MS
+// - Buffer đầy (DB chậm / mất kết nối) thì bỏ bản ghi mới, không chặn thread request
+// - Field được làm sạch thành UTF-8 hợp lệ; lô bị COPY từ chối được chia đôi và COPY lại
+//   => chỉ bỏ (và đếm) đúng bản ghi lỗi, không mất cả lô
+// - Định kỳ tạo partition mới / xóa partition hết hạn của activity_logs
+// - File log_nhom3.txt vẫn được ghi như cũ
+// =========================================
+#define ACTIVITY_LOG_BATCH 256          // Số bản ghi mỗi lần COPY
+#define ACTIVITY_LOG_FLUSH_MS 500       // Thời gian chờ tối đa trước khi COPY
+#define ACTIVITY_LOG_MAX_PENDING 16384  // Số bản ghi chờ tối đa trong bộ nhớ
+#define ACTIVITY_LOG_MAX_BACKOFF 30     // Giây
+
+// Bảo trì partition theo ngày của activity_logs (activity_logs_maintain trong schema.sql)
+#define ACTIVITY_LOG_PARTITION_DAYS 7       // Tạo trước partition cho N ngày tới
+#define ACTIVITY_LOG_RETENTION_DAYS 30      // Xóa partition cũ hơn N ngày
+#define ACTIVITY_LOG_MAINTAIN_INTERVAL 3600 // Giây giữa 2 lần bảo trì
+
+/**
+ * Chức năng: Khởi động thread ghi log
+ * @param conninfo  Chuỗi kết nối PostgreSQL (được copy)
+ * @param batch     Số bản ghi mỗi lần COPY
+ * @param flush_ms  Thời gian chờ tối đa (ms)
+ * @return 0 nếu thành công, -1 nếu lỗi tạo thread
+ */
+int activity_log_start(const char* conninfo, int batch, int flush_ms);
+
+// COPY nốt các bản ghi còn lại rồi dừng thread
+void activity_log_stop(void);
+
+/**
+ * Chức năng: Thêm 1 bản ghi (thread-safe, không chờ DB)
+ * @param user_id  ID user, <= 0 nếu chưa đăng nhập (ghi NULL)
+ * @param action   Tên hành động (VD: login, create_event)
+ * @param details  Mô tả chi tiết (có thể NULL)
+ * @param ip       Địa chỉ IP client (có thể NULL)
+ */
+void activity_log_record(int user_id, const char* action, const char* details, const char* ip);
+
+// Số bản ghi đã bỏ do buffer đầy hoặc COPY lỗi
+unsigned long activity_log_dropped(void);
+
+#endif // ACTIVITY_LOG_H
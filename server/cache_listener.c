@@ -0,0 +1,171 @@
+#include "cache_listener.h"
+#include "user_cache.h"
+#include "list_cache.h"
+#include <libpq-fe.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+
+static pthread_t listener_thread;
+static int listener_running = 0;
+static volatile int listener_stop = 0;
+static char* listener_conninfo = NULL;
+
+// "1,2,3" -> invalidate từng user_id, "*" -> xóa toàn bộ
+static void apply_id_list(ListCacheKind kind, const char* ids) {
+    if (strcmp(ids, "*") == 0) {
+        list_cache_clear(kind);
+        return;
+    }
+
+    const char* p = ids;
+    while (*p) {
+        char* end = NULL;
+        long id = strtol(p, &end, 10);
+        if (end == p) break;
+        if (id > 0) list_cache_invalidate(kind, (int)id);
+        p = end;
+        while (*p == ',') p++;
+    }
+}
+
+void cache_listener_apply(const char* payload) {
+    if (!payload) return;
+
+    const char* sep = strchr(payload, ':');
+    if (!sep) return;
+    const char* rest = sep + 1;
+    size_t kind_len = (size_t)(sep - payload);
+
+    if (kind_len == 4 && strncmp(payload, "user", 4) == 0) {
+        // user:<user_id>:<username>
+        char* end = NULL;
+        long user_id = strtol(rest, &end, 10);
+        const char* username = (end && *end == ':') ? end + 1 : NULL;
+        user_cache_invalidate((int)user_id, username);
+    } else if (kind_len == 7 && strncmp(payload, "friends", 7) == 0) {
+        apply_id_list(LIST_CACHE_FRIENDS, rest);
+    } else if (kind_len == 6 && strncmp(payload, "events", 6) == 0) {
+        apply_id_list(LIST_CACHE_EVENTS, rest);
+    } else {
+        fprintf(stderr, "[CACHE_LISTENER] Unknown payload: %s\n", payload);
+    }
+}
+
+// Xóa toàn bộ cache (sau khi mất kết nối LISTEN)
+static void clear_all_caches(void) {
+    user_cache_clear();
+    for (int k = 0; k < LIST_CACHE_KIND_COUNT; k++) {
+        list_cache_clear((ListCacheKind)k);
+    }
+}
+
+static PGconn* listener_connect(void) {
+    PGconn* c = PQconnectdb(listener_conninfo);
+    if (PQstatus(c) != CONNECTION_OK) {
+        fprintf(stderr, "[CACHE_LISTENER] Connection failed: %s", PQerrorMessage(c));
+        PQfinish(c);
+        return NULL;
+    }
+
+    PGresult* res = PQexec(c, "LISTEN " CACHE_LISTENER_CHANNEL);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        fprintf(stderr, "[CACHE_LISTENER] LISTEN failed: %s", PQerrorMessage(c));
+        PQclear(res);
+        PQfinish(c);
+        return NULL;
+    }
+    PQclear(res);
+    return c;
+}
+
+// Ngủ từng giây để dừng được nhanh
+static void sleep_interruptible(int seconds) {
+    for (int i = 0; i < seconds && !listener_stop; i++) {
+        sleep(1);
+    }
+}
+
+static void* listener_main(void* arg) {
+    (void)arg;
+    int backoff = 1;
+    int first_connect = 1;
+
+    while (!listener_stop) {
+        PGconn* c = listener_connect();
+        if (!c) {
+            sleep_interruptible(backoff);
+            backoff = backoff * 2 > CACHE_LISTENER_MAX_BACKOFF ? CACHE_LISTENER_MAX_BACKOFF : backoff * 2;
+            continue;
+        }
+
+        // NOTIFY trong lúc mất kết nối đã bị lỡ
+        if (!first_connect) clear_all_caches();
+        first_connect = 0;
+        backoff = 1;
+        printf("[CACHE_LISTENER] Listening on channel '%s'\n", CACHE_LISTENER_CHANNEL);
+
+        while (!listener_stop) {
+            int sock = PQsocket(c);
+            if (sock < 0) break;
+
+            // poll thay cho select: fd có thể >= FD_SETSIZE khi server giữ nhiều kết nối
+            struct pollfd pfd = { sock, POLLIN, 0 };
+            int rc = poll(&pfd, 1, 1000);
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                perror("[CACHE_LISTENER] poll failed");
+                break;
+            }
+            if (rc == 0) continue;
+
+            if (!PQconsumeInput(c)) {
+                fprintf(stderr, "[CACHE_LISTENER] Connection lost: %s", PQerrorMessage(c));
+                break;
+            }
+
+            PGnotify* notify;
+            while ((notify = PQnotifies(c)) != NULL) {
+                cache_listener_apply(notify->extra);
+                PQfreemem(notify);
+            }
+        }
+
+        PQfinish(c);
+    }
+
+    return NULL;
+}
+
+int cache_listener_start(const char* conninfo) {
+    if (listener_running || !conninfo) return -1;
+
+    listener_conninfo = strdup(conninfo);
+    if (!listener_conninfo) return -1;
+
+    listener_stop = 0;
+    if (pthread_create(&listener_thread, NULL, listener_main, NULL) != 0) {
+        perror("[CACHE_LISTENER] Thread creation failed");
+        free(listener_conninfo);
+        listener_conninfo = NULL;
+        return -1;
+    }
+
+    listener_running = 1;
+    return 0;
+}
+
+void cache_listener_stop(void) {
+    if (!listener_running) return;
+
+    listener_stop = 1;
+    pthread_join(listener_thread, NULL);
+    listener_running = 0;
+
+    free(listener_conninfo);
+    listener_conninfo = NULL;
+}
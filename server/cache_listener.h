@@ -0,0 +1,27 @@
+#ifndef CACHE_LISTENER_H
+#define CACHE_LISTENER_H
+
+// =========================================
+// CACHE LISTENER
+// Kết nối PostgreSQL riêng chạy LISTEN cache_invalidation
+// - Nhận NOTIFY từ trigger (database/schema.sql) khi instance khác ghi dữ liệu
+// - Chuyển payload thành lệnh invalidate user cache / list cache
+// - Mất kết nối: tự kết nối lại (backoff) và xóa toàn bộ cache vì có thể đã lỡ NOTIFY
+// =========================================
+#define CACHE_LISTENER_CHANNEL "cache_invalidation"
+#define CACHE_LISTENER_MAX_BACKOFF 30   // Giây
+
+/**
+ * Chức năng: Khởi động thread LISTEN
+ * @param conninfo Chuỗi kết nối PostgreSQL (được copy)
+ * @return 0 nếu thành công, -1 nếu lỗi tạo thread
+ */
+int cache_listener_start(const char* conninfo);
+
+// Dừng thread LISTEN và đóng kết nối
+void cache_listener_stop(void);
+
+// Xử lý 1 payload NOTIFY (tách riêng để dùng lại)
+void cache_listener_apply(const char* payload);
+
+#endif // CACHE_LISTENER_H
@@ -35,6 +35,14 @@ int config_load_database(const char* config_file, DatabaseConfig* config) {
     strcpy(config->dbname, "event_management");
     strcpy(config->user, "postgres");
     strcpy(config->password, "");
+    config->slow_query_ms = 200;
+    config->slow_query_explain = 0;
+    strcpy(config->slow_query_log, "slow_query.log");
+    config->trace_sample = 0;
+    config->trace_slow_ms = 0;
+    config->worker_threads = 0;
+    config->write_coalesce = 0;
+    strcpy(config->trace_file, "trace.json");
     
     char line[MAX_CONFIG_LINE];
     while (fgets(line, sizeof(line), file)) {
@@ -63,6 +71,22 @@ int config_load_database(const char* config_file, DatabaseConfig* config) {
             strncpy(config->user, value, MAX_CONFIG_VALUE - 1);
         } else if (strcmp(key, "password") == 0) {
             strncpy(config->password, value, MAX_CONFIG_VALUE - 1);
+        } else if (strcmp(key, "slow_query_ms") == 0) {
+            config->slow_query_ms = atoi(value);
+        } else if (strcmp(key, "slow_query_explain") == 0) {
+            config->slow_query_explain = atoi(value) != 0;
+        } else if (strcmp(key, "slow_query_log") == 0) {
+            strncpy(config->slow_query_log, value, MAX_CONFIG_VALUE - 1);
+        } else if (strcmp(key, "trace_sample") == 0) {
+            config->trace_sample = atoi(value);
+        } else if (strcmp(key, "trace_slow_ms") == 0) {
+            config->trace_slow_ms = atoi(value);
+        } else if (strcmp(key, "worker_threads") == 0) {
+            config->worker_threads = atoi(value);
+        } else if (strcmp(key, "write_coalesce") == 0) {
+            config->write_coalesce = atoi(value);
+        } else if (strcmp(key, "trace_file") == 0) {
+            strncpy(config->trace_file, value, MAX_CONFIG_VALUE - 1);
         }
     }
     
@@ -11,6 +11,14 @@ typedef struct {
     char dbname[MAX_CONFIG_VALUE];
     char user[MAX_CONFIG_VALUE];
     char password[MAX_CONFIG_VALUE];
+    int slow_query_ms;                      // Ngưỡng slow query log (ms), 0 = tắt
+    int slow_query_explain;                 // 1 = kèm EXPLAIN (ANALYZE, BUFFERS)
+    char slow_query_log[MAX_CONFIG_VALUE];  // File slow query log
+    int trace_sample;                       // Trace 1 / N request, 0 = chỉ trace request chậm
+    int trace_slow_ms;                      // Luôn trace request >= ngưỡng (ms), 0 = tắt
+    char trace_file[MAX_CONFIG_VALUE];      // File trace JSON (Chrome trace / Perfetto)
+    int worker_threads;                     // Số worker xử lý request (0 = mặc định của reactor)
+    int write_coalesce;                     // 1 = gom lệnh ghi vào transaction chung (backend postgres)
 } DatabaseConfig;
 
 // Load database configuration from file
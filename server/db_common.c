@@ -0,0 +1,61 @@
+#include "db_common.h"
+#include "postgres_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// Validate username (no special characters except underscore)
+int db_validate_username(const char* username) {
+    if (username == NULL || strlen(username) == 0) {
+        return 0;
+    }
+    
+    // Check for special characters (except underscore)
+    for (int i = 0; username[i] != '\0'; i++) {
+        char c = username[i];
+        if (c == '!' || c == '@' || c == '#' || c == '$' || c == '%' || 
+            c == '^' || c == '&' || c == '*' || c == '(' || c == ')' || c == '|') {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+// Validate email format (basic check for @ and .)
+int db_validate_email(const char* email) {
+    if (email == NULL || strlen(email) == 0) {
+        return 0;
+    }
+    
+    const char* at = strchr(email, '@');
+    if (at == NULL || at == email) {
+        return 0;  // No @ or @ at the beginning
+    }
+    
+    const char* dot = strchr(at, '.');
+    if (dot == NULL || dot == at + 1 || dot[1] == '\0') {
+        return 0;  // No . after @ or . right after @ or . at the end
+    }
+    
+    return 1;
+}
+
+// Tách cursor "<key>,<id>" theo dấu ',' cuối cùng (key có thể chứa ',')
+int db_split_cursor(const char* after, char* key, size_t key_size, int* id) {
+    const char* comma = strrchr(after, ',');
+    if (!comma || comma == after) return -1;
+
+    size_t key_len = (size_t)(comma - after);
+    if (key_len >= key_size) return -1;
+
+    char* end = NULL;
+    long v = strtol(comma + 1, &end, 10);
+    if (end == comma + 1 || *end != '\0' || v <= 0 || v > INT_MAX) return -1;
+
+    memcpy(key, after, key_len);
+    key[key_len] = '\0';
+    *id = (int)v;
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef DB_COMMON_H
+#define DB_COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/probes.h"
+
+// =========================================
+// Hàm dùng chung cho các storage backend (postgres_db.c, memory_db.c)
+// db_validate_username / db_validate_email khai báo trong postgres_db.h
+// =========================================
+
+/**
+ * Chức năng: Tách cursor phân trang "<key>,<id>" theo dấu ',' cuối cùng (key có thể chứa ',')
+ * @param key  Phần key (username / event_time)
+ * @param id   Phần id (> 0)
+ * @return 0 nếu hợp lệ, -1 nếu sai định dạng
+ */
+int db_split_cursor(const char* after, char* key, size_t key_size, int* id);
+
+// Probe db__start / db__done (common/probes.h) cho mọi backend
+//   postgres: quanh mỗi câu SQL; memory / embedded: quanh mỗi lần giữ lock dữ liệu
+//   (sql = DB_PROBE_IN_MEMORY, không gồm thời gian chờ fsync WAL sau khi nhả lock)
+//   static inline: không có HAVE_SYS_SDT_H thì không còn lời gọi hàm nào
+#define DB_PROBE_IN_MEMORY "(in-memory)"
+
+static inline void db_probe_start(const char* name, const char* sql) {
+    (void)name;
+    (void)sql;
+    PROBE2(db__start, name, sql);
+}
+
+static inline void db_probe_done(const char* name, int failed, uint64_t elapsed_us) {
+    (void)name;
+    (void)failed;
+    (void)elapsed_us;
+    PROBE3(db__done, name, failed, elapsed_us);
+}
+
+#endif // DB_COMMON_H
@@ -0,0 +1,110 @@
+#include "list_cache.h"
+#include "lru_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    LruEntry lru;             // Phải là thành viên đầu tiên
+    int user_id;
+    char* payload;
+    size_t len;
+    int count;
+} ListEntry;
+
+static LruCache caches[LIST_CACHE_KIND_COUNT];
+
+static int match_user_id(const LruEntry* e, const void* key) {
+    return ((const ListEntry*)e)->user_id == *(const int*)key;
+}
+
+static void free_list_entry(LruEntry* e) {
+    free(((ListEntry*)e)->payload);
+    free(e);
+}
+
+void list_cache_init(void) {
+    for (int k = 0; k < LIST_CACHE_KIND_COUNT; k++) {
+        lru_cache_init(&caches[k], LIST_CACHE_SHARD_CAPACITY, LIST_CACHE_TTL, match_user_id,
+                       free_list_entry, NULL);
+    }
+}
+
+void list_cache_destroy(void) {
+    for (int k = 0; k < LIST_CACHE_KIND_COUNT; k++) {
+        lru_cache_destroy(&caches[k]);
+    }
+}
+
+unsigned long list_cache_generation(ListCacheKind kind) {
+    return lru_cache_generation(&caches[kind]);
+}
+
+int list_cache_get(ListCacheKind kind, int user_id, Buffer* out, int* count) {
+    LruCache* cache = &caches[kind];
+    unsigned int hash = lru_hash_int(user_id);
+    LruShard* shard = lru_cache_shard(cache, hash);
+    int found = 0;
+
+    pthread_mutex_lock(&shard->lock);
+    ListEntry* e = (ListEntry*)lru_cache_find_locked(cache, shard, hash, &user_id);
+    if (e) {
+        if (buffer_append(out, e->payload, e->len) < 0) {
+            found = -1;
+        } else {
+            if (count) *count = e->count;
+            found = 1;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
+
+void list_cache_put(ListCacheKind kind, int user_id, const char* payload, size_t len, int count,
+                    unsigned long generation) {
+    if (!payload) return;
+
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return;
+    memcpy(copy, payload, len);
+    copy[len] = '\0';
+
+    LruCache* cache = &caches[kind];
+    unsigned int hash = lru_hash_int(user_id);
+    LruShard* shard = lru_cache_shard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+
+    // Có invalidate trong lúc query DB => payload có thể đã cũ
+    if (lru_cache_generation(cache) != generation) {
+        pthread_mutex_unlock(&shard->lock);
+        free(copy);
+        return;
+    }
+
+    ListEntry* e = (ListEntry*)lru_cache_find_locked(cache, shard, hash, &user_id);
+    if (e) {
+        free(e->payload);
+        lru_cache_touch_locked(cache, &e->lru);
+    } else {
+        e = (ListEntry*)calloc(1, sizeof(ListEntry));
+        if (!e) {
+            pthread_mutex_unlock(&shard->lock);
+            free(copy);
+            return;
+        }
+        e->user_id = user_id;
+        lru_cache_insert_locked(cache, shard, hash, &e->lru);
+    }
+    e->payload = copy;
+    e->len = len;
+    e->count = count;
+
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void list_cache_invalidate(ListCacheKind kind, int user_id) {
+    lru_cache_invalidate(&caches[kind], lru_hash_int(user_id), &user_id);
+}
+
+void list_cache_clear(ListCacheKind kind) {
+    lru_cache_clear(&caches[kind]);
+}
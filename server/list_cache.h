@@ -0,0 +1,49 @@
+#ifndef LIST_CACHE_H
+#define LIST_CACHE_H
+
+#include "../common/protocol.h"
+
+// =========================================
+// LIST CACHE
+// Cache payload đã serialize sẵn (chuỗi extra_data của response) theo user_id
+// - Handler gửi thẳng payload từ bộ nhớ, không cần query lại DB
+// - Data layer invalidate khi dữ liệu liên quan thay đổi (write-through)
+// - Mỗi loại 1 sharded LRU + TTL riêng (lru_cache.h)
+// =========================================
+#define LIST_CACHE_SHARD_CAPACITY 256   // Số user tối đa mỗi shard
+#define LIST_CACHE_TTL 300              // Giây (chốt an toàn, invalidate mới là chính)
+
+typedef enum {
+    LIST_CACHE_FRIENDS = 0,   // Payload của GET_FRIENDS
+    LIST_CACHE_EVENTS,        // Payload của GET_EVENTS
+    LIST_CACHE_KIND_COUNT
+} ListCacheKind;
+
+void list_cache_init(void);
+void list_cache_destroy(void);
+
+// Đọc trước khi query DB, truyền vào list_cache_put()
+unsigned long list_cache_generation(ListCacheKind kind);
+
+/**
+ * Chức năng: Lấy payload đã cache của user
+ * @param out    Buffer nhận payload (ghi nối tiếp)
+ * @param count  Số dòng trong payload
+ * @return 1 nếu có, 0 nếu không có, -1 nếu lỗi cấp phát
+ */
+int list_cache_get(ListCacheKind kind, int user_id, Buffer* out, int* count);
+
+/**
+ * Chức năng: Lưu payload của user
+ * - Bỏ qua nếu đã có invalidate kể từ lúc lấy generation
+ */
+void list_cache_put(ListCacheKind kind, int user_id, const char* payload, size_t len, int count,
+                    unsigned long generation);
+
+// Xóa payload của 1 user
+void list_cache_invalidate(ListCacheKind kind, int user_id);
+
+// Xóa toàn bộ payload của 1 loại
+void list_cache_clear(ListCacheKind kind);
+
+#endif // LIST_CACHE_H
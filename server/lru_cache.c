@@ -0,0 +1,133 @@
+#include "lru_cache.h"
+#include <string.h>
+
+void lru_cache_init(LruCache* cache, int capacity, int ttl, LruMatchFn match, LruFreeFn free_entry,
+                    unsigned long* shared_generation) {
+    for (int i = 0; i < LRU_CACHE_SHARDS; i++) {
+        LruShard* shard = &cache->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        memset(shard->buckets, 0, sizeof(shard->buckets));
+        shard->head = shard->tail = NULL;
+        shard->count = 0;
+    }
+    cache->capacity = capacity;
+    cache->ttl = ttl;
+    cache->match = match;
+    cache->free_entry = free_entry;
+    cache->own_generation = 0;
+    cache->generation = shared_generation ? shared_generation : &cache->own_generation;
+}
+
+void lru_cache_destroy(LruCache* cache) {
+    lru_cache_clear(cache);
+}
+
+unsigned int lru_hash_int(int v) {
+    unsigned int h = (unsigned int)v;
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    h ^= h >> 16;
+    return h;
+}
+
+unsigned int lru_hash_string(const char* s) {
+    unsigned int h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+LruShard* lru_cache_shard(LruCache* cache, unsigned int hash) {
+    return &cache->shards[hash % LRU_CACHE_SHARDS];
+}
+
+static LruEntry** bucket_for(LruShard* shard, unsigned int hash) {
+    return &shard->buckets[(hash / LRU_CACHE_SHARDS) & (LRU_CACHE_BUCKETS - 1)];
+}
+
+static void lru_unlink(LruShard* shard, LruEntry* e) {
+    if (e->prev) e->prev->next = e->next; else shard->head = e->next;
+    if (e->next) e->next->prev = e->prev; else shard->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(LruShard* shard, LruEntry* e) {
+    e->prev = NULL;
+    e->next = shard->head;
+    if (shard->head) shard->head->prev = e;
+    shard->head = e;
+    if (!shard->tail) shard->tail = e;
+}
+
+void lru_cache_remove_locked(LruCache* cache, LruShard* shard, LruEntry* e) {
+    LruEntry** pp = bucket_for(shard, e->hash);
+    while (*pp && *pp != e) pp = &(*pp)->hnext;
+    if (*pp) *pp = e->hnext;
+    lru_unlink(shard, e);
+    shard->count--;
+    cache->free_entry(e);
+}
+
+LruEntry* lru_cache_find_locked(LruCache* cache, LruShard* shard, unsigned int hash, const void* key) {
+    for (LruEntry* e = *bucket_for(shard, hash); e; e = e->hnext) {
+        if (e->hash != hash || !cache->match(e, key)) continue;
+        if (time(NULL) >= e->expires_at) {
+            lru_cache_remove_locked(cache, shard, e);
+            return NULL;
+        }
+        lru_unlink(shard, e);
+        lru_push_front(shard, e);
+        return e;
+    }
+    return NULL;
+}
+
+void lru_cache_insert_locked(LruCache* cache, LruShard* shard, unsigned int hash, LruEntry* e) {
+    if (shard->count >= cache->capacity && shard->tail) {
+        lru_cache_remove_locked(cache, shard, shard->tail);
+    }
+    e->hash = hash;
+    e->expires_at = time(NULL) + cache->ttl;
+    LruEntry** bucket = bucket_for(shard, hash);
+    e->hnext = *bucket;
+    *bucket = e;
+    lru_push_front(shard, e);
+    shard->count++;
+}
+
+void lru_cache_touch_locked(LruCache* cache, LruEntry* e) {
+    e->expires_at = time(NULL) + cache->ttl;
+}
+
+unsigned long lru_cache_generation(const LruCache* cache) {
+    return __atomic_load_n(cache->generation, __ATOMIC_ACQUIRE);
+}
+
+void lru_cache_bump_generation(LruCache* cache) {
+    __atomic_add_fetch(cache->generation, 1, __ATOMIC_ACQ_REL);
+}
+
+void lru_cache_invalidate(LruCache* cache, unsigned int hash, const void* key) {
+    lru_cache_bump_generation(cache);
+
+    LruShard* shard = lru_cache_shard(cache, hash);
+    pthread_mutex_lock(&shard->lock);
+    LruEntry* e = lru_cache_find_locked(cache, shard, hash, key);
+    if (e) lru_cache_remove_locked(cache, shard, e);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void lru_cache_clear(LruCache* cache) {
+    lru_cache_bump_generation(cache);
+
+    for (int i = 0; i < LRU_CACHE_SHARDS; i++) {
+        LruShard* shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        while (shard->head) {
+            lru_cache_remove_locked(cache, shard, shard->head);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
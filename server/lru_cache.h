@@ -0,0 +1,92 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+// =========================================
+// SHARDED LRU CACHE (dùng chung cho user_cache và list_cache)
+// - Entry của cache nhúng LruEntry làm thành viên đầu tiên; LruCache chỉ quản lý bảng băm,
+//   danh sách LRU, TTL và số entry, phần dữ liệu do cache cụ thể cấp / so khớp / giải phóng
+// - Chia LRU_CACHE_SHARDS shard (mỗi shard 1 mutex) để giảm tranh chấp khóa giữa các thread
+// - Generation: tăng trước mỗi lần xóa; caller đọc generation trước khi query DB và chỉ ghi
+//   kết quả nếu generation chưa đổi (kết quả cũ không ghi đè invalidate xảy ra trong lúc query)
+// Hàm *_locked: caller giữ shard->lock của lru_cache_shard(cache, hash)
+// =========================================
+#include <time.h>
+#include <pthread.h>
+
+#define LRU_CACHE_SHARDS 16
+#define LRU_CACHE_BUCKETS 512           // Số bucket hash mỗi shard (lũy thừa của 2)
+
+typedef struct LruEntry {
+    unsigned int hash;
+    time_t expires_at;
+    struct LruEntry* hnext;             // Chuỗi trong bucket
+    struct LruEntry* prev;              // Danh sách LRU (head = mới dùng nhất)
+    struct LruEntry* next;
+} LruEntry;
+
+// 1 nếu entry ứng với key (key do cache cụ thể định nghĩa)
+typedef int (*LruMatchFn)(const LruEntry* entry, const void* key);
+// Giải phóng entry (kể cả phần dữ liệu)
+typedef void (*LruFreeFn)(LruEntry* entry);
+
+typedef struct {
+    pthread_mutex_t lock;
+    LruEntry* buckets[LRU_CACHE_BUCKETS];
+    LruEntry* head;
+    LruEntry* tail;
+    int count;
+} LruShard;
+
+typedef struct {
+    LruShard shards[LRU_CACHE_SHARDS];
+    int capacity;                       // Số entry tối đa mỗi shard
+    int ttl;                            // Giây
+    LruMatchFn match;
+    LruFreeFn free_entry;
+    unsigned long own_generation;
+    unsigned long* generation;          // &own_generation hoặc dùng chung giữa nhiều cache
+} LruCache;
+
+/**
+ * Chức năng: Khởi tạo cache rỗng
+ * @param capacity           Số entry tối đa mỗi shard (đầy thì bỏ entry lâu không dùng nhất)
+ * @param ttl                Thời gian sống của entry (giây)
+ * @param shared_generation  Generation dùng chung (VD: nhiều index của cùng dữ liệu), NULL = riêng
+ */
+void lru_cache_init(LruCache* cache, int capacity, int ttl, LruMatchFn match, LruFreeFn free_entry,
+                    unsigned long* shared_generation);
+
+// Xóa mọi entry (gọi khi không còn thread nào dùng cache)
+void lru_cache_destroy(LruCache* cache);
+
+unsigned int lru_hash_int(int v);
+unsigned int lru_hash_string(const char* s);        // FNV-1a
+
+LruShard* lru_cache_shard(LruCache* cache, unsigned int hash);
+
+/**
+ * Chức năng: Tìm entry còn hạn và đưa lên đầu LRU (entry hết hạn bị xóa)
+ * @return entry, NULL nếu không có
+ */
+LruEntry* lru_cache_find_locked(LruCache* cache, LruShard* shard, unsigned int hash, const void* key);
+
+// Thêm entry mới (chưa có trong cache) với hạn mới; shard đầy thì bỏ entry cuối LRU
+void lru_cache_insert_locked(LruCache* cache, LruShard* shard, unsigned int hash, LruEntry* entry);
+
+// Gia hạn entry vừa được ghi đè dữ liệu
+void lru_cache_touch_locked(LruCache* cache, LruEntry* entry);
+
+void lru_cache_remove_locked(LruCache* cache, LruShard* shard, LruEntry* entry);
+
+unsigned long lru_cache_generation(const LruCache* cache);
+
+// Tăng generation: gọi trước khi xóa entry vì dữ liệu đã đổi
+void lru_cache_bump_generation(LruCache* cache);
+
+// Tăng generation rồi xóa entry ứng với key (nếu có)
+void lru_cache_invalidate(LruCache* cache, unsigned int hash, const void* key);
+
+// Tăng generation rồi xóa mọi entry
+void lru_cache_clear(LruCache* cache);
+
+#endif // LRU_CACHE_H
@@ -0,0 +1,1485 @@
+// =========================================
+// IN-MEMORY / EMBEDDED STORAGE BACKEND
+// Cài đặt toàn bộ postgres_db.h trong tiến trình server, không cần PostgreSQL
+// - Cùng mã trả về / format kết quả với postgres_db.c => server.c không phải đổi gì
+// - make DB_BACKEND=memory:   dữ liệu chỉ nằm trong RAM (benchmark network / session / protocol)
+// - make DB_BACKEND=embedded: thêm WAL + checkpoint (wal.h) trong thư mục WAL_DATA_DIR,
+//   khôi phục khi khởi động; thay đổi chỉ trả về sau khi record đã fsync (group commit)
+// - Index: hash cho username / email, mảng theo id cho các bảng,
+//   index có thứ tự (username, user_id) / (event_time, event_id) cho danh sách của mỗi user
+// - 1 rwlock cho toàn bộ dữ liệu; chờ fsync sau khi nhả lock
+// - Mật khẩu vẫn băm trên password pool (chi phí CPU như bản thật)
+// =========================================
+#include "postgres_db.h"
+#include "db_common.h"
+#include "list_cache.h"
+#include "password_hash.h"
+#include "wal.h"
+#include "../common/histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define MEM_HASH_BUCKETS 65536   // Bucket cho index username / email (lũy thừa của 2)
+
+// Giới hạn độ dài cột như database/schema.sql (vượt quá => lỗi như VARCHAR)
+#define MEM_USERNAME_LEN 50
+#define MEM_EMAIL_LEN 100
+#define MEM_TITLE_LEN 200
+#define MEM_LOCATION_LEN 255
+#define MEM_TIME_LEN 19          // "YYYY-MM-DD HH:MM:SS"
+
+typedef enum { ST_PENDING, ST_ACCEPTED, ST_REJECTED } RequestStatus;
+
+typedef struct {
+    int* data;
+    int len;
+    int cap;
+} IntVec;
+
+typedef struct {
+    int user_id;
+    char username[MEM_USERNAME_LEN + 1];
+    char email[MEM_EMAIL_LEN + 1];
+    char password[PASSWORD_HASH_SIZE];
+    char status[16];
+    int name_next;               // Chuỗi bucket username (user_id, 0 = hết)
+    int email_next;              // Chuỗi bucket email
+    IntVec friends;              // Có thứ tự (username, user_id)
+    IntVec events;               // Event tham gia (gồm event tự tạo), có thứ tự (event_time, event_id)
+    IntVec friend_requests;      // request_id nhận được
+    IntVec invitations;          // invitation_id nhận được
+} MemUser;
+
+typedef struct {
+    int sender_id;
+    int receiver_id;
+    RequestStatus status;
+} MemFriendRequest;
+
+typedef struct {
+    int event_id;
+    int creator_id;
+    int deleted;
+    char title[MEM_TITLE_LEN + 1];
+    char* description;
+    char location[MEM_LOCATION_LEN + 1];
+    char event_time[MEM_TIME_LEN + 1];
+    char event_type[8];
+    char status[12];
+    IntVec participants;
+    IntVec join_requests;        // join_request_id
+} MemEvent;
+
+typedef struct {
+    int event_id;
+    int sender_id;
+    int receiver_id;
+    RequestStatus status;
+} MemInvitation;
+
+typedef struct {
+    int event_id;
+    int user_id;
+    RequestStatus status;
+} MemJoinRequest;
+
+// Mảng động, phần tử thứ i có id = i + 1 (giống SERIAL)
+#define MEM_TABLE(type) struct { type* rows; int count; int cap; }
+
+static pthread_rwlock_t db_lock = PTHREAD_RWLOCK_INITIALIZER;
+static MEM_TABLE(MemUser) users;
+static MEM_TABLE(MemFriendRequest) friend_requests;
+static MEM_TABLE(MemEvent) events;
+static MEM_TABLE(MemInvitation) invitations;
+static MEM_TABLE(MemJoinRequest) join_requests;
+static int* username_buckets = NULL;
+static int* email_buckets = NULL;
+static int initialized = 0;
+
+// Giữ db_lock cho 1 thao tác; probe db__start / db__done (db_common.h) quanh lúc giữ lock
+static __thread uint64_t tls_lock_start = 0;
+
+static void db_read_lock(const char* name) {
+    pthread_rwlock_rdlock(&db_lock);
+    db_probe_start(name, DB_PROBE_IN_MEMORY);
+    tls_lock_start = hist_now_us();
+}
+
+static void db_write_lock(const char* name) {
+    pthread_rwlock_wrlock(&db_lock);
+    db_probe_start(name, DB_PROBE_IN_MEMORY);
+    tls_lock_start = hist_now_us();
+}
+
+static void db_unlock(const char* name) {
+    uint64_t elapsed = hist_now_us() - tls_lock_start;
+    pthread_rwlock_unlock(&db_lock);
+    db_probe_done(name, 0, elapsed);
+}
+
+// Loại record WAL / snapshot. REC_* = 1 thay đổi (replay bằng cùng hàm apply_*),
+// REC_SNAP_* = 1 dòng dữ liệu lúc checkpoint (ghi theo thứ tự id)
+enum {
+    REC_USER_CREATE = 1,         // username, email, password hash
+    REC_FRIEND_REQUEST,          // sender_id, receiver_id
+    REC_FRIEND_ACCEPT,           // request_id
+    REC_FRIEND_REJECT,           // request_id
+    REC_FRIEND_REMOVE,           // user_id, friend_id
+    REC_EVENT_CREATE,            // creator_id, title, description, location, time, type
+    REC_EVENT_UPDATE,            // event_id, title, description, location, time, type
+    REC_EVENT_DELETE,            // event_id
+    REC_PARTICIPANT_ADD,         // event_id, user_id
+    REC_INVITATION_CREATE,       // event_id, sender_id, receiver_id
+    REC_INVITATION_ACCEPT,       // invitation_id
+    REC_JOIN_REQUEST_CREATE,     // event_id, user_id
+    REC_JOIN_REQUEST_APPROVE,    // join_request_id
+
+    REC_SNAP_USER = 64,          // user_id, username, email, password hash, status
+    REC_SNAP_FRIEND_REQUEST,     // request_id, sender_id, receiver_id, status
+    REC_SNAP_FRIENDSHIP,         // user_id1, user_id2
+    REC_SNAP_EVENT,              // event_id, creator_id, deleted, title, description, location, time, type, status
+    REC_SNAP_PARTICIPANT,        // event_id, user_id
+    REC_SNAP_INVITATION,         // invitation_id, event_id, sender_id, receiver_id, status
+    REC_SNAP_JOIN_REQUEST        // join_request_id, event_id, user_id, status
+};
+
+#define REC_NULL_STRING 0xFFFFFFFFu
+
+// ---------- Helpers ----------
+
+static int vec_push(IntVec* v, int x) {
+    if (v->len == v->cap) {
+        int cap = v->cap ? v->cap * 2 : 8;
+        int* data = (int*)realloc(v->data, sizeof(int) * (size_t)cap);
+        if (!data) return -1;
+        v->data = data;
+        v->cap = cap;
+    }
+    v->data[v->len++] = x;
+    return 0;
+}
+
+static int vec_index(const IntVec* v, int x) {
+    for (int i = 0; i < v->len; i++) {
+        if (v->data[i] == x) return i;
+    }
+    return -1;
+}
+
+// Xóa không giữ thứ tự (tập hợp)
+static void vec_remove(IntVec* v, int x) {
+    int i = vec_index(v, x);
+    if (i >= 0) v->data[i] = v->data[--v->len];
+}
+
+static void vec_free(IntVec* v) {
+    free(v->data);
+    memset(v, 0, sizeof(*v));
+}
+
+// Thêm 1 dòng rỗng vào bảng, return id mới (>= 1) hoặc -1
+static int table_append(void** rows, int* count, int* cap, size_t elem) {
+    if (*count == *cap) {
+        int new_cap = *cap ? *cap * 2 : 64;
+        void* grown = realloc(*rows, elem * (size_t)new_cap);
+        if (!grown) return -1;
+        *rows = grown;
+        *cap = new_cap;
+    }
+    memset((char*)*rows + elem * (size_t)*count, 0, elem);
+    return ++(*count);
+}
+#define TABLE_APPEND(t) table_append((void**)&(t).rows, &(t).count, &(t).cap, sizeof(*(t).rows))
+
+static unsigned int hash_str(const char* s) {
+    unsigned int h = 2166136261u;  // FNV-1a
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h & (MEM_HASH_BUCKETS - 1);
+}
+
+static MemUser* user_by_id(int user_id) {
+    if (user_id <= 0 || user_id > users.count) return NULL;
+    return &users.rows[user_id - 1];
+}
+
+static MemUser* user_by_name(const char* username) {
+    for (int id = username_buckets[hash_str(username)]; id; id = users.rows[id - 1].name_next) {
+        if (strcmp(users.rows[id - 1].username, username) == 0) return &users.rows[id - 1];
+    }
+    return NULL;
+}
+
+static int email_taken(const char* email) {
+    for (int id = email_buckets[hash_str(email)]; id; id = users.rows[id - 1].email_next) {
+        if (strcmp(users.rows[id - 1].email, email) == 0) return 1;
+    }
+    return 0;
+}
+
+static MemEvent* event_by_id(int event_id) {
+    if (event_id <= 0 || event_id > events.count) return NULL;
+    MemEvent* e = &events.rows[event_id - 1];
+    return e->deleted ? NULL : e;
+}
+
+static int is_active_user(const MemUser* u) {
+    return strcmp(u->status, "active") == 0;
+}
+
+// Chuẩn hóa "YYYY-MM-DD HH:MM[:SS]" => "YYYY-MM-DD HH:MM:SS" (format text của TIMESTAMP)
+// return: 0 nếu hợp lệ, -1 nếu sai (PostgreSQL sẽ báo lỗi kiểu dữ liệu)
+static int normalize_time(const char* in, char out[MEM_TIME_LEN + 1]) {
+    int y, mo, d, h, mi, s = 0;
+    if (!in || sscanf(in, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &s) < 5) return -1;
+    if (y < 1 || y > 9999 || mo < 1 || mo > 12 || d < 1 || d > 31 ||
+        h < 0 || h > 23 || mi < 0 || mi > 59 || s < 0 || s > 59) return -1;
+    snprintf(out, MEM_TIME_LEN + 1, "%04d-%02d-%02d %02d:%02d:%02d", y, mo, d, h, mi, s);
+    return 0;
+}
+
+// Kiểm tra như các cột VARCHAR / CHECK của bảng events
+static int valid_event_fields(const char* title, const char* location, const char* event_type) {
+    if (!title || strlen(title) > MEM_TITLE_LEN) return 0;
+    if (location && strlen(location) > MEM_LOCATION_LEN) return 0;
+    return event_type && (strcmp(event_type, "private") == 0 || strcmp(event_type, "public") == 0);
+}
+
+// ---------- Index có thứ tự ----------
+// Mảng id sắp theo khóa (chuỗi, id), tìm bằng binary search: cùng vai trò với index B-tree
+// idx_users_username_id / idx_events_creator_time trong schema.sql
+
+typedef struct {
+    const char* key;
+    int id;
+} SortKey;
+
+typedef int (*IndexCmp)(int id, const SortKey* k);
+
+static int cmp_friend_key(int user_id, const SortKey* k) {
+    int c = strcmp(users.rows[user_id - 1].username, k->key);
+    return c ? c : (user_id > k->id) - (user_id < k->id);
+}
+
+static int cmp_event_key(int event_id, const SortKey* k) {
+    int c = strcmp(events.rows[event_id - 1].event_time, k->key);
+    return c ? c : (event_id > k->id) - (event_id < k->id);
+}
+
+// Vị trí đầu tiên có khóa > k
+static int index_upper_bound(const IntVec* v, IndexCmp cmp, const SortKey* k) {
+    int lo = 0, hi = v->len;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cmp(v->data[mid], k) <= 0) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int index_insert(IntVec* v, IndexCmp cmp, const SortKey* k) {
+    int pos = index_upper_bound(v, cmp, k);
+    if (vec_push(v, k->id) < 0) return -1;
+    memmove(v->data + pos + 1, v->data + pos, sizeof(int) * (size_t)(v->len - 1 - pos));
+    v->data[pos] = k->id;
+    return 0;
+}
+
+static void index_erase(IntVec* v, int id) {
+    int i = vec_index(v, id);
+    if (i < 0) return;
+    memmove(v->data + i, v->data + i + 1, sizeof(int) * (size_t)(v->len - 1 - i));
+    v->len--;
+}
+
+static int friends_insert(MemUser* u, int friend_id) {
+    SortKey k = { users.rows[friend_id - 1].username, friend_id };
+    return index_insert(&u->friends, cmp_friend_key, &k);
+}
+
+static int user_events_insert(MemUser* u, const MemEvent* e) {
+    SortKey k = { e->event_time, e->event_id };
+    return index_insert(&u->events, cmp_event_key, &k);
+}
+
+// ---------- Record WAL / snapshot ----------
+// Payload: [u8 type] rồi các field theo fmt: 'i' = int32, 's' = u32 len + chuỗi + '\0'
+
+static int rec_vencode(Buffer* b, int type, const char* fmt, va_list ap) {
+    unsigned char t = (unsigned char)type;
+    if (buffer_append(b, (const char*)&t, 1) < 0) return -1;
+    for (; *fmt; fmt++) {
+        if (*fmt == 'i') {
+            int32_t v = va_arg(ap, int);
+            if (buffer_append(b, (const char*)&v, 4) < 0) return -1;
+        } else {
+            const char* s = va_arg(ap, const char*);
+            uint32_t n = s ? (uint32_t)strlen(s) : REC_NULL_STRING;
+            if (buffer_append(b, (const char*)&n, 4) < 0) return -1;
+            if (s && buffer_append(b, s, (size_t)n + 1) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Ghi 1 thay đổi vào WAL; gọi khi đang giữ write lock, ngay sau apply_* tương ứng
+ * @return LSN cần wal_wait() sau khi nhả lock (0 nếu không dùng WAL)
+ */
+static unsigned long long log_change(int type, const char* fmt, ...) {
+    if (!wal_enabled()) return 0;
+
+    Buffer b;
+    buffer_init(&b);
+    size_t start = wal_record_begin(&b);
+    int rc = -1;
+    if (start != (size_t)-1) {
+        va_list ap;
+        va_start(ap, fmt);
+        rc = rec_vencode(&b, type, fmt, ap);
+        va_end(ap);
+    }
+    if (rc < 0 || wal_record_end(&b, start) < 0) {
+        // Thay đổi đã áp dụng nhưng không ghi được WAL => không còn đảm bảo bền vững
+        fprintf(stderr, "[WAL] Out of memory while logging change - shutting down\n");
+        abort();
+    }
+    unsigned long long lsn = wal_append(&b);
+    buffer_free(&b);
+    return lsn;
+}
+
+// ---------- Thay đổi dữ liệu ----------
+// Các hàm apply_* gọi khi đang giữ write lock (hoặc lúc khôi phục), dữ liệu đầu vào đã
+// được kiểm tra; cùng 1 chuỗi apply_* luôn cho cùng trạng thái và cùng id => replay được
+
+static int apply_user_create(const char* username, const char* email, const char* hash) {
+    int user_id = TABLE_APPEND(users);
+    if (user_id < 0) return -1;
+
+    MemUser* u = &users.rows[user_id - 1];
+    u->user_id = user_id;
+    snprintf(u->username, sizeof(u->username), "%s", username);
+    snprintf(u->email, sizeof(u->email), "%s", email);
+    snprintf(u->password, sizeof(u->password), "%s", hash);
+    snprintf(u->status, sizeof(u->status), "active");
+
+    unsigned int hb = hash_str(u->username);
+    u->name_next = username_buckets[hb];
+    username_buckets[hb] = user_id;
+    unsigned int he = hash_str(u->email);
+    u->email_next = email_buckets[he];
+    email_buckets[he] = user_id;
+    return user_id;
+}
+
+// UNIQUE (sender_id, receiver_id): request cũ (accepted/rejected) chuyển lại pending
+static int apply_friend_request(int sender_id, int receiver_id) {
+    MemUser* receiver = user_by_id(receiver_id);
+    if (!receiver || !user_by_id(sender_id)) return -1;
+
+    for (int i = 0; i < receiver->friend_requests.len; i++) {
+        int id = receiver->friend_requests.data[i];
+        if (friend_requests.rows[id - 1].sender_id == sender_id) {
+            friend_requests.rows[id - 1].status = ST_PENDING;
+            return id;
+        }
+    }
+
+    int id = TABLE_APPEND(friend_requests);
+    if (id < 0) return -1;
+    friend_requests.rows[id - 1].sender_id = sender_id;
+    friend_requests.rows[id - 1].receiver_id = receiver_id;
+    friend_requests.rows[id - 1].status = ST_PENDING;
+    if (vec_push(&receiver->friend_requests, id) < 0) {
+        friend_requests.count--;
+        return -1;
+    }
+    return id;
+}
+
+static int friendship_exists(int user_id1, int user_id2) {
+    MemUser* a = user_by_id(user_id1);
+    MemUser* b = user_by_id(user_id2);
+    if (!a || !b) return 0;
+    // Tìm trong index của người có ít bạn hơn
+    if (a->friends.len > b->friends.len) {
+        MemUser* t = a;
+        a = b;
+        b = t;
+    }
+    SortKey k = { b->username, b->user_id };
+    int pos = index_upper_bound(&a->friends, cmp_friend_key, &k);
+    return pos > 0 && a->friends.data[pos - 1] == b->user_id;
+}
+
+static int apply_friendship(int user_id1, int user_id2) {
+    MemUser* a = user_by_id(user_id1);
+    MemUser* b = user_by_id(user_id2);
+    if (!a || !b) return -1;
+    if (friendship_exists(user_id1, user_id2)) return 0;
+    if (friends_insert(a, user_id2) < 0) return -1;
+    if (friends_insert(b, user_id1) < 0) {
+        index_erase(&a->friends, user_id2);
+        return -1;
+    }
+    return 0;
+}
+
+static int apply_friend_accept(int request_id) {
+    if (request_id <= 0 || request_id > friend_requests.count) return -1;
+    MemFriendRequest* fr = &friend_requests.rows[request_id - 1];
+    if (apply_friendship(fr->sender_id, fr->receiver_id) < 0) return -1;
+    fr->status = ST_ACCEPTED;
+    return 0;
+}
+
+static int apply_friend_reject(int request_id) {
+    if (request_id <= 0 || request_id > friend_requests.count) return -1;
+    friend_requests.rows[request_id - 1].status = ST_REJECTED;
+    return 0;
+}
+
+static int apply_friend_remove(int user_id, int friend_id) {
+    MemUser* a = user_by_id(user_id);
+    MemUser* b = user_by_id(friend_id);
+    if (a) index_erase(&a->friends, friend_id);
+    if (b) index_erase(&b->friends, user_id);
+    return 0;
+}
+
+// Như INSERT INTO event_participants
+// return: 0 nếu thành công, -2 nếu đã tham gia, -1 nếu lỗi (FK)
+static int apply_participant_add(int event_id, int user_id) {
+    MemEvent* e = event_by_id(event_id);
+    MemUser* u = user_by_id(user_id);
+    if (!e || !u) return -1;
+    if (vec_index(&e->participants, user_id) >= 0) return -2;
+    if (vec_push(&e->participants, user_id) < 0) return -1;
+    if (user_events_insert(u, e) < 0) {
+        vec_remove(&e->participants, user_id);
+        return -1;
+    }
+    return 0;
+}
+
+// Thêm dòng events (chưa có người tham gia), return event_id hoặc -1
+static int event_insert(int creator_id, const char* title, const char* description,
+                        const char* location, const char* event_time, const char* event_type,
+                        const char* status) {
+    int event_id = TABLE_APPEND(events);
+    if (event_id < 0) return -1;
+
+    MemEvent* e = &events.rows[event_id - 1];
+    e->event_id = event_id;
+    e->creator_id = creator_id;
+    snprintf(e->title, sizeof(e->title), "%s", title);
+    e->description = description ? strdup(description) : NULL;
+    snprintf(e->location, sizeof(e->location), "%s", location ? location : "");
+    snprintf(e->event_time, sizeof(e->event_time), "%s", event_time);
+    snprintf(e->event_type, sizeof(e->event_type), "%s", event_type);
+    snprintf(e->status, sizeof(e->status), "%s", status);
+    return event_id;
+}
+
+static int apply_event_create(int creator_id, const char* title, const char* description,
+                              const char* location, const char* event_time, const char* event_type) {
+    if (!user_by_id(creator_id)) return -1;
+    int event_id = event_insert(creator_id, title, description, location, event_time, event_type, "active");
+    if (event_id < 0) return -1;
+
+    // Như trigger add_creator_to_participants
+    if (apply_participant_add(event_id, creator_id) < 0) {
+        events.rows[event_id - 1].deleted = 1;
+        return -1;
+    }
+    return event_id;
+}
+
+static int apply_event_update(int event_id, const char* title, const char* description,
+                              const char* location, const char* event_time, const char* event_type) {
+    MemEvent* e = event_by_id(event_id);
+    if (!e) return -1;
+
+    int moved = strcmp(e->event_time, event_time) != 0;
+    snprintf(e->title, sizeof(e->title), "%s", title);
+    free(e->description);
+    e->description = description ? strdup(description) : NULL;
+    snprintf(e->location, sizeof(e->location), "%s", location ? location : "");
+    snprintf(e->event_time, sizeof(e->event_time), "%s", event_time);
+    snprintf(e->event_type, sizeof(e->event_type), "%s", event_type);
+
+    // Đổi thời gian => đổi vị trí trong index event của mọi người tham gia
+    int rc = 0;
+    for (int i = 0; moved && i < e->participants.len; i++) {
+        MemUser* u = user_by_id(e->participants.data[i]);
+        index_erase(&u->events, event_id);
+        if (user_events_insert(u, e) < 0) rc = -1;
+    }
+    return rc;
+}
+
+static int apply_event_delete(int event_id) {
+    MemEvent* e = event_by_id(event_id);
+    if (!e) return -1;
+
+    // ON DELETE CASCADE: participants, invitations, join requests
+    for (int i = 0; i < e->participants.len; i++) {
+        MemUser* u = user_by_id(e->participants.data[i]);
+        if (u) index_erase(&u->events, event_id);
+    }
+    for (int i = 0; i < invitations.count; i++) {
+        if (invitations.rows[i].event_id == event_id) invitations.rows[i].status = ST_REJECTED;
+    }
+    for (int i = 0; i < e->join_requests.len; i++) {
+        join_requests.rows[e->join_requests.data[i] - 1].status = ST_REJECTED;
+    }
+    vec_free(&e->participants);
+    vec_free(&e->join_requests);
+    free(e->description);
+    e->description = NULL;
+    e->deleted = 1;
+    return 0;
+}
+
+static int apply_invitation_create(int event_id, int sender_id, int receiver_id) {
+    MemUser* receiver = user_by_id(receiver_id);
+    if (!receiver) return -1;
+
+    int id = TABLE_APPEND(invitations);
+    if (id < 0) return -1;
+    MemInvitation* inv = &invitations.rows[id - 1];
+    inv->event_id = event_id;
+    inv->sender_id = sender_id;
+    inv->receiver_id = receiver_id;
+    inv->status = ST_PENDING;
+    if (vec_push(&receiver->invitations, id) < 0) {
+        invitations.count--;
+        return -1;
+    }
+    return id;
+}
+
+// return: 0 nếu thành công, -2 nếu đã tham gia, -1 nếu lỗi
+static int apply_invitation_accept(int invitation_id) {
+    if (invitation_id <= 0 || invitation_id > invitations.count) return -1;
+    MemInvitation* inv = &invitations.rows[invitation_id - 1];
+    int rc = apply_participant_add(inv->event_id, inv->receiver_id);
+    if (rc == 0) inv->status = ST_ACCEPTED;
+    return rc;
+}
+
+static int apply_join_request_create(int event_id, int user_id) {
+    if (!user_by_id(user_id) || event_id <= 0 || event_id > events.count) return -1;
+
+    int id = TABLE_APPEND(join_requests);
+    if (id < 0) return -1;
+    join_requests.rows[id - 1].event_id = event_id;
+    join_requests.rows[id - 1].user_id = user_id;
+    join_requests.rows[id - 1].status = ST_PENDING;
+
+    // Event đã xóa (chỉ gặp khi nạp snapshot) không giữ danh sách join request
+    MemEvent* e = event_by_id(event_id);
+    if (e && vec_push(&e->join_requests, id) < 0) {
+        join_requests.count--;
+        return -1;
+    }
+    return id;
+}
+
+// ON CONFLICT DO NOTHING: đã là participant vẫn thành công
+static int apply_join_request_approve(int join_request_id) {
+    if (join_request_id <= 0 || join_request_id > join_requests.count) return -1;
+    MemJoinRequest* jr = &join_requests.rows[join_request_id - 1];
+    if (apply_participant_add(jr->event_id, jr->user_id) == -1) return -1;
+    jr->status = ST_ACCEPTED;
+    return 0;
+}
+
+// ---------- Khôi phục / checkpoint ----------
+
+#ifdef MEMORY_DB_WAL
+// Thêm 1 record hoàn chỉnh (đã đóng khung) vào b, return 0 hoặc -1
+static int rec_write(Buffer* b, int type, const char* fmt, ...) {
+    size_t start = wal_record_begin(b);
+    if (start == (size_t)-1) return -1;
+    va_list ap;
+    va_start(ap, fmt);
+    int rc = rec_vencode(b, type, fmt, ap);
+    va_end(ap);
+    return rc < 0 ? -1 : wal_record_end(b, start);
+}
+
+// Đọc các field theo fmt ('i' => int*, 's' => const char**, trỏ vào rec); return 0 hoặc -1
+static int rec_decode(const unsigned char* p, size_t left, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int rc = 0;
+    for (; *fmt && rc == 0; fmt++) {
+        if (left < 4) {
+            rc = -1;
+            break;
+        }
+        if (*fmt == 'i') {
+            int32_t v;
+            memcpy(&v, p, 4);
+            *va_arg(ap, int*) = v;
+            p += 4;
+            left -= 4;
+            continue;
+        }
+        uint32_t n;
+        memcpy(&n, p, 4);
+        p += 4;
+        left -= 4;
+        const char** out = va_arg(ap, const char**);
+        if (n == REC_NULL_STRING) {
+            *out = NULL;
+        } else if (n >= left || p[n] != '\0') {
+            rc = -1;
+        } else {
+            *out = (const char*)p;
+            p += n + 1;
+            left -= n + 1;
+        }
+    }
+    va_end(ap);
+    return rc == 0 && left == 0 ? 0 : -1;
+}
+
+// Dòng snapshot phải tạo ra đúng id đã ghi (bảng được dựng lại theo id tăng dần)
+static int snap_expect(int got, int want) {
+    return got == want ? 0 : -1;
+}
+
+// Status của user trong snapshot (apply_user_create luôn tạo user 'active')
+static int snap_user_status(int user_id, const char* status) {
+    MemUser* u = user_by_id(user_id);
+    if (!u) return -1;
+    snprintf(u->status, sizeof(u->status), "%s", status);
+    return 0;
+}
+
+// WalApplyFn: áp dụng 1 record WAL / snapshot lúc khởi động (chưa có thread request nào)
+static int replay_record(const unsigned char* rec, size_t len) {
+    if (len < 1) return -1;
+    const unsigned char* p = rec + 1;
+    size_t n = len - 1;
+    int a = 0, b = 0, c = 0, d = 0, st = 0;
+    const char *s1, *s2, *s3, *s4, *s5, *s6;
+
+    switch (rec[0]) {
+        case REC_USER_CREATE:
+            if (rec_decode(p, n, "sss", &s1, &s2, &s3) < 0 || !s1 || !s2 || !s3) return -1;
+            return apply_user_create(s1, s2, s3) < 0 ? -1 : 0;
+        case REC_FRIEND_REQUEST:
+            if (rec_decode(p, n, "ii", &a, &b) < 0) return -1;
+            return apply_friend_request(a, b) < 0 ? -1 : 0;
+        case REC_FRIEND_ACCEPT:
+            if (rec_decode(p, n, "i", &a) < 0) return -1;
+            return apply_friend_accept(a);
+        case REC_FRIEND_REJECT:
+            if (rec_decode(p, n, "i", &a) < 0) return -1;
+            return apply_friend_reject(a);
+        case REC_FRIEND_REMOVE:
+            if (rec_decode(p, n, "ii", &a, &b) < 0) return -1;
+            return apply_friend_remove(a, b);
+        case REC_EVENT_CREATE:
+            if (rec_decode(p, n, "isssss", &a, &s1, &s2, &s3, &s4, &s5) < 0 || !s1 || !s4 || !s5) return -1;
+            return apply_event_create(a, s1, s2, s3, s4, s5) < 0 ? -1 : 0;
+        case REC_EVENT_UPDATE:
+            if (rec_decode(p, n, "isssss", &a, &s1, &s2, &s3, &s4, &s5) < 0 || !s1 || !s4 || !s5) return -1;
+            return apply_event_update(a, s1, s2, s3, s4, s5);
+        case REC_EVENT_DELETE:
+            if (rec_decode(p, n, "i", &a) < 0) return -1;
+            return apply_event_delete(a);
+        case REC_PARTICIPANT_ADD:
+        case REC_SNAP_PARTICIPANT:
+            if (rec_decode(p, n, "ii", &a, &b) < 0) return -1;
+            return apply_participant_add(a, b);
+        case REC_INVITATION_CREATE:
+            if (rec_decode(p, n, "iii", &a, &b, &c) < 0) return -1;
+            return apply_invitation_create(a, b, c) < 0 ? -1 : 0;
+        case REC_INVITATION_ACCEPT:
+            if (rec_decode(p, n, "i", &a) < 0) return -1;
+            return apply_invitation_accept(a);
+        case REC_JOIN_REQUEST_CREATE:
+            if (rec_decode(p, n, "ii", &a, &b) < 0) return -1;
+            return apply_join_request_create(a, b) < 0 ? -1 : 0;
+        case REC_JOIN_REQUEST_APPROVE:
+            if (rec_decode(p, n, "i", &a) < 0) return -1;
+            return apply_join_request_approve(a);
+
+        case REC_SNAP_USER:
+            if (rec_decode(p, n, "issss", &a, &s1, &s2, &s3, &s4) < 0 || !s1 || !s2 || !s3 || !s4) return -1;
+            if (snap_expect(apply_user_create(s1, s2, s3), a) < 0) return -1;
+            return snap_user_status(a, s4);
+        case REC_SNAP_FRIEND_REQUEST:
+            if (rec_decode(p, n, "iiii", &a, &b, &c, &st) < 0) return -1;
+            if (snap_expect(apply_friend_request(b, c), a) < 0) return -1;
+            friend_requests.rows[a - 1].status = (RequestStatus)st;
+            return 0;
+        case REC_SNAP_FRIENDSHIP:
+            if (rec_decode(p, n, "ii", &a, &b) < 0) return -1;
+            return apply_friendship(a, b);
+        case REC_SNAP_EVENT:
+            if (rec_decode(p, n, "iiissssss", &a, &b, &c, &s1, &s2, &s3, &s4, &s5, &s6) < 0 ||
+                !s1 || !s4 || !s5 || !s6) return -1;
+            if (snap_expect(event_insert(b, s1, s2, s3, s4, s5, s6), a) < 0) return -1;
+            return c ? apply_event_delete(a) : 0;
+        case REC_SNAP_INVITATION:
+            if (rec_decode(p, n, "iiiii", &a, &b, &c, &d, &st) < 0) return -1;
+            if (snap_expect(apply_invitation_create(b, c, d), a) < 0) return -1;
+            invitations.rows[a - 1].status = (RequestStatus)st;
+            return 0;
+        case REC_SNAP_JOIN_REQUEST:
+            if (rec_decode(p, n, "iiii", &a, &b, &c, &st) < 0) return -1;
+            if (snap_expect(apply_join_request_create(b, c), a) < 0) return -1;
+            join_requests.rows[a - 1].status = (RequestStatus)st;
+            return 0;
+    }
+    fprintf(stderr, "[WAL] Unknown record type %d\n", rec[0]);
+    return -1;
+}
+
+// WalSnapshotFn: ghi toàn bộ bảng theo thứ tự id, đổi segment WAL trước khi nhả lock
+static unsigned int snapshot_state(Buffer* out) {
+    // Read lock đủ để chặn mọi thay đổi (ghi luôn cần write lock), lệnh đọc vẫn chạy song song
+    db_read_lock(__func__);
+    int rc = 0;
+    for (int i = 0; i < users.count && rc == 0; i++) {
+        const MemUser* u = &users.rows[i];
+        rc = rec_write(out, REC_SNAP_USER, "issss", u->user_id, u->username, u->email, u->password, u->status);
+    }
+    for (int i = 0; i < friend_requests.count && rc == 0; i++) {
+        const MemFriendRequest* fr = &friend_requests.rows[i];
+        rc = rec_write(out, REC_SNAP_FRIEND_REQUEST, "iiii", i + 1, fr->sender_id, fr->receiver_id, (int)fr->status);
+    }
+    for (int i = 0; i < users.count && rc == 0; i++) {
+        const MemUser* u = &users.rows[i];
+        for (int j = 0; j < u->friends.len && rc == 0; j++) {
+            if (u->friends.data[j] > u->user_id) {
+                rc = rec_write(out, REC_SNAP_FRIENDSHIP, "ii", u->user_id, u->friends.data[j]);
+            }
+        }
+    }
+    for (int i = 0; i < events.count && rc == 0; i++) {
+        const MemEvent* e = &events.rows[i];
+        rc = rec_write(out, REC_SNAP_EVENT, "iiissssss", e->event_id, e->creator_id, e->deleted, e->title,
+                       e->description, e->location, e->event_time, e->event_type, e->status);
+        for (int j = 0; j < e->participants.len && rc == 0; j++) {
+            rc = rec_write(out, REC_SNAP_PARTICIPANT, "ii", e->event_id, e->participants.data[j]);
+        }
+    }
+    for (int i = 0; i < invitations.count && rc == 0; i++) {
+        const MemInvitation* inv = &invitations.rows[i];
+        rc = rec_write(out, REC_SNAP_INVITATION, "iiiii", i + 1, inv->event_id, inv->sender_id,
+                       inv->receiver_id, (int)inv->status);
+    }
+    for (int i = 0; i < join_requests.count && rc == 0; i++) {
+        const MemJoinRequest* jr = &join_requests.rows[i];
+        rc = rec_write(out, REC_SNAP_JOIN_REQUEST, "iiii", i + 1, jr->event_id, jr->user_id, (int)jr->status);
+    }
+    unsigned int seg = rc == 0 ? wal_rotate() : 0;
+    db_unlock(__func__);
+    return seg;
+}
+#endif // MEMORY_DB_WAL
+
+// ---------- Connection management ----------
+
+static void free_state(void) {
+    for (int i = 0; i < users.count; i++) {
+        vec_free(&users.rows[i].friends);
+        vec_free(&users.rows[i].events);
+        vec_free(&users.rows[i].friend_requests);
+        vec_free(&users.rows[i].invitations);
+    }
+    for (int i = 0; i < events.count; i++) {
+        free(events.rows[i].description);
+        vec_free(&events.rows[i].participants);
+        vec_free(&events.rows[i].join_requests);
+    }
+    free(users.rows);
+    free(friend_requests.rows);
+    free(events.rows);
+    free(invitations.rows);
+    free(join_requests.rows);
+    memset(&users, 0, sizeof(users));
+    memset(&friend_requests, 0, sizeof(friend_requests));
+    memset(&events, 0, sizeof(events));
+    memset(&invitations, 0, sizeof(invitations));
+    memset(&join_requests, 0, sizeof(join_requests));
+    free(username_buckets);
+    free(email_buckets);
+    username_buckets = email_buckets = NULL;
+}
+
+// Không có round-trip tới database để gom
+void db_set_write_coalescing(int enabled) {
+    (void)enabled;
+}
+
+int db_init(const char* conninfo) {
+    (void)conninfo;
+    db_write_lock(__func__);
+    if (!initialized) {
+        username_buckets = (int*)calloc(MEM_HASH_BUCKETS, sizeof(int));
+        email_buckets = (int*)calloc(MEM_HASH_BUCKETS, sizeof(int));
+        if (!username_buckets || !email_buckets) {
+            free_state();
+            db_unlock(__func__);
+            return -1;
+        }
+        initialized = 1;
+    }
+    db_unlock(__func__);
+
+    list_cache_init();
+
+#ifdef MEMORY_DB_WAL
+    // Khôi phục chạy trước khi có thread request nào
+    if (wal_open(WAL_DATA_DIR, replay_record, snapshot_state) < 0) {
+        fprintf(stderr, "Failed to recover embedded storage from '%s'\n", WAL_DATA_DIR);
+        free_state();
+        initialized = 0;
+        return -1;
+    }
+    printf("Using embedded storage engine (DB_BACKEND=embedded): %d users, %d events loaded from '%s'\n",
+           users.count, events.count, WAL_DATA_DIR);
+#else
+    printf("Using in-memory storage backend (DB_BACKEND=memory), data is not persisted\n");
+#endif
+    return 0;
+}
+
+void db_cleanup() {
+    // Checkpoint cuối cần đọc dữ liệu => đóng WAL trước khi giải phóng
+    wal_close();
+
+    db_write_lock(__func__);
+    free_state();
+    initialized = 0;
+    db_unlock(__func__);
+
+    list_cache_destroy();
+}
+
+PGconn* db_get_connection() {
+    return NULL;
+}
+
+// Dữ liệu nằm trong tiến trình: luôn sẵn sàng
+int db_available(void) {
+    return 1;
+}
+
+// ---------- Users ----------
+
+int db_create_user(const char* username, const char* password, const char* email) {
+    if (!initialized) return -1;
+
+    if (!db_validate_username(username)) {
+        return -3; // Invalid username
+    }
+    if (!db_validate_email(email)) {
+        return -4; // Invalid email format
+    }
+    if (strlen(username) > MEM_USERNAME_LEN || strlen(email) > MEM_EMAIL_LEN) {
+        return -1; // VARCHAR quá dài
+    }
+
+    // Băm ngoài lock
+    char hashed[PASSWORD_HASH_SIZE];
+    int hrc = password_hash(password, hashed, sizeof(hashed));
+    if (hrc == PASSWORD_BUSY) {
+        return -5;
+    }
+    if (hrc != 0) {
+        return -1;
+    }
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int user_id;
+    if (user_by_name(username) || email_taken(email)) {
+        user_id = -2; // unique violation
+    } else {
+        user_id = apply_user_create(username, email, hashed);
+        if (user_id > 0) lsn = log_change(REC_USER_CREATE, "sss", username, email, hashed);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return user_id;
+}
+
+int db_find_user_by_username(const char* username, int* user_id, char* email, int email_size, int* is_active) {
+    if (!initialized) return -1;
+
+    db_read_lock(__func__);
+    MemUser* u = user_by_name(username);
+    if (u) {
+        *user_id = u->user_id;
+        snprintf(email, (size_t)email_size, "%s", u->email);
+        *is_active = is_active_user(u);
+    }
+    db_unlock(__func__);
+    return u ? 1 : 0;
+}
+
+int db_find_user_by_id(int user_id, char* username, int username_size, char* email, int email_size, int* is_active) {
+    if (!initialized) return -1;
+
+    db_read_lock(__func__);
+    MemUser* u = user_by_id(user_id);
+    if (u) {
+        snprintf(username, (size_t)username_size, "%s", u->username);
+        snprintf(email, (size_t)email_size, "%s", u->email);
+        *is_active = is_active_user(u);
+    }
+    db_unlock(__func__);
+    return u ? 1 : 0;
+}
+
+int db_verify_password(const char* username, const char* password) {
+    if (!initialized) return 0;
+
+    char stored[PASSWORD_HASH_SIZE];
+    db_read_lock(__func__);
+    MemUser* u = user_by_name(username);
+    int found = u && is_active_user(u);
+    if (found) snprintf(stored, sizeof(stored), "%s", u->password);
+    db_unlock(__func__);
+
+    return found && password_verify(password, stored, NULL) == 1;
+}
+
+int db_check_login(const char* username, const char* password, int* user_id, int* is_active) {
+    if (!initialized) return -1;
+
+    char stored[PASSWORD_HASH_SIZE];
+    db_read_lock(__func__);
+    MemUser* u = user_by_name(username);
+    if (u) {
+        *user_id = u->user_id;
+        *is_active = is_active_user(u);
+        snprintf(stored, sizeof(stored), "%s", u->password);
+    }
+    db_unlock(__func__);
+
+    if (!u) return 0; // User not found
+
+    int verified = password_verify(password, stored, NULL);
+    if (verified == PASSWORD_BUSY) return -2;
+    if (verified < 0) return -1;
+    return verified;
+}
+
+// ---------- Friends ----------
+
+// Gọi khi đang giữ lock: request pending sender -> receiver, 0 nếu không có
+static int find_pending_friend_request(int sender_id, int receiver_id) {
+    MemUser* r = user_by_id(receiver_id);
+    if (!r) return 0;
+    for (int i = 0; i < r->friend_requests.len; i++) {
+        int id = r->friend_requests.data[i];
+        MemFriendRequest* fr = &friend_requests.rows[id - 1];
+        if (fr->sender_id == sender_id && fr->status == ST_PENDING) return id;
+    }
+    return 0;
+}
+
+int db_check_friendship(int user_id1, int user_id2) {
+    if (!initialized) return 0;
+
+    db_read_lock(__func__);
+    int found = friendship_exists(user_id1, user_id2);
+    db_unlock(__func__);
+    return found;
+}
+
+int db_send_friend_request(int sender_id, int receiver_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc;
+    if (friendship_exists(sender_id, receiver_id)) {
+        rc = -2; // Already friends
+    } else if (find_pending_friend_request(receiver_id, sender_id)) {
+        rc = -4; // Pending request from receiver exists
+    } else if (find_pending_friend_request(sender_id, receiver_id)) {
+        rc = -3; // Request already sent
+    } else {
+        rc = apply_friend_request(sender_id, receiver_id);
+        if (rc > 0) lsn = log_change(REC_FRIEND_REQUEST, "ii", sender_id, receiver_id);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return rc;
+}
+
+// Gọi khi đang giữ write lock
+static int accept_friend_request_locked(int request_id, unsigned long long* lsn) {
+    if (request_id <= 0 || request_id > friend_requests.count) return -1;
+    MemFriendRequest* fr = &friend_requests.rows[request_id - 1];
+    if (fr->status != ST_PENDING) return -1;
+    if (apply_friend_accept(request_id) < 0) return -1;
+    *lsn = log_change(REC_FRIEND_ACCEPT, "i", request_id);
+
+    list_cache_invalidate(LIST_CACHE_FRIENDS, fr->sender_id);
+    list_cache_invalidate(LIST_CACHE_FRIENDS, fr->receiver_id);
+    return 0;
+}
+
+int db_accept_friend_request(int request_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc = accept_friend_request_locked(request_id, &lsn);
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return rc;
+}
+
+int db_reject_friend_request(int request_id) {
+    if (!initialized) return -1;
+
+    // Như UPDATE ... WHERE status = 'pending': không có dòng nào vẫn thành công
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    if (request_id > 0 && request_id <= friend_requests.count &&
+        friend_requests.rows[request_id - 1].status == ST_PENDING) {
+        apply_friend_reject(request_id);
+        lsn = log_change(REC_FRIEND_REJECT, "i", request_id);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return 0;
+}
+
+// accept = 1: chấp nhận, 0: từ chối request pending của sender_username
+static int respond_friend_request_by_username(int receiver_id, const char* sender_username, int accept) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc;
+    MemUser* sender = user_by_name(sender_username);
+    int request_id = sender ? find_pending_friend_request(sender->user_id, receiver_id) : 0;
+    if (!sender) {
+        rc = -2;
+    } else if (!request_id) {
+        rc = -3;
+    } else if (accept) {
+        rc = accept_friend_request_locked(request_id, &lsn);
+    } else {
+        rc = apply_friend_reject(request_id);
+        lsn = log_change(REC_FRIEND_REJECT, "i", request_id);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return rc;
+}
+
+int db_accept_friend_request_by_username(int receiver_id, const char* sender_username) {
+    return respond_friend_request_by_username(receiver_id, sender_username, 1);
+}
+
+int db_reject_friend_request_by_username(int receiver_id, const char* sender_username) {
+    return respond_friend_request_by_username(receiver_id, sender_username, 0);
+}
+
+int db_remove_friend(int user_id, int friend_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    apply_friend_remove(user_id, friend_id);
+    unsigned long long lsn = log_change(REC_FRIEND_REMOVE, "ii", user_id, friend_id);
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    list_cache_invalidate(LIST_CACHE_FRIENDS, user_id);
+    list_cache_invalidate(LIST_CACHE_FRIENDS, friend_id);
+    return 0;
+}
+
+int db_remove_friend_by_username(int user_id, const char* friend_username) {
+    if (!initialized) return -1;
+
+    db_read_lock(__func__);
+    MemUser* f = user_by_name(friend_username);
+    int friend_id = f ? f->user_id : 0;
+    int friends = f && friendship_exists(user_id, friend_id);
+    db_unlock(__func__);
+
+    if (!f) return -2;
+    if (!friends) return -3;
+    return db_remove_friend(user_id, friend_id);
+}
+
+// ---------- Danh sách (GET_FRIENDS / GET_EVENTS) ----------
+
+static int append_event_row(Buffer* out, const MemEvent* e) {
+    char id[20];
+    snprintf(id, sizeof(id), "%d", e->event_id);
+    // event_id;title;location;time;type;status
+    if (buffer_append_str(out, id) < 0 || buffer_append(out, ";", 1) < 0 ||
+        buffer_append_str(out, e->title) < 0 || buffer_append(out, ";", 1) < 0 ||
+        buffer_append_str(out, e->location) < 0 || buffer_append(out, ";", 1) < 0 ||
+        buffer_append_str(out, e->event_time) < 0 || buffer_append(out, ";", 1) < 0 ||
+        buffer_append_str(out, e->event_type) < 0 || buffer_append(out, ";", 1) < 0 ||
+        buffer_append_str(out, e->status) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int append_friend_row(Buffer* out, const MemUser* u) {
+    char id[20];
+    snprintf(id, sizeof(id), "%d", u->user_id);
+    // friend_id|username|email
+    if (buffer_append_str(out, id) < 0 || buffer_append(out, "|", 1) < 0 ||
+        buffer_append_str(out, u->username) < 0 || buffer_append(out, "|", 1) < 0 ||
+        buffer_append_str(out, u->email) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Ghi 1 trang từ index có thứ tự; gọi khi đang giữ lock
+ * @param is_event 1 = index event của user, 0 = index bạn bè
+ * @return 0 nếu thành công, -2 nếu cursor sai, -1 nếu lỗi
+ */
+static int write_index_page(const IntVec* index, int is_event, Page* page, Buffer* out, int* count) {
+    int start = 0;
+    int limit = index->len;
+    if (page) {
+        page->next[0] = '\0';
+        limit = page->limit;
+        if (page->after && page->after[0]) {
+            char key[PAGE_CURSOR_SIZE];
+            char ts[MEM_TIME_LEN + 1];
+            SortKey k;
+            if (db_split_cursor(page->after, key, sizeof(key), &k.id) < 0) return -2;
+            if (is_event && normalize_time(key, ts) < 0) return -2;
+            k.key = is_event ? ts : key;
+
+            // Bỏ qua các dòng <= cursor, như (key, id) > ($2, $3) của bản PostgreSQL
+            start = index_upper_bound(index, is_event ? cmp_event_key : cmp_friend_key, &k);
+        }
+    }
+
+    int rows = index->len - start < limit ? index->len - start : limit;
+    for (int i = 0; i < rows; i++) {
+        int id = index->data[start + i];
+        if (i > 0 && buffer_append(out, "\n", 1) < 0) return -1;
+        int rc = is_event ? append_event_row(out, &events.rows[id - 1])
+                          : append_friend_row(out, &users.rows[id - 1]);
+        if (rc < 0) return -1;
+    }
+
+    if (page && rows > 0 && start + rows < index->len) {
+        int last = index->data[start + rows - 1];
+        snprintf(page->next, sizeof(page->next), "%s,%d",
+                 is_event ? events.rows[last - 1].event_time : users.rows[last - 1].username, last);
+    }
+    *count = rows;
+    return 0;
+}
+
+int db_get_friends_list(int user_id, Page* page, Buffer* out, int* count) {
+    if (!initialized || !out || !count) return -1;
+
+    static const IntVec empty = { NULL, 0, 0 };
+    db_read_lock(__func__);
+    MemUser* u = user_by_id(user_id);
+    int rc = write_index_page(u ? &u->friends : &empty, 0, page, out, count);
+    db_unlock(__func__);
+    return rc;
+}
+
+int db_get_user_events(int user_id, Page* page, Buffer* out, int* count) {
+    if (!initialized || !out || !count) return -1;
+
+    static const IntVec empty = { NULL, 0, 0 };
+    db_read_lock(__func__);
+    MemUser* u = user_by_id(user_id);
+    int rc = write_index_page(u ? &u->events : &empty, 1, page, out, count);
+    db_unlock(__func__);
+    return rc;
+}
+
+int db_get_user_events_crebyuser(int user_id, Buffer* out, int* count) {
+    if (!initialized || !out || !count) return -1;
+
+    db_read_lock(__func__);
+    MemUser* u = user_by_id(user_id);
+    int n = 0, rc = 0;
+    for (int i = 0; u && i < u->events.len && rc == 0; i++) {
+        const MemEvent* e = &events.rows[u->events.data[i] - 1];
+        if (e->creator_id != user_id) continue;
+        if ((n > 0 && buffer_append(out, "\n", 1) < 0) || append_event_row(out, e) < 0) {
+            rc = -1;
+        } else {
+            n++;
+        }
+    }
+    db_unlock(__func__);
+
+    *count = n;
+    return rc;
+}
+
+// ---------- Events ----------
+
+int db_create_event(int creator_id,const char* event_name,const char* description,const char* location,
+                    const char* event_time,const char* event_type) {
+    if (!initialized) return -1;
+
+    char ts[MEM_TIME_LEN + 1];
+    if (!valid_event_fields(event_name, location, event_type) || normalize_time(event_time, ts) < 0) {
+        fprintf(stderr, "db_create_event error: invalid event fields\n");
+        return -1;
+    }
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int event_id = apply_event_create(creator_id, event_name, description, location, ts, event_type);
+    if (event_id > 0) {
+        lsn = log_change(REC_EVENT_CREATE, "isssss", creator_id, event_name, description, location, ts, event_type);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    if (event_id > 0) list_cache_invalidate(LIST_CACHE_EVENTS, creator_id);
+    return event_id;
+}
+
+// Xóa event list cache của mọi người tham gia (gọi khi đang giữ lock)
+static void invalidate_event_members(const MemEvent* e) {
+    list_cache_invalidate(LIST_CACHE_EVENTS, e->creator_id);
+    for (int i = 0; i < e->participants.len; i++) {
+        list_cache_invalidate(LIST_CACHE_EVENTS, e->participants.data[i]);
+    }
+}
+
+int db_update_event(int creator_id, int event_id,const char* title,const char* description,
+                    const char* location,const char* event_time,const char* event_type) {
+    if (!initialized) return -1;
+
+    char ts[MEM_TIME_LEN + 1];
+    if (!valid_event_fields(title, location, event_type) || normalize_time(event_time, ts) < 0) {
+        fprintf(stderr, "db_update_event error: invalid event fields\n");
+        return -1;
+    }
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    MemEvent* e = event_by_id(event_id);
+    int rc = 0;
+    if (e && e->creator_id == creator_id) {
+        rc = apply_event_update(event_id, title, description, location, ts, event_type) < 0 ? -1 : 1;
+        lsn = log_change(REC_EVENT_UPDATE, "isssss", event_id, title, description, location, ts, event_type);
+        invalidate_event_members(e);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return rc;
+}
+
+int db_delete_event(int user_id, int event_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    MemEvent* e = event_by_id(event_id);
+    int deleted = e && e->creator_id == user_id;
+    if (deleted) {
+        invalidate_event_members(e);
+        apply_event_delete(event_id);
+        lsn = log_change(REC_EVENT_DELETE, "i", event_id);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return deleted ? 1 : 0;
+}
+
+int db_get_event_detail_by_creator(int user_id, int event_id, Buffer* out) {
+    if (!initialized || !out) return -1;
+
+    db_read_lock(__func__);
+    MemEvent* e = event_by_id(event_id);
+    int rc = 0;
+    if (e && e->creator_id == user_id) {
+        const char* desc = e->description ? e->description : "";
+        // event_id|title|description|location|event_time|event_type|status
+        char id[16];
+        snprintf(id, sizeof(id), "%d|", e->event_id);
+        const char* parts[] = { id, e->title, "|", desc, "|", e->location, "|", e->event_time,
+                                "|", e->event_type, "|", e->status };
+        rc = 1;
+        for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]) && rc == 1; i++) {
+            if (buffer_append_str(out, parts[i]) < 0) rc = -1;
+        }
+    }
+    db_unlock(__func__);
+    return rc;
+}
+
+int db_join_event(int user_id, int event_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc = apply_participant_add(event_id, user_id);
+    if (rc == 0) lsn = log_change(REC_PARTICIPANT_ADD, "ii", event_id, user_id);
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    if (rc == 0) list_cache_invalidate(LIST_CACHE_EVENTS, user_id);
+    return rc;
+}
+
+int db_send_event_invitation(int event_id, int sender_id, int receiver_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc;
+    MemEvent* e = event_by_id(event_id);
+    MemUser* receiver = user_by_id(receiver_id);
+    if (!e || strcmp(e->status, "active") != 0) {
+        rc = -2;
+    } else if (e->creator_id != sender_id) {
+        rc = -4;
+    } else if (vec_index(&e->participants, receiver_id) >= 0) {
+        rc = -6;
+    } else if (!receiver) {
+        rc = -1; // FK violation
+    } else {
+        rc = 0;
+        for (int i = 0; i < receiver->invitations.len && !rc; i++) {
+            const MemInvitation* inv = &invitations.rows[receiver->invitations.data[i] - 1];
+            if (inv->event_id == event_id && inv->sender_id == sender_id && inv->status == ST_PENDING) rc = -5;
+        }
+        if (!rc) {
+            rc = apply_invitation_create(event_id, sender_id, receiver_id);
+            if (rc > 0) lsn = log_change(REC_INVITATION_CREATE, "iii", event_id, sender_id, receiver_id);
+        }
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return rc;
+}
+
+int db_accept_event_invitation(int receiver_id, const char* sender_username, int event_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc = -2;
+    MemUser* sender = user_by_name(sender_username);
+    MemUser* receiver = user_by_id(receiver_id);
+    int found = 0;
+    if (sender && receiver) {
+        // Lời mời pending mới nhất
+        for (int i = receiver->invitations.len - 1; i >= 0 && !found; i--) {
+            int id = receiver->invitations.data[i];
+            const MemInvitation* inv = &invitations.rows[id - 1];
+            if (inv->event_id == event_id && inv->sender_id == sender->user_id && inv->status == ST_PENDING) {
+                found = id;
+            }
+        }
+    }
+    if (found) {
+        rc = apply_invitation_accept(found);
+        if (rc == -2) rc = -3; // Đã tham gia (transaction rollback, lời mời giữ nguyên)
+        if (rc == 0) lsn = log_change(REC_INVITATION_ACCEPT, "i", found);
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    if (rc == 0) list_cache_invalidate(LIST_CACHE_EVENTS, receiver_id);
+    return rc;
+}
+
+int db_create_join_request(int user_id, int event_id) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc;
+    MemEvent* e = event_by_id(event_id);
+    if (!e || strcmp(e->status, "active") != 0) {
+        rc = -2;
+    } else if (strcmp(e->event_type, "private") != 0) {
+        rc = -3;
+    } else if (vec_index(&e->participants, user_id) >= 0) {
+        rc = 0;
+    } else {
+        rc = 1;
+        for (int i = 0; i < e->join_requests.len && rc == 1; i++) {
+            const MemJoinRequest* jr = &join_requests.rows[e->join_requests.data[i] - 1];
+            if (jr->user_id == user_id) {
+                // pending => -4, đã xử lý => vi phạm UNIQUE(event_id, user_id)
+                rc = jr->status == ST_PENDING ? -4 : -1;
+            }
+        }
+        if (rc == 1) {
+            rc = apply_join_request_create(event_id, user_id);
+            if (rc > 0) lsn = log_change(REC_JOIN_REQUEST_CREATE, "ii", event_id, user_id);
+        }
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    return rc;
+}
+
+int db_approve_join_request_by_creator(int creator_id, int event_id, const char* join_username) {
+    if (!initialized) return -1;
+
+    db_write_lock(__func__);
+    unsigned long long lsn = 0;
+    int rc;
+    int join_user_id = 0;
+    MemEvent* e = event_by_id(event_id);
+    MemUser* u = user_by_name(join_username);
+    if (!e || e->creator_id != creator_id || strcmp(e->status, "active") != 0) {
+        rc = -3;
+    } else if (!u || !is_active_user(u)) {
+        rc = -4;
+    } else {
+        rc = -2;
+        join_user_id = u->user_id;
+        for (int i = 0; i < e->join_requests.len && rc == -2; i++) {
+            int id = e->join_requests.data[i];
+            const MemJoinRequest* jr = &join_requests.rows[id - 1];
+            if (jr->user_id == join_user_id && jr->status == ST_PENDING) {
+                rc = apply_join_request_approve(id);
+                if (rc == 0) lsn = log_change(REC_JOIN_REQUEST_APPROVE, "i", id);
+            }
+        }
+    }
+    db_unlock(__func__);
+
+    wal_wait(lsn);
+    if (rc == 0) list_cache_invalidate(LIST_CACHE_EVENTS, join_user_id);
+    return rc;
+}
@@ -0,0 +1,353 @@
+#include "metrics.h"
+#include "password_hash.h"
+#include "activity_log.h"
+#include "postgres_db.h"
+#include "../common/histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define METRICS_PREFIX "event_server_"
+
+// Các lệnh được đếm riêng; lệnh lạ gộp vào UNKNOWN (phần tử cuối)
+static const char* command_names[] = {
+    CMD_REGISTER, CMD_LOGIN, CMD_LOGOUT, CMD_CREATE_EVENT, CMD_GET_EVENTS,
+    CMD_GET_EVENT_DETAIL, CMD_UPDATE_EVENT, CMD_DELETE_EVENT, CMD_GET_FRIENDS,
+    CMD_SEND_INVITATION_EVENT, CMD_ACCEPT_INVITATION_REQUEST, CMD_JOIN_EVENT,
+    CMD_ACCEPT_JOIN_REQUEST, CMD_SEND_FRIEND_REQUEST, CMD_ACCEPT_FRIEND_REQUEST,
+    CMD_REJECT_FRIEND_REQUEST, CMD_UNFRIEND, CMD_GET_EVENTS_CREBYUSER, CMD_STATS,
+    "UNKNOWN"
+};
+#define METRICS_COMMANDS ((int)(sizeof(command_names) / sizeof(command_names[0])))
+
+// Mã response được đếm riêng; 2 phần tử cuối: mã khác, không gửi response
+static const int code_values[] = { 200, 400, 401, 404, 409, 422, 500, 503 };
+#define KNOWN_CODES ((int)(sizeof(code_values) / sizeof(code_values[0])))
+#define CODE_OTHER KNOWN_CODES
+#define CODE_NONE (KNOWN_CODES + 1)
+#define METRICS_CODES (KNOWN_CODES + 2)
+
+typedef struct {
+    uint64_t requests[METRICS_COMMANDS][METRICS_CODES];
+    Histogram latency[METRICS_COMMANDS];    // micro giây
+} MetricsShard;
+
+static MetricsShard* shards = NULL;
+static unsigned int next_shard = 0;
+static __thread MetricsShard* tls_shard = NULL;
+static int connections = 0;
+static time_t started_at = 0;
+static SessionManager* session_manager = NULL;
+
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;  // Chỉ giữa các lần đọc
+
+static int http_sock = -1;
+static int http_running = 0;
+static int http_stop = 0;
+static pthread_t http_thread;
+
+static int command_index(const char* command) {
+    for (int i = 0; i < METRICS_COMMANDS - 1; i++) {
+        if (strcmp(command, command_names[i]) == 0) return i;
+    }
+    return METRICS_COMMANDS - 1;
+}
+
+static int code_index(int code) {
+    if (code == 0) return CODE_NONE;
+    for (int i = 0; i < KNOWN_CODES; i++) {
+        if (code_values[i] == code) return i;
+    }
+    return CODE_OTHER;
+}
+
+static const char* code_label(int idx, char* buf, size_t size) {
+    if (idx == CODE_NONE) return "none";
+    if (idx == CODE_OTHER) return "other";
+    snprintf(buf, size, "%d", code_values[idx]);
+    return buf;
+}
+
+void metrics_record_request(const char* command, int code, uint64_t elapsed_us) {
+    if (!shards || !command) return;
+
+    MetricsShard* s = tls_shard;
+    if (!s) {
+        unsigned int n = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED);
+        s = tls_shard = &shards[n % METRICS_SHARDS];
+    }
+
+    int cmd = command_index(command);
+    __atomic_fetch_add(&s->requests[cmd][code_index(code)], 1, __ATOMIC_RELAXED);
+    hist_record_atomic(&s->latency[cmd], elapsed_us);
+}
+
+void metrics_connection_opened(void) {
+    __atomic_fetch_add(&connections, 1, __ATOMIC_RELAXED);
+}
+
+void metrics_connection_closed(void) {
+    __atomic_fetch_sub(&connections, 1, __ATOMIC_RELAXED);
+}
+
+// Cộng mọi shard (gọi khi đang giữ report_mutex); agg do caller cấp phát
+static void aggregate(MetricsShard* agg) {
+    for (int c = 0; c < METRICS_COMMANDS; c++) {
+        memset(agg->requests[c], 0, sizeof(agg->requests[c]));
+        hist_init(&agg->latency[c]);
+    }
+    for (int i = 0; i < METRICS_SHARDS; i++) {
+        for (int c = 0; c < METRICS_COMMANDS; c++) {
+            for (int k = 0; k < METRICS_CODES; k++) {
+                agg->requests[c][k] += __atomic_load_n(&shards[i].requests[c][k], __ATOMIC_RELAXED);
+            }
+            hist_merge_atomic(&agg->latency[c], &shards[i].latency[c]);
+        }
+    }
+}
+
+// Tổng request của 1 command (theo bộ đếm mã response)
+static uint64_t command_total(const MetricsShard* agg, int c) {
+    uint64_t total = 0;
+    for (int k = 0; k < METRICS_CODES; k++) total += agg->requests[c][k];
+    return total;
+}
+
+int metrics_report_text(Buffer* out) {
+    if (!shards) return -1;
+    MetricsShard* agg = malloc(sizeof(MetricsShard));
+    if (!agg) return -1;
+
+    int rc = 0;
+    char line[512];
+    snprintf(line, sizeof(line),
+             "uptime=%lds connections=%d sessions=%d password_queue=%d db_up=%d activity_log_dropped=%lu\n",
+             (long)(time(NULL) - started_at), __atomic_load_n(&connections, __ATOMIC_RELAXED),
+             session_manager ? session_active_count(session_manager) : 0,
+             password_pool_queue_depth(), db_available(), activity_log_dropped());
+    rc |= buffer_append_str(out, line);
+
+    pthread_mutex_lock(&report_mutex);
+    aggregate(agg);
+    for (int c = 0; c < METRICS_COMMANDS; c++) {
+        uint64_t total = command_total(agg, c);
+        if (total == 0) continue;
+
+        const Histogram* h = &agg->latency[c];
+        uint64_t errors = agg->requests[c][code_index(500)] + agg->requests[c][code_index(503)];
+        int len = snprintf(line, sizeof(line),
+                           "%s count=%llu errors=%llu p50=%.3f p90=%.3f p99=%.3f max=%.3f ms codes:",
+                           command_names[c], (unsigned long long)total, (unsigned long long)errors,
+                           hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+                           hist_percentile(h, 99) / 1000.0, h->max / 1000.0);
+        for (int k = 0; k < METRICS_CODES && len < (int)sizeof(line); k++) {
+            if (agg->requests[c][k] == 0) continue;
+            char code[16];
+            len += snprintf(line + len, sizeof(line) - (size_t)len, " %s=%llu",
+                            code_label(k, code, sizeof(code)), (unsigned long long)agg->requests[c][k]);
+        }
+        rc |= buffer_append_str(out, line);
+        rc |= buffer_append(out, "\n", 1);
+    }
+    pthread_mutex_unlock(&report_mutex);
+
+    free(agg);
+    return rc < 0 ? -1 : 0;
+}
+
+int metrics_report_prometheus(Buffer* out) {
+    if (!shards) return -1;
+    MetricsShard* agg = malloc(sizeof(MetricsShard));
+    if (!agg) return -1;
+
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+    int rc = 0;
+    char line[256];
+
+    pthread_mutex_lock(&report_mutex);
+    aggregate(agg);
+
+    rc |= buffer_append_str(out,
+        "# HELP " METRICS_PREFIX "requests_total Requests handled, by command and response code.\n"
+        "# TYPE " METRICS_PREFIX "requests_total counter\n");
+    for (int c = 0; c < METRICS_COMMANDS; c++) {
+        for (int k = 0; k < METRICS_CODES; k++) {
+            if (agg->requests[c][k] == 0) continue;
+            char code[16];
+            snprintf(line, sizeof(line), METRICS_PREFIX "requests_total{command=\"%s\",code=\"%s\"} %llu\n",
+                     command_names[c], code_label(k, code, sizeof(code)),
+                     (unsigned long long)agg->requests[c][k]);
+            rc |= buffer_append_str(out, line);
+        }
+    }
+
+    rc |= buffer_append_str(out,
+        "# HELP " METRICS_PREFIX "request_duration_seconds Request handling latency, by command.\n"
+        "# TYPE " METRICS_PREFIX "request_duration_seconds summary\n");
+    for (int c = 0; c < METRICS_COMMANDS; c++) {
+        const Histogram* h = &agg->latency[c];
+        if (h->total == 0) continue;
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            snprintf(line, sizeof(line),
+                     METRICS_PREFIX "request_duration_seconds{command=\"%s\",quantile=\"%g\"} %.6f\n",
+                     command_names[c], quantiles[q], hist_percentile(h, quantiles[q] * 100) / 1e6);
+            rc |= buffer_append_str(out, line);
+        }
+        snprintf(line, sizeof(line),
+                 METRICS_PREFIX "request_duration_seconds_sum{command=\"%s\"} %.6f\n"
+                 METRICS_PREFIX "request_duration_seconds_count{command=\"%s\"} %llu\n",
+                 command_names[c], h->sum / 1e6, command_names[c], (unsigned long long)h->total);
+        rc |= buffer_append_str(out, line);
+    }
+    pthread_mutex_unlock(&report_mutex);
+    free(agg);
+
+    snprintf(line, sizeof(line),
+             "# TYPE " METRICS_PREFIX "connections gauge\n" METRICS_PREFIX "connections %d\n"
+             "# TYPE " METRICS_PREFIX "sessions gauge\n" METRICS_PREFIX "sessions %d\n",
+             __atomic_load_n(&connections, __ATOMIC_RELAXED),
+             session_manager ? session_active_count(session_manager) : 0);
+    rc |= buffer_append_str(out, line);
+    snprintf(line, sizeof(line),
+             "# TYPE " METRICS_PREFIX "password_pool_queue_depth gauge\n"
+             METRICS_PREFIX "password_pool_queue_depth %d\n"
+             "# TYPE " METRICS_PREFIX "db_up gauge\n" METRICS_PREFIX "db_up %d\n",
+             password_pool_queue_depth(), db_available());
+    rc |= buffer_append_str(out, line);
+    snprintf(line, sizeof(line),
+             "# TYPE " METRICS_PREFIX "activity_log_dropped_total counter\n"
+             METRICS_PREFIX "activity_log_dropped_total %lu\n",
+             activity_log_dropped());
+    rc |= buffer_append_str(out, line);
+
+    return rc < 0 ? -1 : 0;
+}
+
+static int write_all(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Xử lý 1 kết nối HTTP: chỉ GET /metrics, trả xong thì đóng
+static void serve_http(int sock) {
+    struct timeval tv = { METRICS_HTTP_TIMEOUT, 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // Chỉ cần dòng đầu của request
+    char req[1024];
+    size_t got = 0;
+    while (got < sizeof(req) - 1) {
+        ssize_t n = recv(sock, req + got, sizeof(req) - 1 - got, 0);
+        if (n <= 0) break;
+        got += (size_t)n;
+        req[got] = '\0';
+        if (strstr(req, "\r\n")) break;
+    }
+    req[got] = '\0';
+
+    Buffer body;
+    buffer_init(&body);
+    const char* status = "404 Not Found";
+    if (strncmp(req, "GET /metrics ", 13) == 0 || strncmp(req, "GET /metrics?", 13) == 0) {
+        status = metrics_report_prometheus(&body) == 0 ? "200 OK" : "500 Internal Server Error";
+    }
+
+    char head[256];
+    int head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                            "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                            status, body.data ? body.len : 0);
+    if (write_all(sock, head, (size_t)head_len) == 0 && body.data) {
+        write_all(sock, body.data, body.len);
+    }
+    buffer_free(&body);
+}
+
+static void* http_main(void* arg) {
+    (void)arg;
+    struct pollfd pfd = { http_sock, POLLIN, 0 };
+    while (!__atomic_load_n(&http_stop, __ATOMIC_ACQUIRE)) {
+        // Poll có timeout để thấy cờ dừng
+        if (poll(&pfd, 1, 500) <= 0) continue;
+        int c = accept(http_sock, NULL, NULL);
+        if (c < 0) continue;
+        serve_http(c);
+        close(c);
+    }
+    return NULL;
+}
+
+static int http_start(int port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) return -1;
+
+    int opt = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)port);
+
+    if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(s, 16) < 0) {
+        close(s);
+        return -1;
+    }
+
+    http_sock = s;
+    http_stop = 0;
+    if (pthread_create(&http_thread, NULL, http_main, NULL) != 0) {
+        close(s);
+        http_sock = -1;
+        return -1;
+    }
+    http_running = 1;
+    return 0;
+}
+
+int metrics_init(SessionManager* sm, int port) {
+    shards = calloc(METRICS_SHARDS, sizeof(MetricsShard));
+    if (!shards) return -1;
+    for (int i = 0; i < METRICS_SHARDS; i++) {
+        for (int c = 0; c < METRICS_COMMANDS; c++) hist_init(&shards[i].latency[c]);
+    }
+    session_manager = sm;
+    started_at = time(NULL);
+
+    if (port > 0) {
+        if (http_start(port) < 0) {
+            fprintf(stderr, "Warning: metrics endpoint not started on 127.0.0.1:%d\n", port);
+        } else {
+            printf("[METRICS] Prometheus endpoint on http://127.0.0.1:%d/metrics\n", port);
+        }
+    }
+    return 0;
+}
+
+void metrics_shutdown(void) {
+    if (http_running) {
+        __atomic_store_n(&http_stop, 1, __ATOMIC_RELEASE);
+        pthread_join(http_thread, NULL);
+        close(http_sock);
+        http_sock = -1;
+        http_running = 0;
+    }
+    free(shards);
+    shards = NULL;
+}
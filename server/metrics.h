@@ -0,0 +1,50 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// =========================================
+// SERVER METRICS
+// - Mỗi request: đếm theo (command, mã response) + histogram độ trễ theo command
+// - Ghi không lock: mỗi thread ghi vào 1 shard riêng (chia vòng tròn khi thread
+//   nhiều hơn METRICS_SHARDS) bằng atomic relaxed; khi đọc mới cộng các shard lại
+// - Gauge: kết nối đang mở, session đang active, hàng đợi password pool, trạng thái DB
+// - Xem qua lệnh STATS (chỉ client từ localhost) hoặc endpoint Prometheus
+//   http://127.0.0.1:METRICS_PORT/metrics (thread riêng, chỉ nghe trên loopback)
+// =========================================
+#include "../common/protocol.h"
+#include "session.h"
+#include <stdint.h>
+
+#define METRICS_SHARDS 16
+#define METRICS_PORT 9464
+#define METRICS_HTTP_TIMEOUT 2        // Giây chờ request HTTP
+
+/**
+ * Chức năng: Cấp phát shard, khởi động endpoint Prometheus
+ * @param sm    Session manager (đọc số session active cho gauge)
+ * @param port  Cổng HTTP trên 127.0.0.1, <= 0 = không mở endpoint
+ * @return 0 nếu thành công, -1 nếu hết bộ nhớ (endpoint lỗi chỉ in cảnh báo)
+ */
+int metrics_init(SessionManager* sm, int port);
+
+// Dừng endpoint, giải phóng shard
+void metrics_shutdown(void);
+
+/**
+ * Chức năng: Ghi 1 request đã xử lý xong
+ * @param command     Tên lệnh (lệnh lạ được gộp vào UNKNOWN)
+ * @param code        Mã response đã gửi (0 = không gửi response)
+ * @param elapsed_us  Thời gian xử lý
+ */
+void metrics_record_request(const char* command, int code, uint64_t elapsed_us);
+
+// Gauge kết nối: gọi khi thread client bắt đầu / kết thúc
+void metrics_connection_opened(void);
+void metrics_connection_closed(void);
+
+// Bảng text cho lệnh STATS (mỗi command 1 dòng + gauge), return 0 hoặc -1
+int metrics_report_text(Buffer* out);
+
+// Prometheus text exposition format 0.0.4, return 0 hoặc -1
+int metrics_report_prometheus(Buffer* out);
+
+#endif // METRICS_H
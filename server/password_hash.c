@@ -0,0 +1,271 @@
+#include "password_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <crypt.h>
+
+typedef struct PasswordJob {
+    int verify;                 // 1 = verify, 0 = hash
+    const char* password;
+    const char* stored;         // verify: hash lưu trong DB
+    char* out;                  // hash: buffer kết quả
+    size_t out_size;
+    int result;
+    int legacy;                 // verify: giá trị lưu là plaintext cũ (cần băm lại)
+    int done;
+    pthread_cond_t done_cond;
+    struct PasswordJob* next;
+} PasswordJob;
+
+typedef struct {
+    PasswordJob* head;
+    PasswordJob* tail;
+    int count;
+} JobQueue;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static JobQueue verify_queue;   // Ưu tiên (LOGIN)
+static JobQueue hash_queue;     // REGISTER / rehash
+static pthread_t* workers = NULL;
+static int worker_count = 0;
+static int max_queue = PASSWORD_POOL_QUEUE;
+static int pool_running = 0;
+
+// So sánh không phụ thuộc vị trí byte khác nhau đầu tiên
+static int constant_time_equals(const char* a, const char* b) {
+    size_t la = strlen(a);
+    size_t lb = strlen(b);
+    unsigned char diff = (unsigned char)(la != lb);
+    size_t n = la < lb ? la : lb;
+    for (size_t i = 0; i < n; i++) {
+        diff |= (unsigned char)(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+static int do_hash(struct crypt_data* data, const char* password, char* out, size_t out_size) {
+    char setting[CRYPT_GENSALT_OUTPUT_SIZE];
+
+    // count = 0 => cost mặc định của thuật toán, rbytes = NULL => salt từ OS
+    if (!crypt_gensalt_rn(PASSWORD_HASH_PREFIX, 0, NULL, 0, setting, sizeof(setting)) &&
+        !crypt_gensalt_rn(PASSWORD_HASH_FALLBACK, 0, NULL, 0, setting, sizeof(setting))) {
+        perror("[PASSWORD] crypt_gensalt_rn failed");
+        return PASSWORD_ERROR;
+    }
+
+    memset(data, 0, sizeof(*data));
+    char* hashed = crypt_rn(password, setting, data, sizeof(*data));
+    if (!hashed || hashed[0] == '*' || strlen(hashed) >= out_size) {
+        return PASSWORD_ERROR;
+    }
+
+    strcpy(out, hashed);
+    return 0;
+}
+
+// 1 nếu giá trị lưu có dạng hash do do_hash tạo ra (tiền tố của thuật toán đang dùng)
+static int has_hash_prefix(const char* stored) {
+    return strncmp(stored, PASSWORD_HASH_PREFIX, strlen(PASSWORD_HASH_PREFIX)) == 0 ||
+           strncmp(stored, PASSWORD_HASH_FALLBACK, strlen(PASSWORD_HASH_FALLBACK)) == 0;
+}
+
+static int do_verify(struct crypt_data* data, const char* password, const char* stored, int* legacy) {
+    memset(data, 0, sizeof(*data));
+    char* hashed = crypt_rn(password, stored, data, sizeof(*data));
+    if (!hashed || hashed[0] == '*') {
+        // Có tiền tố hash nhưng libcrypt không nhận => plaintext cũ tình cờ bắt đầu bằng tiền tố
+        // (hash do do_hash tạo luôn hợp lệ)
+        *legacy = 1;
+        return constant_time_equals(password, stored);
+    }
+    return constant_time_equals(hashed, stored);
+}
+
+static void run_job(struct crypt_data* data, PasswordJob* job) {
+    if (job->verify) {
+        job->result = do_verify(data, job->password, job->stored, &job->legacy);
+    } else {
+        job->result = do_hash(data, job->password, job->out, job->out_size);
+    }
+}
+
+static void queue_push(JobQueue* q, PasswordJob* job) {
+    job->next = NULL;
+    if (q->tail) q->tail->next = job; else q->head = job;
+    q->tail = job;
+    q->count++;
+}
+
+static PasswordJob* queue_pop(JobQueue* q) {
+    PasswordJob* job = q->head;
+    if (job) {
+        q->head = job->next;
+        if (!q->head) q->tail = NULL;
+        q->count--;
+    }
+    return job;
+}
+
+static void* worker_main(void* arg) {
+    (void)arg;
+    // struct crypt_data lớn (~32KB) => cấp phát 1 lần cho mỗi worker
+    struct crypt_data* data = (struct crypt_data*)malloc(sizeof(struct crypt_data));
+    if (!data) {
+        fprintf(stderr, "[PASSWORD] Memory allocation failed for worker\n");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    while (1) {
+        while (pool_running && verify_queue.count == 0 && hash_queue.count == 0) {
+            pthread_cond_wait(&work_cond, &pool_mutex);
+        }
+        if (!pool_running) break;
+
+        PasswordJob* job = queue_pop(&verify_queue);
+        if (!job) job = queue_pop(&hash_queue);
+        pthread_mutex_unlock(&pool_mutex);
+
+        run_job(data, job);
+
+        pthread_mutex_lock(&pool_mutex);
+        job->done = 1;
+        pthread_cond_signal(&job->done_cond);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    free(data);
+    return NULL;
+}
+
+// Đưa job vào pool và chờ kết quả
+static int submit_and_wait(PasswordJob* job) {
+    pthread_mutex_lock(&pool_mutex);
+
+    if (!pool_running) {
+        pthread_mutex_unlock(&pool_mutex);
+        // Chưa có pool (tool / benchmark): chạy trực tiếp trên thread gọi
+        struct crypt_data* data = (struct crypt_data*)malloc(sizeof(struct crypt_data));
+        if (!data) return PASSWORD_ERROR;
+        run_job(data, job);
+        free(data);
+        return job->result;
+    }
+
+    JobQueue* q = job->verify ? &verify_queue : &hash_queue;
+    if (q->count >= max_queue) {
+        pthread_mutex_unlock(&pool_mutex);
+        return PASSWORD_BUSY;
+    }
+
+    pthread_cond_init(&job->done_cond, NULL);
+    job->done = 0;
+    queue_push(q, job);
+    pthread_cond_signal(&work_cond);
+
+    while (!job->done) {
+        pthread_cond_wait(&job->done_cond, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_cond_destroy(&job->done_cond);
+    return job->result;
+}
+
+int password_pool_init(int threads, int queue_size) {
+    if (threads <= 0 || queue_size <= 0) return -1;
+
+    pthread_mutex_lock(&pool_mutex);
+    if (pool_running) {
+        pthread_mutex_unlock(&pool_mutex);
+        return 0;
+    }
+    workers = (pthread_t*)calloc((size_t)threads, sizeof(pthread_t));
+    if (!workers) {
+        pthread_mutex_unlock(&pool_mutex);
+        return -1;
+    }
+    max_queue = queue_size;
+    pool_running = 1;
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0) {
+            perror("[PASSWORD] Thread creation failed");
+            break;
+        }
+        worker_count++;
+    }
+
+    if (worker_count == 0) {
+        password_pool_destroy();
+        return -1;
+    }
+    return 0;
+}
+
+void password_pool_destroy(void) {
+    pthread_mutex_lock(&pool_mutex);
+    pool_running = 0;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    worker_count = 0;
+    free(workers);
+    workers = NULL;
+
+    // Trả lỗi cho các job còn trong hàng đợi
+    pthread_mutex_lock(&pool_mutex);
+    PasswordJob* job;
+    while ((job = queue_pop(&verify_queue)) || (job = queue_pop(&hash_queue))) {
+        job->result = PASSWORD_ERROR;
+        job->done = 1;
+        pthread_cond_signal(&job->done_cond);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+int password_hash(const char* password, char* out, size_t out_size) {
+    if (!password || !out || out_size == 0) return PASSWORD_ERROR;
+
+    PasswordJob job;
+    memset(&job, 0, sizeof(job));
+    job.verify = 0;
+    job.password = password;
+    job.out = out;
+    job.out_size = out_size;
+    return submit_and_wait(&job);
+}
+
+int password_verify(const char* password, const char* stored, int* needs_rehash) {
+    if (!password || !stored) return PASSWORD_ERROR;
+
+    // Plaintext cũ: so sánh trực tiếp, không tốn CPU của pool
+    // Chỉ tiền tố của thuật toán đang dùng mới là hash: plaintext cũ bắt đầu bằng '$' vẫn kiểm tra được
+    if (!has_hash_prefix(stored)) {
+        int match = constant_time_equals(password, stored);
+        if (needs_rehash) *needs_rehash = match;
+        return match;
+    }
+
+    PasswordJob job;
+    memset(&job, 0, sizeof(job));
+    job.verify = 1;
+    job.password = password;
+    job.stored = stored;
+    int rc = submit_and_wait(&job);
+    if (needs_rehash) *needs_rehash = rc == 1 && job.legacy;
+    return rc;
+}
+
+int password_pool_queue_depth(void) {
+    pthread_mutex_lock(&pool_mutex);
+    int depth = verify_queue.count + hash_queue.count;
+    pthread_mutex_unlock(&pool_mutex);
+    return depth;
+}
@@ -0,0 +1,52 @@
+#ifndef PASSWORD_HASH_H
+#define PASSWORD_HASH_H
+
+#include <stddef.h>
+
+// =========================================
+// PASSWORD HASHING POOL
+// Băm / kiểm tra mật khẩu bằng KDF của libcrypt (yescrypt, fallback bcrypt)
+// - Chạy trên pool thread CPU riêng, số thread cố định => chi phí CPU có giới hạn
+// - Mỗi loại job có hàng đợi riêng giới hạn kích thước (backpressure):
+//   hàng đợi đầy thì trả về PASSWORD_BUSY ngay thay vì xếp hàng vô hạn
+// - Job verify (LOGIN) được ưu tiên hơn job hash (REGISTER)
+// =========================================
+#define PASSWORD_POOL_THREADS 2
+#define PASSWORD_POOL_QUEUE 32          // Số job chờ tối đa mỗi hàng đợi
+#define PASSWORD_HASH_SIZE 256          // Vừa cột users.password VARCHAR(255)
+#define PASSWORD_HASH_PREFIX "$y$"      // yescrypt
+#define PASSWORD_HASH_FALLBACK "$2b$"   // bcrypt nếu libcrypt không có yescrypt
+
+// Mã lỗi
+#define PASSWORD_ERROR -1
+#define PASSWORD_BUSY -2   // Hàng đợi đầy, caller nên trả 503
+
+/**
+ * Chức năng: Khởi tạo pool
+ * @param threads     Số thread băm
+ * @param queue_size  Số job chờ tối đa mỗi hàng đợi
+ * @return 0 nếu thành công, -1 nếu lỗi
+ */
+int password_pool_init(int threads, int queue_size);
+void password_pool_destroy(void);
+
+/**
+ * Chức năng: Băm mật khẩu (tạo salt ngẫu nhiên)
+ * @param out  Chuỗi hash kết quả (tối thiểu PASSWORD_HASH_SIZE byte)
+ * @return 0 nếu thành công, PASSWORD_BUSY, PASSWORD_ERROR
+ */
+int password_hash(const char* password, char* out, size_t out_size);
+
+/**
+ * Chức năng: Kiểm tra mật khẩu với giá trị lưu trong DB
+ * - Giá trị không bắt đầu bằng PASSWORD_HASH_PREFIX / PASSWORD_HASH_FALLBACK, hoặc có tiền tố
+ *   nhưng không phải hash hợp lệ, được coi là plaintext cũ (trước khi có KDF)
+ * @param needs_rehash  (có thể NULL) = 1 nếu giá trị lưu là plaintext cũ và mật khẩu khớp
+ * @return 1 nếu khớp, 0 nếu không khớp, PASSWORD_BUSY, PASSWORD_ERROR
+ */
+int password_verify(const char* password, const char* stored, int* needs_rehash);
+
+// Số job đang chờ (cả 2 hàng đợi)
+int password_pool_queue_depth(void);
+
+#endif // PASSWORD_HASH_H
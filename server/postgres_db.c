@@ -1,34 +1,432 @@
 #include "postgres_db.h"
+#include "user_cache.h"
+#include "list_cache.h"
+#include "cache_listener.h"
+#include "activity_log.h"
+#include "write_coalescer.h"
+#include "query_stats.h"
+#include "trace.h"
+#include "../common/histogram.h"
+#include "db_common.h"
+#include "password_hash.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
 
 static PGconn* conn = NULL;
 
+// 1 PGconn chỉ dùng được bởi 1 thread tại 1 thời điểm: mọi lệnh trên conn giữ conn_mutex
+// (đệ quy: transaction giữ mutex từ BEGIN tới COMMIT/ROLLBACK, các lệnh bên trong lock lại)
+static pthread_mutex_t conn_mutex;
+static pthread_cond_t health_cond = PTHREAD_COND_INITIALIZER;     // Đánh thức thread health
+static pthread_cond_t reconnect_cond = PTHREAD_COND_INITIALIZER;  // conn vừa được thay mới
+static int conn_healthy = 0;      // Circuit breaker: 0 = mở (fail fast), 1 = đóng
+static time_t conn_last_ok = 0;   // Lần cuối 1 lệnh chạy xong trên conn còn sống
+static int health_running = 0;
+static int health_stop = 0;
+static pthread_t health_thread;
+static char* health_conninfo = NULL;
+static int write_coalescing = 0;  // db_set_write_coalescing
+
+// Tên các prepared statement (chuẩn bị 1 lần trong db_init)
+#define STMT_CHECK_LOGIN "check_login"
+
+// Chuẩn bị các câu lệnh nằm trên đường nóng
+static int prepare_statements(PGconn* c) {
+    PGresult* res = PQprepare(c, STMT_CHECK_LOGIN,
+        "SELECT user_id, status, password FROM users WHERE username = $1",
+        1, NULL);
+    
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        fprintf(stderr, "Prepare %s failed: %s\n", STMT_CHECK_LOGIN, PQerrorMessage(c));
+        PQclear(res);
+        return -1;
+    }
+    PQclear(res);
+    return 0;
+}
+
+// Gọi khi đang giữ conn_mutex: mở circuit breaker, thread health bắt đầu kết nối lại
+static void mark_unhealthy(void) {
+    if (!conn_healthy) return;
+    __atomic_store_n(&conn_healthy, 0, __ATOMIC_RELEASE);
+    fprintf(stderr, "[DB] Connection lost, failing requests fast until reconnected\n");
+    pthread_cond_signal(&health_cond);
+}
+
+// Kết quả lỗi trả ngay khi breaker đang mở (không chạm tới mạng)
+static PGresult* unavailable_result(void) {
+    return PQmakeEmptyPGresult(NULL, PGRES_FATAL_ERROR);
+}
+
+static PGresult* conn_exec(const char* stmt, const char* sql, int nparams, const char* const* params) {
+    if (stmt) return PQexecPrepared(conn, stmt, nparams, params, NULL, NULL, 0);
+    if (nparams < 0) return PQexec(conn, sql);
+    return PQexecParams(conn, sql, nparams, NULL, params, NULL, NULL, 0);
+}
+
+static int result_failed(const PGresult* res) {
+    ExecStatusType st = PQresultStatus(res);
+    return st != PGRES_COMMAND_OK && st != PGRES_TUPLES_OK;
+}
+
+/**
+ * EXPLAIN (ANALYZE, BUFFERS) cho lệnh chậm (gọi khi đang giữ conn_mutex, ngoài transaction)
+ * - Chạy trong BEGIN/ROLLBACK để lệnh ghi không bị áp dụng 2 lần
+ * - Prepared statement: EXPLAIN EXECUTE stmt($1, ...)
+ */
+static void capture_plan(const char* stmt, const char* sql, int nparams,
+                         const char* const* params, Buffer* plan) {
+    Buffer q;
+    buffer_init(&q);
+    buffer_append_str(&q, "EXPLAIN (ANALYZE, BUFFERS) ");
+    if (stmt) {
+        buffer_append_str(&q, "EXECUTE ");
+        buffer_append_str(&q, stmt);
+        for (int i = 0; i < nparams; i++) {
+            char arg[16];
+            snprintf(arg, sizeof(arg), "%s$%d", i == 0 ? "(" : ", ", i + 1);
+            buffer_append_str(&q, arg);
+        }
+        if (nparams > 0) buffer_append(&q, ")", 1);
+    } else {
+        buffer_append_str(&q, sql);
+    }
+
+    PQclear(PQexec(conn, "BEGIN"));
+    PGresult* res = PQexecParams(conn, q.data, nparams, NULL, params, NULL, NULL, 0);
+    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
+        for (int i = 0; i < PQntuples(res); i++) {
+            buffer_append_str(plan, PQgetvalue(res, i, 0));
+            buffer_append(plan, "\n", 1);
+        }
+    } else {
+        buffer_append_str(plan, "EXPLAIN failed: ");
+        buffer_append_str(plan, PQresultErrorMessage(res));
+    }
+    PQclear(res);
+    PQclear(PQexec(conn, "ROLLBACK"));
+    buffer_free(&q);
+}
+
+// Đo 1 lần chạy trên conn, ghi histogram + slow query log (gọi khi đang giữ conn_mutex)
+static PGresult* timed_exec(const char* name, const char* stmt, const char* sql, int nparams,
+                            const char* const* params) {
+    db_probe_start(name, stmt ? stmt : sql);
+    uint64_t start = hist_now_us();
+    PGresult* res = conn_exec(stmt, sql, nparams, params);
+    uint64_t end = hist_now_us();
+    uint64_t elapsed = end - start;
+    int failed = result_failed(res);
+    trace_db_span(name, start, end);
+    db_probe_done(name, failed, elapsed);
+
+    int flags = query_stats_record(name, stmt ? stmt : sql, elapsed, failed);
+    if (flags & QUERY_SLOW) {
+        Buffer plan;
+        buffer_init(&plan);
+        // Lệnh điều khiển transaction (nparams < 0) không cần plan
+        if ((flags & QUERY_EXPLAIN) && nparams >= 0 && PQstatus(conn) == CONNECTION_OK &&
+            PQtransactionStatus(conn) == PQTRANS_IDLE) {
+            capture_plan(stmt, sql, nparams, params, &plan);
+        }
+        query_stats_log_slow(name, stmt ? stmt : sql, nparams, params, elapsed, plan.data);
+        buffer_free(&plan);
+    }
+    return res;
+}
+
+/**
+ * Chạy 1 lệnh trên conn (stmt = tên prepared statement, nparams < 0 = PQexec không tham số)
+ * - Breaker mở: trả lỗi ngay
+ * - Mất kết nối: mở breaker; lệnh đọc (idempotent) ngoài transaction thì chờ tối đa
+ *   DB_RETRY_WAIT_MS cho thread health kết nối lại rồi chạy lại 1 lần
+ */
+static PGresult* run_statement(const char* name, const char* stmt, const char* sql, int nparams,
+                               const char* const* params, int idempotent) {
+    pthread_mutex_lock(&conn_mutex);
+    if (!conn_healthy) {
+        pthread_mutex_unlock(&conn_mutex);
+        return unavailable_result();
+    }
+
+    int in_tx = PQtransactionStatus(conn) != PQTRANS_IDLE;
+    PGresult* res = timed_exec(name, stmt, sql, nparams, params);
+    if (PQstatus(conn) == CONNECTION_OK) {
+        conn_last_ok = time(NULL);
+        pthread_mutex_unlock(&conn_mutex);
+        return res;
+    }
+
+    mark_unhealthy();
+    // conn_mutex là mutex đệ quy: pthread_cond_timedwait chỉ nhả 1 tầng khóa, nên chỉ chờ khi
+    // thread này giữ đúng 1 tầng. Ngoài transaction thì đúng như vậy (chỉ tx_begin khóa lồng,
+    // và BEGIN không phải lệnh đọc); không gọi run_statement khi đang giữ conn_mutex theo cách khác
+    if (idempotent && !in_tx) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += DB_RETRY_WAIT_MS / 1000;
+        deadline.tv_nsec += (DB_RETRY_WAIT_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!conn_healthy && !health_stop) {
+            if (pthread_cond_timedwait(&reconnect_cond, &conn_mutex, &deadline) == ETIMEDOUT) break;
+        }
+        if (conn_healthy) {
+            PQclear(res);
+            res = timed_exec(name, stmt, sql, nparams, params);
+            if (PQstatus(conn) == CONNECTION_OK) conn_last_ok = time(NULL);
+            else mark_unhealthy();
+        }
+    }
+    pthread_mutex_unlock(&conn_mutex);
+    return res;
+}
+
+// Các lệnh được thống kê theo hàm db_* gọi chúng (__func__) + câu SQL
+// Lệnh đọc: được chạy lại sau khi kết nối lại
+#define exec_read(sql, nparams, params) run_statement(__func__, NULL, sql, nparams, params, 1)
+#define exec_read_prepared(stmt, nparams, params) run_statement(__func__, stmt, NULL, nparams, params, 1)
+// Lệnh ghi: chỉ chạy 1 lần (không biết lệnh đã commit hay chưa khi mất kết nối)
+#define exec_params(sql, nparams, params) run_statement(__func__, NULL, sql, nparams, params, 0)
+
+/**
+ * Mở transaction: giữ conn_mutex tới tx_commit/tx_rollback để lệnh của thread khác
+ * không chen vào giữa
+ * @return 0 nếu thành công, -1 nếu lỗi (không giữ mutex)
+ */
+static int tx_begin(void) {
+    pthread_mutex_lock(&conn_mutex);
+    PGresult* res = run_statement(__func__, NULL, "BEGIN", -1, NULL, 0);
+    int ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    PQclear(res);
+    if (!ok) {
+        pthread_mutex_unlock(&conn_mutex);
+        return -1;
+    }
+    return 0;
+}
+
+static void tx_rollback(void) {
+    PQclear(run_statement(__func__, NULL, "ROLLBACK", -1, NULL, 0));
+    pthread_mutex_unlock(&conn_mutex);
+}
+
+// return 0 nếu COMMIT thành công, -1 nếu lỗi (đã ROLLBACK)
+static int tx_commit(void) {
+    PGresult* res = run_statement(__func__, NULL, "COMMIT", -1, NULL, 0);
+    int ok = PQresultStatus(res) == PGRES_COMMAND_OK && strcmp(PQcmdStatus(res), "COMMIT") == 0;
+    PQclear(res);
+    if (!ok) PQclear(run_statement(__func__, NULL, "ROLLBACK", -1, NULL, 0));
+    pthread_mutex_unlock(&conn_mutex);
+    return ok ? 0 : -1;
+}
+
+static PGconn* health_connect(void) {
+    PGconn* c = PQconnectdb(health_conninfo);
+    if (PQstatus(c) != CONNECTION_OK) {
+        fprintf(stderr, "[DB] Reconnect failed: %s", PQerrorMessage(c));
+        PQfinish(c);
+        return NULL;
+    }
+    if (prepare_statements(c) < 0) {
+        PQfinish(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void health_wait(int seconds) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += seconds;
+    pthread_cond_timedwait(&health_cond, &conn_mutex, &ts);
+}
+
+/**
+ * Thread health
+ * - Breaker đóng: ping "SELECT 1" khi conn rảnh quá DB_HEALTH_INTERVAL giây
+ * - Breaker mở: mở kết nối mới (không giữ conn_mutex, request vẫn fail fast),
+ *   chuẩn bị lại prepared statement, thay conn rồi đóng breaker; lỗi thì backoff lũy thừa
+ */
+static void* health_main(void* arg) {
+    (void)arg;
+    int backoff = 1;
+
+    pthread_mutex_lock(&conn_mutex);
+    while (!health_stop) {
+        if (conn_healthy) {
+            health_wait(DB_HEALTH_INTERVAL);
+            if (health_stop || !conn_healthy || time(NULL) - conn_last_ok < DB_HEALTH_INTERVAL) continue;
+
+            PGresult* res = PQexec(conn, "SELECT 1");
+            if (PQresultStatus(res) == PGRES_TUPLES_OK) conn_last_ok = time(NULL);
+            else mark_unhealthy();
+            PQclear(res);
+            continue;
+        }
+
+        pthread_mutex_unlock(&conn_mutex);
+        PGconn* c = health_connect();
+        pthread_mutex_lock(&conn_mutex);
+
+        if (!c) {
+            health_wait(backoff);
+            backoff = backoff * 2 > DB_RECONNECT_MAX_BACKOFF ? DB_RECONNECT_MAX_BACKOFF : backoff * 2;
+            continue;
+        }
+
+        PGconn* old = conn;
+        conn = c;
+        conn_last_ok = time(NULL);
+        __atomic_store_n(&conn_healthy, 1, __ATOMIC_RELEASE);
+        backoff = 1;
+        pthread_cond_broadcast(&reconnect_cond);
+        fprintf(stderr, "[DB] Reconnected to PostgreSQL\n");
+        PQfinish(old);
+    }
+    pthread_mutex_unlock(&conn_mutex);
+    return NULL;
+}
+
+int db_available(void) {
+    return __atomic_load_n(&conn_healthy, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Chạy 1 lệnh ghi độc lập: qua write coalescer (chung transaction với các lệnh ghi đồng thời)
+ * nếu đang chạy, ngược lại autocommit trên conn như cũ
+ * Kết quả dùng như PQexecParams; chỉ trả về sau khi lệnh đã được COMMIT
+ */
+static PGresult* write_statement(const char* name, const char* sql, int nparams, const char* const* params) {
+    PGresult* res;
+    uint64_t start = hist_now_us();
+    if (write_coalescer_exec(sql, nparams, params, &res) < 0) {
+        return run_statement(name, NULL, sql, nparams, params, 0);
+    }
+
+    // Thời gian tính cả lúc chờ gom lô + COMMIT (không EXPLAIN: lệnh chạy trên kết nối khác)
+    uint64_t end = hist_now_us();
+    uint64_t elapsed = end - start;
+    int failed = result_failed(res);
+    trace_db_span(name, start, end);
+    db_probe_done(name, failed, elapsed);
+    if (query_stats_record(name, sql, elapsed, failed) & QUERY_SLOW) {
+        query_stats_log_slow(name, sql, nparams, params, elapsed, NULL);
+    }
+    return res;
+}
+#define exec_write(sql, nparams, params) write_statement(__func__, sql, nparams, params)
+
+// Bật / tắt write coalescer cho db_init (write_coalesce trong database.conf)
+void db_set_write_coalescing(int enabled) {
+    write_coalescing = enabled;
+}
+
 // Initialize database connection
 int db_init(const char* conninfo) {
-    conn = PQconnectdb(conninfo);
+    // Timeout/keepalive để lệnh trên kết nối chết không treo conn_mutex quá lâu
+    size_t len = strlen(conninfo) + sizeof(DB_CONN_OPTIONS) + 1;
+    health_conninfo = malloc(len);
+    if (!health_conninfo) return -1;
+    snprintf(health_conninfo, len, "%s %s", conninfo, DB_CONN_OPTIONS);
+
+    conn = PQconnectdb(health_conninfo);
     
     if (PQstatus(conn) != CONNECTION_OK) {
         fprintf(stderr, "Connection to database failed: %s\n", PQerrorMessage(conn));
         PQfinish(conn);
         conn = NULL;
+        free(health_conninfo);
+        health_conninfo = NULL;
         return -1;
     }
     
+    if (prepare_statements(conn) < 0) {
+        PQfinish(conn);
+        conn = NULL;
+        free(health_conninfo);
+        health_conninfo = NULL;
+        return -1;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&conn_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    conn_healthy = 1;
+    conn_last_ok = time(NULL);
+
+    // Health check + tự kết nối lại khi mất kết nối
+    health_stop = 0;
+    if (pthread_create(&health_thread, NULL, health_main, NULL) == 0) {
+        health_running = 1;
+    } else {
+        fprintf(stderr, "Warning: database health thread not started, no automatic reconnect\n");
+    }
+    
+    user_cache_init();
+    list_cache_init();
+    
+    // Các kết nối phụ dưới đây dùng cùng DB_CONN_OPTIONS: mất host database thì lệnh trên đó
+    // lỗi sau tcp_user_timeout thay vì chờ timeout TCP của kernel
+    // Nhận invalidation từ các server_app khác qua LISTEN/NOTIFY
+    if (cache_listener_start(health_conninfo) < 0) {
+        fprintf(stderr, "Warning: cache listener not started, caches rely on TTL only\n");
+    }
+    
+    // Ghi activity_logs theo lô (COPY) trên kết nối riêng
+    if (activity_log_start(health_conninfo, ACTIVITY_LOG_BATCH, ACTIVITY_LOG_FLUSH_MS) < 0) {
+        fprintf(stderr, "Warning: activity log shipper not started, logging to file only\n");
+    }
+
+    // Gom lệnh ghi đồng thời (CREATE_EVENT, bạn bè) vào chung 1 transaction
+    if (write_coalescing &&
+        write_coalescer_start(health_conninfo, WRITE_COALESCE_WINDOW_US, WRITE_COALESCE_MAX_BATCH) < 0) {
+        fprintf(stderr, "Warning: write coalescer not started, writes use autocommit\n");
+    }
     printf("Connected to PostgreSQL database successfully\n");
     return 0;
 }
 
 // Cleanup database connection
 void db_cleanup() {
+    Buffer report;
+    buffer_init(&report);
+    if (query_stats_report(&report) == 0 && report.data) {
+        printf("[DB] Query latency:\n%s", report.data);
+    }
+    buffer_free(&report);
+    query_stats_close();
+
+    write_coalescer_stop();
+    activity_log_stop();
+    cache_listener_stop();
+    if (health_running) {
+        pthread_mutex_lock(&conn_mutex);
+        health_stop = 1;
+        pthread_cond_signal(&health_cond);
+        pthread_cond_broadcast(&reconnect_cond);
+        pthread_mutex_unlock(&conn_mutex);
+        pthread_join(health_thread, NULL);
+        health_running = 0;
+    }
     if (conn) {
         PQfinish(conn);
         conn = NULL;
     }
+    free(health_conninfo);
+    health_conninfo = NULL;
+    user_cache_destroy();
+    list_cache_destroy();
 }
 
 // Get database connection
@@ -36,43 +434,6 @@ PGconn* db_get_connection() {
     return conn;
 }
 
-// Validate username (no special characters except underscore)
-int db_validate_username(const char* username) {
-    if (username == NULL || strlen(username) == 0) {
-        return 0;
-    }
-    
-    // Check for special characters (except underscore)
-    for (int i = 0; username[i] != '\0'; i++) {
-        char c = username[i];
-        if (c == '!' || c == '@' || c == '#' || c == '$' || c == '%' || 
-            c == '^' || c == '&' || c == '*' || c == '(' || c == ')' || c == '|') {
-            return 0;
-        }
-    }
-    
-    return 1;
-}
-
-// Validate email format (basic check for @ and .)
-int db_validate_email(const char* email) {
-    if (email == NULL || strlen(email) == 0) {
-        return 0;
-    }
-    
-    const char* at = strchr(email, '@');
-    if (at == NULL || at == email) {
-        return 0;  // No @ or @ at the beginning
-    }
-    
-    const char* dot = strchr(at, '.');
-    if (dot == NULL || dot == at + 1 || dot[1] == '\0') {
-        return 0;  // No . after @ or . right after @ or . at the end
-    }
-    
-    return 1;
-}
-
 // Create new user
 int db_create_user(const char* username, const char* password, const char* email) {
     if (!conn) return -1;
@@ -87,11 +448,21 @@ int db_create_user(const char* username, const char* password, const char* email
         return -4; // Invalid email format
     }
     
-    const char* paramValues[3] = {username, password, email};
+    // Chỉ lưu hash (KDF chạy trên password pool)
+    char hashed[PASSWORD_HASH_SIZE];
+    int hrc = password_hash(password, hashed, sizeof(hashed));
+    if (hrc == PASSWORD_BUSY) {
+        return -5; // Pool băm mật khẩu đang quá tải
+    }
+    if (hrc != 0) {
+        return -1;
+    }
+    
+    const char* paramValues[3] = {username, hashed, email};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_params(
         "INSERT INTO users (username, password, email) VALUES ($1, $2, $3) RETURNING user_id",
-        3, NULL, paramValues, NULL, NULL, 0);
+        3, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         // Check if it's a unique violation (username already exists)
@@ -114,11 +485,21 @@ int db_create_user(const char* username, const char* password, const char* email
 int db_find_user_by_username(const char* username, int* user_id, char* email, int email_size, int* is_active) {
     if (!conn) return -1;
     
+    CachedUser cached;
+    if (user_cache_get_by_username(username, &cached)) {
+        *user_id = cached.user_id;
+        strncpy(email, cached.email, email_size - 1);
+        email[email_size - 1] = '\0';
+        *is_active = cached.is_active;
+        return 1;
+    }
+    unsigned long generation = user_cache_generation();
+    
     const char* paramValues[1] = {username};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_read(
         "SELECT user_id, email, status FROM users WHERE username = $1",
-        1, NULL, paramValues, NULL, NULL, 0);
+        1, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         PQclear(res);
@@ -135,6 +516,12 @@ int db_find_user_by_username(const char* username, int* user_id, char* email, in
     email[email_size - 1] = '\0';
     *is_active = strcmp(PQgetvalue(res, 0, 2), "active") == 0 ? 1 : 0;
     
+    cached.user_id = *user_id;
+    snprintf(cached.username, sizeof(cached.username), "%s", username);
+    snprintf(cached.email, sizeof(cached.email), "%s", PQgetvalue(res, 0, 1));
+    cached.is_active = *is_active;
+    user_cache_put(&cached, generation);
+    
     PQclear(res);
     return 1; // User found
 }
@@ -143,13 +530,24 @@ int db_find_user_by_username(const char* username, int* user_id, char* email, in
 int db_find_user_by_id(int user_id, char* username, int username_size, char* email, int email_size, int* is_active) {
     if (!conn) return -1;
     
+    CachedUser cached;
+    if (user_cache_get_by_id(user_id, &cached)) {
+        strncpy(username, cached.username, username_size - 1);
+        username[username_size - 1] = '\0';
+        strncpy(email, cached.email, email_size - 1);
+        email[email_size - 1] = '\0';
+        *is_active = cached.is_active;
+        return 1;
+    }
+    unsigned long generation = user_cache_generation();
+    
     char user_id_str[20];
     snprintf(user_id_str, sizeof(user_id_str), "%d", user_id);
     const char* paramValues[1] = {user_id_str};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_read(
         "SELECT username, email, status FROM users WHERE user_id = $1",
-        1, NULL, paramValues, NULL, NULL, 0);
+        1, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         PQclear(res);
@@ -167,32 +565,101 @@ int db_find_user_by_id(int user_id, char* username, int username_size, char* ema
     email[email_size - 1] = '\0';
     *is_active = strcmp(PQgetvalue(res, 0, 2), "active") == 0 ? 1 : 0;
     
+    cached.user_id = user_id;
+    snprintf(cached.username, sizeof(cached.username), "%s", PQgetvalue(res, 0, 0));
+    snprintf(cached.email, sizeof(cached.email), "%s", PQgetvalue(res, 0, 1));
+    cached.is_active = *is_active;
+    user_cache_put(&cached, generation);
+    
     PQclear(res);
     return 1; // User found
 }
 
+// Thay mật khẩu plaintext cũ bằng hash (sau khi đăng nhập đúng)
+static void upgrade_legacy_password(int user_id, const char* password) {
+    char hashed[PASSWORD_HASH_SIZE];
+    if (password_hash(password, hashed, sizeof(hashed)) != 0) {
+        return; // Pool bận => thử lại ở lần đăng nhập sau
+    }
+    
+    char user_id_str[20];
+    snprintf(user_id_str, sizeof(user_id_str), "%d", user_id);
+    const char* paramValues[2] = {hashed, user_id_str};
+    
+    PGresult* res = exec_params(
+        "UPDATE users SET password = $1 WHERE user_id = $2",
+        2, paramValues);
+    
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        fprintf(stderr, "[DB_ERROR] Password upgrade failed: %s\n", PQresultErrorMessage(res));
+    }
+    PQclear(res);
+}
+
 // Verify password
 int db_verify_password(const char* username, const char* password) {
     if (!conn) return 0;
     
-    const char* paramValues[2] = {username, password};
+    const char* paramValues[1] = {username};
     
-    PGresult* res = PQexecParams(conn,
-        "SELECT user_id FROM users WHERE username = $1 AND password = $2 AND status = 'active'",
-        2, NULL, paramValues, NULL, NULL, 0);
+    PGresult* res = exec_read(
+        "SELECT user_id, password FROM users WHERE username = $1 AND status = 'active'",
+        1, paramValues);
     
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         PQclear(res);
         return 0;
     }
     
-    int found = PQntuples(res) > 0;
+    int user_id = atoi(PQgetvalue(res, 0, 0));
+    int needs_rehash = 0;
+    int found = password_verify(password, PQgetvalue(res, 0, 1), &needs_rehash) == 1;
     PQclear(res);
     
+    if (found && needs_rehash) {
+        upgrade_legacy_password(user_id, password);
+    }
+    
     return found;
 }
 
 
+// Check username + password bằng 1 round trip (prepared statement)
+int db_check_login(const char* username, const char* password, int* user_id, int* is_active) {
+    if (!conn) return -1;
+    
+    const char* paramValues[1] = {username};
+    
+    PGresult* res = exec_read_prepared(STMT_CHECK_LOGIN, 1, paramValues);
+    
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        fprintf(stderr, "db_check_login error: %s\n", PQresultErrorMessage(res));
+        PQclear(res);
+        return -1;
+    }
+    
+    if (PQntuples(res) == 0) {
+        PQclear(res);
+        return 0; // User not found
+    }
+    
+    *user_id = atoi(PQgetvalue(res, 0, 0));
+    *is_active = strcmp(PQgetvalue(res, 0, 1), "active") == 0 ? 1 : 0;
+    int needs_rehash = 0;
+    int verified = password_verify(password, PQgetvalue(res, 0, 2), &needs_rehash);
+    PQclear(res);
+    
+    if (verified == PASSWORD_BUSY) {
+        return -2; // Pool băm mật khẩu đang quá tải
+    }
+    if (verified < 0) {
+        return -1;
+    }
+    if (verified == 1 && needs_rehash) {
+        upgrade_legacy_password(*user_id, password);
+    }
+    return verified;
+}
 
 // Send friend request
 int db_send_friend_request(int sender_id, int receiver_id) {
@@ -209,9 +676,9 @@ int db_send_friend_request(int sender_id, int receiver_id) {
     
     // Check if there's a pending request from receiver to sender
     const char* checkParams[2] = {receiver_id_str, sender_id_str};
-    PGresult* checkRes = PQexecParams(conn,
+    PGresult* checkRes = exec_read(
         "SELECT request_id FROM friend_requests WHERE sender_id = $1 AND receiver_id = $2 AND status = 'pending'",
-        2, NULL, checkParams, NULL, NULL, 0);
+        2, checkParams);
     
     if (PQresultStatus(checkRes) == PGRES_TUPLES_OK && PQntuples(checkRes) > 0) {
         PQclear(checkRes);
@@ -221,9 +688,9 @@ int db_send_friend_request(int sender_id, int receiver_id) {
     
     // Check if there's already a pending request from sender to receiver
     const char* checkParams2[2] = {sender_id_str, receiver_id_str};
-    checkRes = PQexecParams(conn,
+    checkRes = exec_read(
         "SELECT request_id FROM friend_requests WHERE sender_id = $1 AND receiver_id = $2 AND status = 'pending'",
-        2, NULL, checkParams2, NULL, NULL, 0);
+        2, checkParams2);
     
     if (PQresultStatus(checkRes) == PGRES_TUPLES_OK && PQntuples(checkRes) > 0) {
         PQclear(checkRes);
@@ -234,14 +701,14 @@ int db_send_friend_request(int sender_id, int receiver_id) {
     const char* paramValues[2] = {sender_id_str, receiver_id_str};
     
     // Insert or update old rejected/accepted requests to pending
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_write(
         "INSERT INTO friend_requests (sender_id, receiver_id, status, created_at) VALUES ($1, $2, 'pending', CURRENT_TIMESTAMP) "
         "ON CONFLICT (sender_id, receiver_id) DO UPDATE SET status = 'pending', created_at = CURRENT_TIMESTAMP, responded_at = NULL "
         "RETURNING request_id",
-        2, NULL, paramValues, NULL, NULL, 0);
+        2, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "[DB_ERROR] Send friend request failed: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "[DB_ERROR] Send friend request failed: %s\n", PQresultErrorMessage(res));
         PQclear(res);
         return -1;
     }
@@ -254,65 +721,45 @@ int db_send_friend_request(int sender_id, int receiver_id) {
 
 
 // Accept friend request
+// 1 câu lệnh (UPDATE + INSERT trong CTE) thay cho BEGIN/.../COMMIT để gom được qua write coalescer
 int db_accept_friend_request(int request_id) {
     if (!conn) return -1;
     
     char request_id_str[20];
     snprintf(request_id_str, sizeof(request_id_str), "%d", request_id);
     
-    // Begin transaction
-    PGresult* res = PQexec(conn, "BEGIN");
-    PQclear(res);
-    const char* paramValues1[1] = {request_id_str};
-    res = PQexecParams(conn,
-        "SELECT sender_id, receiver_id FROM friend_requests WHERE request_id = $1 AND status = 'pending'",
-        1, NULL, paramValues1, NULL, NULL, 0);
+    const char* paramValues[1] = {request_id_str};
+    PGresult* res = exec_write(
+        "WITH req AS ("
+        "  UPDATE friend_requests SET status = 'accepted', responded_at = CURRENT_TIMESTAMP "
+        "  WHERE request_id = $1 AND status = 'pending' "
+        "  RETURNING sender_id, receiver_id"
+        "), ins AS ("
+        "  INSERT INTO friendships (user1_id, user2_id) "
+        "  SELECT LEAST(sender_id, receiver_id), GREATEST(sender_id, receiver_id) FROM req "
+        "  ON CONFLICT (user1_id, user2_id) DO NOTHING"
+        ") "
+        "SELECT sender_id, receiver_id FROM req",
+        1, paramValues);
     
-    if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
-        fprintf(stderr, "[DB_ERROR] Accept friend request failed: No pending request with ID %d\n", request_id);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        fprintf(stderr, "[DB_ERROR] Accept friend request failed: %s\n", PQresultErrorMessage(res));
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
         return -1;
     }
-    
-    int sender_id = atoi(PQgetvalue(res, 0, 0));
-    int receiver_id = atoi(PQgetvalue(res, 0, 1));
-    PQclear(res);
-    
-    // Update request status
-    res = PQexecParams(conn,
-        "UPDATE friend_requests SET status = 'accepted', responded_at = CURRENT_TIMESTAMP WHERE request_id = $1",
-        1, NULL, paramValues1, NULL, NULL, 0);
-    
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        fprintf(stderr, "[DB_ERROR] Accept friend request failed: UPDATE error - %s\n", PQerrorMessage(conn));
+    if (PQntuples(res) == 0) {
+        fprintf(stderr, "[DB_ERROR] Accept friend request failed: No pending request with ID %d\n", request_id);
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
         return -1;
     }
-    PQclear(res);
-    
-    // Create friendship (ignore if already exists)
-    char sender_id_str[20], receiver_id_str[20];
-    snprintf(sender_id_str, sizeof(sender_id_str), "%d", sender_id);
-    snprintf(receiver_id_str, sizeof(receiver_id_str), "%d", receiver_id);
-    
-    const char* paramValues2[2] = {sender_id_str, receiver_id_str};
-    res = PQexecParams(conn,
-        "INSERT INTO friendships (user1_id, user2_id) VALUES (LEAST($1::int, $2::int), GREATEST($1::int, $2::int)) ON CONFLICT (user1_id, user2_id) DO NOTHING",
-        2, NULL, paramValues2, NULL, NULL, 0);
     
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        fprintf(stderr, "[DB_ERROR] Accept friend request failed: INSERT friendship error - %s\n", PQerrorMessage(conn));
-        PQclear(res);
-        PQexec(conn, "ROLLBACK");
-        return -1;
-    }
+    int sender_id = atoi(PQgetvalue(res, 0, 0));
+    int receiver_id = atoi(PQgetvalue(res, 0, 1));
     PQclear(res);
     
-    // Commit transaction
-    res = PQexec(conn, "COMMIT");
-    PQclear(res);
+    // Danh sách bạn bè của cả 2 phía đã thay đổi
+    list_cache_invalidate(LIST_CACHE_FRIENDS, sender_id);
+    list_cache_invalidate(LIST_CACHE_FRIENDS, receiver_id);
   
     return 0;
 }
@@ -326,9 +773,9 @@ int db_reject_friend_request(int request_id) {
     
     const char* paramValues[1] = {request_id_str};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_write(
         "UPDATE friend_requests SET status = 'rejected' WHERE request_id = $1 AND status = 'pending'",
-        1, NULL, paramValues, NULL, NULL, 0);
+        1, paramValues);
     
     int success = PQresultStatus(res) == PGRES_COMMAND_OK;
     PQclear(res);
@@ -353,9 +800,9 @@ int db_accept_friend_request_by_username(int receiver_id, const char* sender_use
     
     const char* paramValues[2] = {sender_id_str, receiver_id_str};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_read(
         "SELECT request_id FROM friend_requests WHERE sender_id = $1 AND receiver_id = $2 AND status = 'pending'",
-        2, NULL, paramValues, NULL, NULL, 0);
+        2, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         PQclear(res);
@@ -384,9 +831,9 @@ int db_reject_friend_request_by_username(int receiver_id, const char* sender_use
     
     const char* paramValues[2] = {sender_id_str, receiver_id_str};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_read(
         "SELECT request_id FROM friend_requests WHERE sender_id = $1 AND receiver_id = $2 AND status = 'pending'",
-        2, NULL, paramValues, NULL, NULL, 0);
+        2, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
         PQclear(res);
@@ -429,91 +876,135 @@ int db_remove_friend(int user_id, int friend_id) {
     
     const char* paramValues[2] = {user_id_str, friend_id_str};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_write(
         "DELETE FROM friendships WHERE (user1_id = LEAST($1::int, $2::int) AND user2_id = GREATEST($1::int, $2::int))",
-        2, NULL, paramValues, NULL, NULL, 0);
+        2, paramValues);
     
     int success = PQresultStatus(res) == PGRES_COMMAND_OK;
     PQclear(res);
     
+    if (success) {
+        list_cache_invalidate(LIST_CACHE_FRIENDS, user_id);
+        list_cache_invalidate(LIST_CACHE_FRIENDS, friend_id);
+    }
     
     return success ? 0 : -1;
 }
 
 
 
+// Ghi thẳng các dòng của PGresult vào buffer (1 lần reserve cho cả response)
+//   - Các cột cách nhau bởi sep, các dòng cách nhau bởi '\n'
+static int append_rows(const PGresult* res, int rows, Buffer* out, char sep) {
+    int cols = PQnfields(res);
+    
+    size_t total = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            total += (size_t)PQgetlength(res, i, j) + 1; // + sep hoặc '\n'
+        }
+    }
+    if (buffer_reserve(out, total) < 0) return -1;
+    
+    char* p = out->data + out->len;
+    for (int i = 0; i < rows; i++) {
+        if (i > 0) *p++ = '\n';
+        for (int j = 0; j < cols; j++) {
+            if (j > 0) *p++ = sep;
+            int n = PQgetlength(res, i, j);
+            memcpy(p, PQgetvalue(res, i, j), (size_t)n);
+            p += n;
+        }
+    }
+    *p = '\0';
+    out->len = (size_t)(p - out->data);
+    return 0;
+}
+
 /**
- * Chức năng : Lấy danh sách bạn bè của user
- * - Query từ bảng friendships và JOIN với users
- * - Trả về thông tin: user_id, username, email
- * - Sắp xếp theo username
- * @param results - Mảng chứa kết quả (cần free bằng db_free_results() sau khi dùng)
- * @param count - Số lượng bạn bè
- * @return 0 nếu thành công, -1 nếu lỗi
+ * Chạy query của 1 trang rồi ghi kết quả vào out
+ * - Query lấy limit + 1 dòng: có dòng thứ limit + 1 => còn trang sau
+ * - Cursor trang sau lấy từ (key_col, id_col) của dòng cuối cùng được trả về
+ * @param sql_all   Query khi không phân trang (page == NULL)
+ * @param sql_first Query trang đầu: $1 = user_id, $2 = limit
+ * @param sql_after Query trang sau: $1 = user_id, $2 = limit, $3 = key, $4 = id
+ * @return 0 nếu thành công, -2 nếu cursor sai, -1 nếu lỗi
  */
-int db_get_friends_list(int user_id, char*** results, int* count) {
-    if (!conn || !results || !count) return -1;
+static int fetch_page(const char* fn, const char* sql_all, const char* sql_first, const char* sql_after,
+                      int user_id, Page* page, int key_col, int id_col,
+                      Buffer* out, int* count, char sep) {
+    char uid[20], limit_str[20];
+    char key[PAGE_CURSOR_SIZE], id[20];
+    int after_id = 0;
+    const char* params[4] = { uid, limit_str, key, id };
+    const char* sql = sql_all;
+    int nparams = 1;
 
-    char uid[20];
     snprintf(uid, sizeof(uid), "%d", user_id);
-
-    const char* params[1] = { uid };
-
-    PGresult* res = PQexecParams(
-        conn,
-        "SELECT "
-        "CASE "
-        "  WHEN f.user1_id = $1 THEN u2.user_id "
-        "  ELSE u1.user_id "
-        "END AS friend_id, "
-        "CASE "
-        "  WHEN f.user1_id = $1 THEN u2.username "
-        "  ELSE u1.username "
-        "END AS username, "
-        "CASE "
-        "  WHEN f.user1_id = $1 THEN u2.email "
-        "  ELSE u1.email "
-        "END AS email "
-        "FROM friendships f "
-        "JOIN users u1 ON u1.user_id = f.user1_id "
-        "JOIN users u2 ON u2.user_id = f.user2_id "
-        "WHERE f.user1_id = $1 OR f.user2_id = $1 "
-        "ORDER BY username",
-        1, NULL, params, NULL, NULL, 0
-    );
-
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_get_friends_list error: %s\n", PQerrorMessage(conn));
-        PQclear(res);
-        return -1;
+    if (page) {
+        snprintf(limit_str, sizeof(limit_str), "%d", page->limit + 1);
+        page->next[0] = '\0';
+        sql = sql_first;
+        nparams = 2;
+        if (page->after && page->after[0]) {
+            if (db_split_cursor(page->after, key, sizeof(key), &after_id) < 0) return -2;
+            snprintf(id, sizeof(id), "%d", after_id);
+            sql = sql_after;
+            nparams = 4;
+        }
     }
 
-    *count = PQntuples(res);
-    *results = NULL;
-
-    if (*count == 0) {
+    PGresult* res = run_statement(fn, NULL, sql, nparams, params, 1);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        // SQLSTATE lớp 22 (data exception): key trong cursor không hợp lệ, VD timestamp sai
+        const char* state = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+        int rc = (page && nparams == 4 && state && strncmp(state, "22", 2) == 0) ? -2 : -1;
+        if (rc == -1) fprintf(stderr, "%s error: %s\n", fn, PQresultErrorMessage(res));
         PQclear(res);
-        return 0;
+        return rc;
     }
 
-    *results = (char**)malloc(*count * sizeof(char*));
-    if (!*results) {
-        PQclear(res);
-        return -1;
+    int rows = PQntuples(res);
+    if (page && rows > page->limit) {
+        rows = page->limit;
+        snprintf(page->next, sizeof(page->next), "%s,%s",
+                 PQgetvalue(res, rows - 1, key_col), PQgetvalue(res, rows - 1, id_col));
     }
 
-    for (int i = 0; i < *count; i++) {
-        char buffer[512];
-        snprintf(buffer, sizeof(buffer), "%s|%s|%s",
-                 PQgetvalue(res, i, 0), // friend_id
-                 PQgetvalue(res, i, 1), // username
-                 PQgetvalue(res, i, 2)  // email
-        );
-        (*results)[i] = strdup(buffer);
-    }
+    *count = rows;
+    int rc = append_rows(res, rows, out, sep);
 
     PQclear(res);
-    return 0;
+    return rc;
+}
+
+// Bạn bè của $1: range scan trên friend_edges (user_id, friend_id)
+#define FRIENDS_SELECT \
+    "SELECT u.user_id, u.username, u.email " \
+    "FROM friend_edges fe " \
+    "JOIN users u ON u.user_id = fe.friend_id " \
+    "WHERE fe.user_id = $1 "
+#define FRIENDS_ORDER "ORDER BY u.username, u.user_id "
+
+/**
+ * Chức năng : Lấy danh sách bạn bè của user
+ * - Query từ bảng friend_edges và JOIN với users
+ * - Trả về thông tin: user_id, username, email
+ * - Sắp xếp theo (username, user_id), phân trang theo keyset
+ * @param page - Trang cần lấy (NULL = toàn bộ)
+ * @param out - Buffer nhận kết quả, mỗi dòng: friend_id|username|email
+ * @param count - Số lượng bạn bè
+ * @return 0 nếu thành công, -2 nếu cursor sai, -1 nếu lỗi
+ */
+int db_get_friends_list(int user_id, Page* page, Buffer* out, int* count) {
+    if (!conn || !out || !count) return -1;
+
+    // friend_id|username|email
+    return fetch_page("db_get_friends_list",
+        FRIENDS_SELECT FRIENDS_ORDER,
+        FRIENDS_SELECT FRIENDS_ORDER "LIMIT $2",
+        FRIENDS_SELECT "AND (u.username, u.user_id) > ($3, $4::int) " FRIENDS_ORDER "LIMIT $2",
+        user_id, page, 1, 0, out, count, '|');
 }
 
 
@@ -527,9 +1018,9 @@ int db_check_friendship(int user_id1, int user_id2) {
     
     const char* paramValues[2] = {user_id1_str, user_id2_str};
     
-    PGresult* res = PQexecParams(conn,
-        "SELECT 1 FROM friendships WHERE (user1_id = LEAST($1::int, $2::int) AND user2_id = GREATEST($1::int, $2::int))",
-        2, NULL, paramValues, NULL, NULL, 0);
+    PGresult* res = exec_read(
+        "SELECT 1 FROM friend_edges WHERE user_id = $1 AND friend_id = $2",
+        2, paramValues);
     
     int found = PQntuples(res) > 0;
     PQclear(res);
@@ -564,15 +1055,15 @@ int db_create_event(int creator_id,const char* event_name,const char* descriptio
         event_type        // $6
     };
 
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_write(
         "INSERT INTO events (creator_id, title, description, location, event_time, event_type) "
         "VALUES ($1, $2, $3, $4, $5, $6) "
         "RETURNING event_id",
-        6, NULL, params, NULL, NULL, 0
+        6, params
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_create_event error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_create_event error: %s\n", PQresultErrorMessage(res));
         PQclear(res);
         return -1;
     }
@@ -580,6 +1071,9 @@ int db_create_event(int creator_id,const char* event_name,const char* descriptio
     int event_id = atoi(PQgetvalue(res, 0, 0));
     PQclear(res);
 
+    // Trigger đã thêm creator vào event_participants
+    list_cache_invalidate(LIST_CACHE_EVENTS, creator_id);
+
     return event_id;
 }
 
@@ -601,22 +1095,35 @@ int db_update_event(int creator_id, int event_id,const char* title,const char* d
     snprintf(eid, sizeof(eid), "%d", event_id);
 
     const char* params[7] = {title,description,location,event_time,event_type,uid,eid};
-    PGresult* res = PQexecParams(
-        conn,
-        "UPDATE events "
-        "SET title=$1, description=$2, location=$3, event_time=$4, event_type=$5 "
-        "WHERE creator_id=$6 AND event_id=$7",
-        7, NULL, params, NULL, NULL, 0
+    // Trả về người tham gia của event vừa sửa để invalidate event list cache
+    PGresult* res = exec_params(
+        "WITH upd AS ("
+        "  UPDATE events "
+        "  SET title=$1, description=$2, location=$3, event_time=$4, event_type=$5 "
+        "  WHERE creator_id=$6 AND event_id=$7 "
+        "  RETURNING event_id"
+        ") "
+        "SELECT ep.user_id FROM upd "
+        "LEFT JOIN event_participants ep ON ep.event_id = upd.event_id",
+        7, params
     );
 
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        fprintf(stderr, "db_update_event error: %s\n", PQerrorMessage(conn));
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        fprintf(stderr, "db_update_event error: %s\n", PQresultErrorMessage(res));
         PQclear(res);
         return -1;
     }
 
-    // số dòng update
-    int affected = atoi(PQcmdTuples(res));
+    // số dòng update (mỗi event update trả về ít nhất 1 dòng)
+    int affected = PQntuples(res);
+    if (affected > 0) {
+        list_cache_invalidate(LIST_CACHE_EVENTS, creator_id);
+        for (int i = 0; i < affected; i++) {
+            if (!PQgetisnull(res, i, 0)) {
+                list_cache_invalidate(LIST_CACHE_EVENTS, atoi(PQgetvalue(res, i, 0)));
+            }
+        }
+    }
     PQclear(res);
 
     return (affected > 0) ? 1 : 0;
@@ -640,19 +1147,32 @@ int db_delete_event(int user_id, int event_id) {
 
     const char* params[2] = { uid, eid };
 
-    PGresult* res = PQexecParams(
-        conn,
-        "DELETE FROM events WHERE creator_id = $1 AND event_id = $2",
-        2, NULL, params, NULL, NULL, 0
+    // CTE đọc người tham gia theo snapshot trước khi DELETE cascade xóa họ
+    PGresult* res = exec_params(
+        "WITH del AS ("
+        "  DELETE FROM events WHERE creator_id = $1 AND event_id = $2 RETURNING event_id"
+        "), members AS ("
+        "  SELECT user_id FROM event_participants WHERE event_id = $2"
+        ") "
+        "SELECT m.user_id FROM del LEFT JOIN members m ON TRUE",
+        2, params
     );
 
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        fprintf(stderr, "db_delete_event error: %s\n", PQerrorMessage(conn));
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        fprintf(stderr, "db_delete_event error: %s\n", PQresultErrorMessage(res));
         PQclear(res);
         return -1;
     }
 
-    int affected = atoi(PQcmdTuples(res)); // số dòng bị xóa
+    int affected = PQntuples(res); // > 0 nếu event bị xóa
+    if (affected > 0) {
+        list_cache_invalidate(LIST_CACHE_EVENTS, user_id);
+        for (int i = 0; i < affected; i++) {
+            if (!PQgetisnull(res, i, 0)) {
+                list_cache_invalidate(LIST_CACHE_EVENTS, atoi(PQgetvalue(res, i, 0)));
+            }
+        }
+    }
     PQclear(res);
 
     return (affected > 0) ? 1 : 0;
@@ -661,68 +1181,42 @@ int db_delete_event(int user_id, int event_id) {
 
 
 // Get user's events
+// Sự kiện của $1 = sự kiện do $1 tạo UNION sự kiện $1 tham gia
+//   - Mỗi nhánh là 1 range scan trên index riêng:
+//     events(creator_id, event_time, event_id) và event_participants(user_id, event_id)
+//   - Khi phân trang, mỗi nhánh tự áp keyset + LIMIT trước khi UNION
+#define USER_EVENTS_COLS "e.event_id, e.title, e.location, e.event_time, e.event_type, e.status "
+#define USER_EVENTS_BRANCH_ORDER "ORDER BY e.event_time, e.event_id "
+#define USER_EVENTS_ORDER "ORDER BY event_time, event_id "
+#define USER_EVENTS_KEYSET "AND (e.event_time, e.event_id) > ($3::timestamp, $4::int) "
+#define USER_EVENTS_UNION(branch_tail) \
+    "SELECT * FROM (" \
+    "  (SELECT " USER_EVENTS_COLS "FROM events e " \
+    "   WHERE e.creator_id = $1 " branch_tail ") " \
+    "  UNION " \
+    "  (SELECT " USER_EVENTS_COLS "FROM event_participants ep " \
+    "   JOIN events e ON e.event_id = ep.event_id " \
+    "   WHERE ep.user_id = $1 " branch_tail ")" \
+    ") ue "
+
 /**
  * Lấy danh sách sự kiện mà user sở hữu hoặc tham gia
- * @param user_id ID người dùng
- * @param results Mảng string kết quả
- * @param count Số event
+ * - Sắp xếp theo (event_time, event_id), phân trang theo keyset
+ * @param user_id  ID người dùng
+ * @param page     Trang cần lấy (NULL = toàn bộ)
+ * @param out      Buffer nhận kết quả (mỗi event 1 dòng)
+ * @param count    Số event
+ * @return 0 nếu thành công, -2 nếu cursor sai, -1 nếu lỗi
  */
-int db_get_user_events(int user_id, char*** results, int* count) {
-    if (!conn) return -1;
-
-    char user_id_str[20];
-    snprintf(user_id_str, sizeof(user_id_str), "%d", user_id);
-
-    const char* params[1] = { user_id_str };
-
-    PGresult* res = PQexecParams(
-        conn,
-        "SELECT DISTINCT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status "
-        "FROM events e "
-        "LEFT JOIN event_participants ep ON e.event_id = ep.event_id "
-        "WHERE e.creator_id = $1 OR ep.user_id = $1 "
-        "ORDER BY e.event_time",
-        1, NULL, params, NULL, NULL, 0
-    );
-
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_get_user_events error: %s\n", PQerrorMessage(conn));
-        PQclear(res);
-        return -1;
-    }
-
-    *count = PQntuples(res);
-    *results = NULL;
-
-    if (*count == 0) {
-        PQclear(res);
-        return 0;
-    }
-
-    *results = (char**)malloc(*count * sizeof(char*));
-    if (!*results) {
-        PQclear(res);
-        return -1;
-    }
-
-    for (int i = 0; i < *count; i++) {
-        char buffer[512];
-
-        // format 1 dòng: event_id;title;location;time;type;status
-        snprintf(buffer, sizeof(buffer), "%s;%s;%s;%s;%s;%s",
-                 PQgetvalue(res, i, 0), // event_id
-                 PQgetvalue(res, i, 1), // title
-                 PQgetvalue(res, i, 2), // location
-                 PQgetvalue(res, i, 3), // event_time
-                 PQgetvalue(res, i, 4), // event_type
-                 PQgetvalue(res, i, 5)  // status
-        );
-
-        (*results)[i] = strdup(buffer);
-    }
-
-    PQclear(res);
-    return 0;
+int db_get_user_events(int user_id, Page* page, Buffer* out, int* count) {
+    if (!conn || !out || !count) return -1;
+
+    // format 1 dòng: event_id;title;location;time;type;status
+    return fetch_page("db_get_user_events",
+        USER_EVENTS_UNION("") USER_EVENTS_ORDER,
+        USER_EVENTS_UNION(USER_EVENTS_BRANCH_ORDER "LIMIT $2") USER_EVENTS_ORDER "LIMIT $2",
+        USER_EVENTS_UNION(USER_EVENTS_KEYSET USER_EVENTS_BRANCH_ORDER "LIMIT $2") USER_EVENTS_ORDER "LIMIT $2",
+        user_id, page, 3, 0, out, count, ';');
 }
 
 
@@ -730,77 +1224,48 @@ int db_get_user_events(int user_id, char*** results, int* count) {
 /**
  * Lấy danh sách sự kiện mà user sở hữu 
  * @param user_id  ID người dùng
- * @param results  Mảng string kết quả 
+ * @param out  Buffer nhận kết quả (mỗi event 1 dòng)
  * @param count  Số event
  */
-int db_get_user_events_crebyuser(int user_id, char*** results, int* count) {
-    if (!conn) return -1;
+int db_get_user_events_crebyuser(int user_id, Buffer* out, int* count) {
+    if (!conn || !out || !count) return -1;
 
     char user_id_str[20];
     snprintf(user_id_str, sizeof(user_id_str), "%d", user_id);
 
     const char* params[1] = { user_id_str };
 
-    PGresult* res = PQexecParams(
-        conn,
-        "SELECT DISTINCT e.event_id, e.title, e.location, e.event_time, e.event_type, e.status "
+    PGresult* res = exec_read(
+        "SELECT " USER_EVENTS_COLS
         "FROM events e "
-        "LEFT JOIN event_participants ep ON e.event_id = ep.event_id "
         "WHERE e.creator_id = $1 "
-        "ORDER BY e.event_time",
-        1, NULL, params, NULL, NULL, 0
+        USER_EVENTS_BRANCH_ORDER,
+        1, params
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_get_user_events error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_get_user_events error: %s\n", PQresultErrorMessage(res));
         PQclear(res);
         return -1;
     }
 
+    // format 1 dòng: event_id;title;location;time;type;status
     *count = PQntuples(res);
-    *results = NULL;
-
-    if (*count == 0) {
-        PQclear(res);
-        return 0;
-    }
-
-    *results = (char**)malloc(*count * sizeof(char*));
-    if (!*results) {
-        PQclear(res);
-        return -1;
-    }
-
-    for (int i = 0; i < *count; i++) {
-        char buffer[512];
-
-        // format 1 dòng: event_id;title;location;time;type;status
-        snprintf(buffer, sizeof(buffer), "%s;%s;%s;%s;%s;%s",
-                 PQgetvalue(res, i, 0), // event_id
-                 PQgetvalue(res, i, 1), // title
-                 PQgetvalue(res, i, 2), // location
-                 PQgetvalue(res, i, 3), // event_time
-                 PQgetvalue(res, i, 4), // event_type
-                 PQgetvalue(res, i, 5)  // status
-        );
-
-        (*results)[i] = strdup(buffer);
-    }
+    int rc = append_rows(res, PQntuples(res), out, ';');
 
     PQclear(res);
-    return 0;
+    return rc;
 }
 
 /** 
 * Lấy chi tiết sự kiện do user tạo
 * @param user_id ID người dùng (creator)
 * @param event_id ID sự kiện
-* @param out_extra kết quả 
+* @param out Buffer nhận kết quả
 * @return 1 nếu tìm thấy, 0 nếu không tìm thấy, -1 nếu lỗi
 */
-int db_get_event_detail_by_creator(int user_id, int event_id, char** out_extra) {
-    if (!conn || !out_extra) return -1;
-    *out_extra = NULL;
+int db_get_event_detail_by_creator(int user_id, int event_id, Buffer* out) {
+    if (!conn || !out) return -1;
 
     char uid[20], eid[20];
     snprintf(uid, sizeof(uid), "%d", user_id);
@@ -809,16 +1274,16 @@ int db_get_event_detail_by_creator(int user_id, int event_id, char** out_extra)
     //tham số truyền cho PQexecParams:$1 = uid, $2 = eid
     const char* params[2] = { uid, eid };
 
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_read(
         "SELECT event_id, title, COALESCE(description,''), COALESCE(location,''), "
         "       event_time::text, event_type, status "
         "FROM events "
         "WHERE creator_id = $1 AND event_id = $2",
-        2,NULL,params,NULL, NULL,0);
+        2, params);
 
     //  PGRES_TUPLES_OK : thành công và trả về rows
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_get_event_detail_by_creator error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_get_event_detail_by_creator error: %s\n", PQresultErrorMessage(res));
         PQclear(res); // giải phóng PGresult để tránh memory leak
         return -1;
     }
@@ -828,29 +1293,17 @@ int db_get_event_detail_by_creator(int user_id, int event_id, char** out_extra)
         return 0;
     }
 
-    //Lấy giá trị từng cột ở row 0
-    const char* c0 = PQgetvalue(res, 0, 0); //event_id
-    const char* c1 = PQgetvalue(res, 0, 1); //title
-    const char* c2 = PQgetvalue(res, 0, 2); //description
-    const char* c3 = PQgetvalue(res, 0, 3); //location
-    const char* c4 = PQgetvalue(res, 0, 4); //event_time:text
-    const char* c5 = PQgetvalue(res, 0, 5); //event_type
-    const char* c6 = PQgetvalue(res, 0, 6); //status
-
-    int n = snprintf(NULL, 0, "%s|%s|%s|%s|%s|%s|%s", c0,c1,c2,c3,c4,c5,c6);
-
-    char* extra = (char*)malloc((size_t)n + 1);
-    if (!extra) {
-        PQclear(res);
-        return -1;
+    //ghi dữ liệu vào out theo format event_id|title|description|location|event_time|event_type|status
+    int rc = 1;
+    for (int col = 0; col < 7 && rc == 1; col++) {
+        if ((col > 0 && buffer_append(out, "|", 1) < 0) ||
+            buffer_append(out, PQgetvalue(res, 0, col), (size_t)PQgetlength(res, 0, col)) < 0) {
+            rc = -1;
+        }
     }
 
-    //ghi dữ liệu vào extra theo format event_id|title|description|location|event_time|event_type|status
-    snprintf(extra, (size_t)n + 1, "%s|%s|%s|%s|%s|%s|%s", c0,c1,c2,c3,c4,c5,c6);
-
     PQclear(res);
-    *out_extra = extra;
-    return 1;
+    return rc;
 }
 
 
@@ -881,10 +1334,9 @@ int db_send_event_invitation(int event_id, int sender_id, int receiver_id) {
 
     //Check event tồn tại + quyền 
     const char* p_event[1] = { eid };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT creator_id, status FROM events WHERE event_id = $1",
-        1, NULL, p_event, NULL, NULL, 0
+        1, p_event
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
@@ -900,10 +1352,9 @@ int db_send_event_invitation(int event_id, int sender_id, int receiver_id) {
     if (creator_id != sender_id) return -4;
     //Check receiver đã tham gia event chưa 
     const char* p_joined[2] = { eid, rid };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT 1 FROM event_participants WHERE event_id=$1 AND user_id=$2",
-        2, NULL, p_joined, NULL, NULL, 0
+        2, p_joined
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
@@ -918,11 +1369,10 @@ int db_send_event_invitation(int event_id, int sender_id, int receiver_id) {
 
     //Check invitation pending đã tồn tại chưa
     const char* p_pending[3] = { eid, sid, rid };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT invitation_id FROM event_invitations "
         "WHERE event_id=$1 AND sender_id=$2 AND receiver_id=$3 AND status='pending'",
-        3, NULL, p_pending, NULL, NULL, 0
+        3, p_pending
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
@@ -936,11 +1386,10 @@ int db_send_event_invitation(int event_id, int sender_id, int receiver_id) {
     PQclear(res);
 
     //Insert invitation
-    res = PQexecParams(
-        conn,
+    res = exec_params(
         "INSERT INTO event_invitations (event_id, sender_id, receiver_id, status) "
         "VALUES ($1,$2,$3,'pending') RETURNING invitation_id",
-        3, NULL, p_pending, NULL, NULL, 0
+        3, p_pending
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
@@ -971,9 +1420,9 @@ int db_join_event(int user_id, int event_id) {
     
     const char* paramValues[2] = {user_id_str, event_id_str};
     
-    PGresult* res = PQexecParams(conn,
+    PGresult* res = exec_params(
         "INSERT INTO event_participants (user_id, event_id) VALUES ($1, $2) RETURNING participant_id",
-        2, NULL, paramValues, NULL, NULL, 0);
+        2, paramValues);
     
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         const char* sqlstate = PQresultErrorField(res, PG_DIAG_SQLSTATE);
@@ -987,6 +1436,9 @@ int db_join_event(int user_id, int event_id) {
     
     PQclear(res);
     
+    // Nếu đang trong transaction, caller invalidate lại sau COMMIT
+    list_cache_invalidate(LIST_CACHE_EVENTS, user_id);
+    
     return 0;
 }
 
@@ -1009,18 +1461,13 @@ int db_accept_event_invitation(int receiver_id, const char* sender_username, int
     snprintf(event_id_str, sizeof(event_id_str), "%d", event_id);
 
     // BEGIN transaction
-    PGresult* res = PQexec(conn, "BEGIN");
-    if (!res || PQresultStatus(res) != PGRES_COMMAND_OK) {
-        if (res) PQclear(res);
-        return -1;
-    }
-    PQclear(res);
+    if (tx_begin() < 0) return -1;
+    PGresult* res;
 
     // Tìm invitation pending theo sender_username, receiver_id, event_id
     const char* params1[3] = { sender_username, receiver_id_str, event_id_str };
 
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT ei.invitation_id "
         "FROM event_invitations ei "
         "JOIN users u ON ei.sender_id = u.user_id "
@@ -1031,19 +1478,19 @@ int db_accept_event_invitation(int receiver_id, const char* sender_username, int
         "ORDER BY ei.created_at DESC "
         "LIMIT 1 "
         "FOR UPDATE",
-        3, NULL, params1, NULL, NULL, 0
+        3, params1
     );
 
     if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_accept_event_invitation query error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_accept_event_invitation query error: %s\n", PQresultErrorMessage(res));
         if (res) PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
 
     if (PQntuples(res) == 0) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -2;
     }
 
@@ -1055,28 +1502,27 @@ int db_accept_event_invitation(int receiver_id, const char* sender_username, int
     snprintf(invitation_id_str, sizeof(invitation_id_str), "%d", invitation_id);
     const char* params2[3] = { invitation_id_str, receiver_id_str, event_id_str };
 
-    res = PQexecParams(
-        conn,
+    res = exec_params(
         "UPDATE event_invitations "
         "SET status = 'accepted', responded_at = CURRENT_TIMESTAMP "
         "WHERE invitation_id = $1 "
         "AND receiver_id = $2 "
         "AND event_id = $3 "
         "AND status = 'pending'",
-        3, NULL, params2, NULL, NULL, 0
+        3, params2
     );
 
     if (!res || PQresultStatus(res) != PGRES_COMMAND_OK) {
-        fprintf(stderr, "db_accept_event_invitation update error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_accept_event_invitation update error: %s\n", PQresultErrorMessage(res));
         if (res) PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
 
     // đảm bảo update thực sự đổi 1 dòng
     if (PQcmdTuples(res) && atoi(PQcmdTuples(res)) == 0) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -2;
     }
     PQclear(res);
@@ -1084,19 +1530,15 @@ int db_accept_event_invitation(int receiver_id, const char* sender_username, int
     // Join event theo event_id truyền vào
     int join_result = db_join_event(receiver_id, event_id);
     if (join_result == -1) {
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     } else if (join_result == -2) {
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -3;
     }
-    res = PQexec(conn, "COMMIT");
-    if (!res || PQresultStatus(res) != PGRES_COMMAND_OK) {
-        if (res) PQclear(res);
-        PQexec(conn, "ROLLBACK");
-        return -1;
-    }
-    PQclear(res);
+    if (tx_commit() < 0) return -1;
+
+    list_cache_invalidate(LIST_CACHE_EVENTS, receiver_id);
 
     return 0;
 }
@@ -1125,15 +1567,14 @@ int db_create_join_request(int user_id, int event_id) {
 
     //Check event exists + active + type
     const char* event[1] = { event_id_str };
-    PGresult* res = PQexecParams(
-        conn,
+    PGresult* res = exec_read(
         "SELECT event_type FROM events "
         "WHERE event_id = $1 AND status = 'active'",
-        1, NULL, event, NULL, NULL, 0
+        1, event
     );
 
     if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_create_join_request check event error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_create_join_request check event error: %s\n", PQresultErrorMessage(res));
         if (res) PQclear(res);
         return -1;
     }
@@ -1153,15 +1594,14 @@ int db_create_join_request(int user_id, int event_id) {
 
     // check đã tham gia sự kiện chưa
     const char* join[2] = { event_id_str, user_id_str };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT 1 FROM event_participants "
         "WHERE event_id = $1 AND user_id = $2",
-        2, NULL, join, NULL, NULL, 0
+        2, join
     );
 
     if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_create_join_request check participant error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_create_join_request check participant error: %s\n", PQresultErrorMessage(res));
         if (res) PQclear(res);
         return -1;
     }
@@ -1174,16 +1614,15 @@ int db_create_join_request(int user_id, int event_id) {
 
     // Check đã có request pending chưa
     const char* p_req[2] = { user_id_str, event_id_str };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT 1 FROM event_join_requests "
         "WHERE user_id = $1 AND event_id = $2 AND status = 'pending' "
         "LIMIT 1",
-        2, NULL, p_req, NULL, NULL, 0
+        2, p_req
     );
 
     if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_create_join_request check pending request error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_create_join_request check pending request error: %s\n", PQresultErrorMessage(res));
         if (res) PQclear(res);
         return -1;
     }
@@ -1196,16 +1635,15 @@ int db_create_join_request(int user_id, int event_id) {
 
     // Insert join request
     const char* paramValues[2] = { user_id_str, event_id_str };
-    res = PQexecParams(
-        conn,
+    res = exec_params(
         "INSERT INTO event_join_requests (user_id, event_id, status, created_at) "
         "VALUES ($1, $2, 'pending', CURRENT_TIMESTAMP) "
         "RETURNING join_request_id",
-        2, NULL, paramValues, NULL, NULL, 0
+        2, paramValues
     );
 
     if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
-        fprintf(stderr, "db_create_join_request insert error: %s\n", PQerrorMessage(conn));
+        fprintf(stderr, "db_create_join_request insert error: %s\n", PQresultErrorMessage(res));
         if (res) PQclear(res);
         return -1;
     }
@@ -1238,50 +1676,44 @@ int db_approve_join_request_by_creator(int creator_id, int event_id, const char*
     snprintf(event_id_str, sizeof(event_id_str), "%d", event_id);
 
     // BEGIN transaction
-    PGresult* res = PQexec(conn, "BEGIN");
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        PQclear(res);
-        return -1;
-    }
-    PQclear(res);
+    if (tx_begin() < 0) return -1;
+    PGresult* res;
 
     // Check event tồn tại + thuộc creator_id + active
     const char* params_event[2] = { event_id_str, creator_id_str };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT 1 FROM events "
         "WHERE event_id = $1 AND creator_id = $2 AND status = 'active'",
-        2, NULL, params_event, NULL, NULL, 0
+        2, params_event
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
     if (PQntuples(res) == 0) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -3; 
     }
     PQclear(res);
 
     // Tìm user_id của join_username 
     const char* params_user[1] = { join_username };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT user_id FROM users WHERE username = $1 AND status = 'active'",
-        1, NULL, params_user, NULL, NULL, 0
+        1, params_user
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
     if (PQntuples(res) == 0) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -4; 
     }
 
@@ -1293,23 +1725,22 @@ int db_approve_join_request_by_creator(int creator_id, int event_id, const char*
     snprintf(join_user_id_str, sizeof(join_user_id_str), "%d", join_user_id);
 
     const char* params_req[2] = { event_id_str, join_user_id_str };
-    res = PQexecParams(
-        conn,
+    res = exec_read(
         "SELECT join_request_id "
         "FROM event_join_requests "
         "WHERE event_id = $1 AND user_id = $2 AND status = 'pending' "
         "FOR UPDATE",
-        2, NULL, params_req, NULL, NULL, 0
+        2, params_req
     );
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
     if (PQntuples(res) == 0) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -2; 
     }
 
@@ -1321,58 +1752,40 @@ int db_approve_join_request_by_creator(int creator_id, int event_id, const char*
     snprintf(join_request_id_str, sizeof(join_request_id_str), "%d", join_request_id);
 
     const char* params_upd[1] = { join_request_id_str };
-    res = PQexecParams(
-        conn,
+    res = exec_params(
         "UPDATE event_join_requests "
         "SET status = 'accepted', responded_at = CURRENT_TIMESTAMP "
         "WHERE join_request_id = $1 AND status = 'pending'",
-        1, NULL, params_upd, NULL, NULL, 0
+        1, params_upd
     );
 
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
     PQclear(res);
 
     //Insert vào bảng event_participants
-    res = PQexecParams(
-        conn,
+    res = exec_params(
         "INSERT INTO event_participants (event_id, user_id, role) "
         "VALUES ($1, $2, 'participant') "
         "ON CONFLICT (event_id, user_id) DO NOTHING",
-        2, NULL, params_req, NULL, NULL, 0
+        2, params_req
     );
 
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
         PQclear(res);
-        PQexec(conn, "ROLLBACK");
+        tx_rollback();
         return -1;
     }
     PQclear(res);
 
     // COMMIT
-    res = PQexec(conn, "COMMIT");
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        PQclear(res);
-        PQexec(conn, "ROLLBACK");
-        return -1;
-    }
-    PQclear(res);
+    if (tx_commit() < 0) return -1;
+
+    list_cache_invalidate(LIST_CACHE_EVENTS, join_user_id);
 
     return 0;
 }
 
-
-
-// Free results array
-void db_free_results(char*** results, int count) {
-    if (!results || !*results) return;
-    
-    for (int i = 0; i < count; i++) {
-        free((*results)[i]);
-    }
-    free(*results);
-    *results = NULL;
-}
@@ -4,20 +4,50 @@
 #include <libpq-fe.h>
 #include "../common/protocol.h"
 
+// Trang kết quả theo keyset (xem PAGE_* trong protocol.h)
+typedef struct {
+    int limit;                      // Số bản ghi tối đa của trang
+    const char* after;              // Cursor trang trước, NULL = trang đầu
+    char next[PAGE_CURSOR_SIZE];    // [out] Cursor trang sau, "" nếu là trang cuối
+} Page;
+
 // =========================================
 // DATABASE CONNECTION MANAGEMENT
+// - Thread health ping kết nối khi rảnh, mất kết nối thì kết nối lại (backoff lũy thừa)
+// - Trong lúc mất kết nối (circuit breaker mở) mọi db_* trả lỗi ngay, không chờ mạng
+// - Lệnh đọc ngoài transaction được chạy lại 1 lần sau khi kết nối lại
 // =========================================
+#define DB_HEALTH_INTERVAL 5            // Giây rảnh trước khi ping "SELECT 1"
+#define DB_RECONNECT_MAX_BACKOFF 8      // Giây giữa 2 lần thử kết nối lại (tối đa)
+#define DB_RETRY_WAIT_MS 1000           // Lệnh đọc chờ kết nối lại tối đa bao lâu
+#define DB_CONN_OPTIONS "connect_timeout=5 keepalives=1 keepalives_idle=5 " \
+                        "keepalives_interval=2 keepalives_count=3 tcp_user_timeout=10000"
+
+// Bật gom lệnh ghi (write_coalescer.h) cho db_init sau đó; gọi trước db_init, backend khác bỏ qua
+void db_set_write_coalescing(int enabled);
 int db_init(const char* conninfo);
 void db_cleanup();
 PGconn* db_get_connection();
+// 1 nếu database đang dùng được, 0 nếu đang mất kết nối (request nên trả 503)
+int db_available(void);
 
 // =========================================
 // USER MANAGEMENT
 // =========================================
+// return: user_id, -2 username tồn tại, -3/-4 dữ liệu sai, -5 password pool quá tải, -1 lỗi
 int db_create_user(const char* username, const char* password, const char* email);
 int db_find_user_by_username(const char* username, int* user_id, char* email, int email_size, int* is_active);
 int db_find_user_by_id(int user_id, char* username, int username_size, char* email, int email_size, int* is_active);
 int db_verify_password(const char* username, const char* password);
+/**
+ * Chức năng: Kiểm tra đăng nhập (1 prepared statement thay cho verify + find)
+ * - Mật khẩu được kiểm tra bằng KDF trên password pool (password_hash.h)
+ * @param user_id   ID user (khi tìm thấy username)
+ * @param is_active 1 nếu tài khoản đang active
+ * @return 1 nếu đúng mật khẩu, 0 nếu sai mật khẩu / không có user,
+ *        -2 nếu password pool quá tải, -1 nếu lỗi
+ */
+int db_check_login(const char* username, const char* password, int* user_id, int* is_active);
 int db_validate_username(const char* username);
 int db_validate_email(const char* email);
 
@@ -34,7 +64,6 @@ int db_accept_friend_request_by_username(int receiver_id, const char* sender_use
 int db_reject_friend_request_by_username(int receiver_id, const char* sender_username);
 int db_remove_friend(int user_id, int friend_id);
 int db_remove_friend_by_username(int user_id, const char* friend_username);
-int db_get_friends_list(int user_id, char*** results, int* count);
 
 
 
@@ -42,13 +71,14 @@ int db_get_friends_list(int user_id, char*** results, int* count);
 
 
 /**
- * Chức năng : Lấy danh sách bạn bè của user
+ * Chức năng : Lấy danh sách bạn bè của user, sắp xếp theo (username, user_id)
  * @param user_id - ID của user cần lấy danh sách bạn bè
- * @param results - Mảng kết quả chứa thông tin bạn bè 
+ * @param page - Trang cần lấy (NULL = toàn bộ danh sách)
+ * @param out - Buffer nhận kết quả (ghi nối tiếp), mỗi dòng: friend_id|username|email
  * @param count - Số lượng bạn bè
- * @return 0 nếu thành công, -1 nếu lỗi
+ * @return 0 nếu thành công, -2 nếu cursor sai, -1 nếu lỗi
  */
-int db_get_friends_list(int user_id, char*** results, int* count);
+int db_get_friends_list(int user_id, Page* page, Buffer* out, int* count);
 
 int db_check_friendship(int user_id1, int user_id2);
 
@@ -90,29 +120,31 @@ int db_update_event(int creator_id, int event_id,const char* title,const char* d
 int db_delete_event(int user_id,int event_id);
 
 /**
- * Lấy danh sách sự kiện mà user sở hữu hoặc tham gia
+ * Lấy danh sách sự kiện mà user sở hữu hoặc tham gia, sắp xếp theo (event_time, event_id)
  * @param user_id  ID người dùng
- * @param results  Mảng string kết quả (
+ * @param page     Trang cần lấy (NULL = toàn bộ danh sách)
+ * @param out      Buffer nhận kết quả (ghi nối tiếp), mỗi dòng: event_id;title;location;time;type;status
  * @param count    Số event
+ * @return 0 nếu thành công, -2 nếu cursor sai, -1 nếu lỗi
  */
-int db_get_user_events(int user_id, char*** results, int* count);
+int db_get_user_events(int user_id, Page* page, Buffer* out, int* count);
 
 /**
  * Lấy danh sách sự kiện mà user sở hữu 
  * @param user_id  ID người dùng
- * @param results  Mảng string kết quả 
+ * @param out  Buffer nhận kết quả (cùng format với db_get_user_events)
  * @param count  Số event
  */
-int db_get_user_events_crebyuser(int user_id, char*** results, int* count);
+int db_get_user_events_crebyuser(int user_id, Buffer* out, int* count);
 
 /**
  * Chức năng : Lấy chi tiết sự kiện do user tạo
  * @param user_id  ID của user tạo sự kiện
  * @param event_id  ID của sự kiện
- * @param out_extra  con trỏ tới chuỗi kết quả 
- * @return 0 nếu thành công, -1 nếu lỗi
+ * @param out  Buffer nhận kết quả (ghi nối tiếp): event_id|title|description|location|event_time|event_type|status
+ * @return 1 nếu tìm thấy, 0 nếu không tìm thấy, -1 nếu lỗi
  */
-int db_get_event_detail_by_creator(int user_id, int event_id, char** out_extra);
+int db_get_event_detail_by_creator(int user_id, int event_id, Buffer* out);
 
 
 /**
@@ -170,10 +202,5 @@ int db_create_join_request(int user_id, int event_id);
 int db_approve_join_request_by_creator(int creator_id, int event_id, const char* join_username);
 
 
-// =========================================
-// UTILITY FUNCTIONS
-// =========================================
-void db_free_results(char*** results, int count);
-
 
 #endif // POSTGRES_DB_H
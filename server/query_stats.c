@@ -0,0 +1,211 @@
+#include "query_stats.h"
+#include "../common/histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+
+typedef struct {
+    const char* name;
+    const char* sql;
+    Histogram hist;         // micro giây
+    unsigned long errors;
+    unsigned long slow;
+    time_t explained_at;    // Lần EXPLAIN gần nhất
+} QueryStat;
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static QueryStat* stats[QUERY_STATS_MAX];
+static int stats_count = 0;
+static uint64_t slow_threshold_us = (uint64_t)SLOW_QUERY_MS * 1000;
+static int explain_enabled = 0;
+
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE* slow_log = NULL;
+
+int query_stats_configure(int slow_ms, int explain, const char* log_path) {
+    pthread_mutex_lock(&log_mutex);
+    if (slow_log) {
+        fclose(slow_log);
+        slow_log = NULL;
+    }
+    if (slow_ms > 0) {
+        slow_log = fopen(log_path ? log_path : SLOW_QUERY_LOG_FILE, "a");
+    }
+    int rc = (slow_ms > 0 && !slow_log) ? -1 : 0;
+    pthread_mutex_unlock(&log_mutex);
+
+    pthread_mutex_lock(&stats_mutex);
+    slow_threshold_us = slow_log ? (uint64_t)slow_ms * 1000 : 0;
+    explain_enabled = slow_log && explain;
+    pthread_mutex_unlock(&stats_mutex);
+    return rc;
+}
+
+// Tìm (hoặc thêm) thống kê của câu lệnh, gọi khi đang giữ stats_mutex
+// Khóa là cặp con trỏ (name, sql): đều là chuỗi hằng nên so sánh con trỏ là đủ
+static QueryStat* find_stat(const char* name, const char* sql) {
+    for (int i = 0; i < stats_count; i++) {
+        if (stats[i]->name == name && stats[i]->sql == sql) return stats[i];
+    }
+    if (stats_count == QUERY_STATS_MAX) return NULL;
+
+    QueryStat* s = calloc(1, sizeof(QueryStat));
+    if (!s) return NULL;
+    s->name = name;
+    s->sql = sql;
+    hist_init(&s->hist);
+    stats[stats_count++] = s;
+    return s;
+}
+
+int query_stats_record(const char* name, const char* sql, uint64_t elapsed_us, int failed) {
+    int flags = 0;
+
+    pthread_mutex_lock(&stats_mutex);
+    QueryStat* s = find_stat(name, sql);
+    int slow = slow_threshold_us > 0 && elapsed_us >= slow_threshold_us;
+    if (slow) flags |= QUERY_SLOW;
+    if (s) {
+        hist_record(&s->hist, elapsed_us);
+        if (failed) s->errors++;
+        if (slow) {
+            s->slow++;
+            time_t now = time(NULL);
+            if (explain_enabled && !failed && now - s->explained_at >= SLOW_QUERY_EXPLAIN_INTERVAL) {
+                s->explained_at = now;
+                flags |= QUERY_EXPLAIN;
+            }
+        }
+    }
+    pthread_mutex_unlock(&stats_mutex);
+    return flags;
+}
+
+// SQL trên 1 dòng: gộp khoảng trắng liên tiếp, cắt ở SLOW_QUERY_SQL_MAX
+static void append_sql_line(Buffer* b, const char* sql) {
+    size_t written = 0;
+    int space = 0;
+    for (const char* p = sql; *p && written < SLOW_QUERY_SQL_MAX; p++) {
+        if (isspace((unsigned char)*p)) {
+            space = written > 0;
+            continue;
+        }
+        if (space) {
+            buffer_append(b, " ", 1);
+            written++;
+            space = 0;
+        }
+        buffer_append(b, p, 1);
+        written++;
+    }
+    if (written >= SLOW_QUERY_SQL_MAX) buffer_append_str(b, "...");
+}
+
+// Che tham số: chỉ giữ số nguyên ngắn (id, limit), còn lại ghi độ dài
+static void append_redacted(Buffer* b, const char* value) {
+    if (!value) {
+        buffer_append_str(b, "NULL");
+        return;
+    }
+    size_t n = strlen(value);
+    int numeric = n > 0 && n <= 20;
+    for (size_t i = 0; numeric && i < n; i++) {
+        if (!isdigit((unsigned char)value[i]) && !(i == 0 && value[i] == '-' && n > 1)) numeric = 0;
+    }
+    if (numeric) {
+        buffer_append(b, value, n);
+    } else {
+        char tmp[40];
+        snprintf(tmp, sizeof(tmp), "<redacted:%zu>", n);
+        buffer_append_str(b, tmp);
+    }
+}
+
+void query_stats_log_slow(const char* name, const char* sql, int nparams, const char* const* params,
+                          uint64_t elapsed_us, const char* plan) {
+    Buffer line;
+    buffer_init(&line);
+
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    char head[160];
+    size_t len = strftime(head, sizeof(head), "%Y-%m-%d %H:%M:%S", &tm_now);
+    snprintf(head + len, sizeof(head) - len, " [SLOW] %s %.3f ms: ",
+             name, (double)elapsed_us / 1000.0);
+    buffer_append_str(&line, head);
+    append_sql_line(&line, sql);
+
+    if (nparams > 0 && params) {
+        buffer_append_str(&line, " | params:");
+        for (int i = 0; i < nparams; i++) {
+            char key[16];
+            snprintf(key, sizeof(key), " $%d=", i + 1);
+            buffer_append_str(&line, key);
+            append_redacted(&line, params[i]);
+        }
+    }
+    buffer_append(&line, "\n", 1);
+
+    // Plan: mỗi dòng thụt vào 4 dấu cách
+    if (plan && plan[0]) {
+        const char* p = plan;
+        while (*p) {
+            const char* nl = strchr(p, '\n');
+            size_t n = nl ? (size_t)(nl - p) : strlen(p);
+            buffer_append(&line, "    ", 4);
+            buffer_append(&line, p, n);
+            buffer_append(&line, "\n", 1);
+            p += n + (nl ? 1 : 0);
+        }
+    }
+
+    pthread_mutex_lock(&log_mutex);
+    if (slow_log && line.data) {
+        fwrite(line.data, 1, line.len, slow_log);
+        fflush(slow_log);
+    }
+    pthread_mutex_unlock(&log_mutex);
+    buffer_free(&line);
+}
+
+int query_stats_report(Buffer* out) {
+    int rc = 0;
+    char row[256];
+
+    pthread_mutex_lock(&stats_mutex);
+    for (int i = 0; i < stats_count && rc == 0; i++) {
+        const QueryStat* s = stats[i];
+        const Histogram* h = &s->hist;
+        snprintf(row, sizeof(row),
+                 "%s count=%llu errors=%lu slow=%lu mean=%.3f p50=%.3f p90=%.3f p99=%.3f max=%.3f ms | ",
+                 s->name, (unsigned long long)h->total, s->errors, s->slow,
+                 hist_mean(h) / 1000.0, hist_percentile(h, 50) / 1000.0,
+                 hist_percentile(h, 90) / 1000.0, hist_percentile(h, 99) / 1000.0,
+                 h->max / 1000.0);
+        rc |= buffer_append_str(out, row);
+        size_t start = out->len;
+        append_sql_line(out, s->sql);
+        // Bảng thống kê chỉ cần nhận ra câu lệnh: cắt SQL ngắn hơn log
+        if (out->len - start > 80) {
+            out->len = start + 80;
+            out->data[out->len] = '\0';
+            rc |= buffer_append_str(out, "...");
+        }
+        rc |= buffer_append(out, "\n", 1);
+    }
+    pthread_mutex_unlock(&stats_mutex);
+    return rc < 0 ? -1 : 0;
+}
+
+void query_stats_close(void) {
+    pthread_mutex_lock(&log_mutex);
+    if (slow_log) {
+        fclose(slow_log);
+        slow_log = NULL;
+    }
+    pthread_mutex_unlock(&log_mutex);
+}
@@ -0,0 +1,64 @@
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+// =========================================
+// QUERY STATS + SLOW QUERY LOG
+// - Mỗi câu lệnh của tầng dữ liệu được đo bằng hist_now_us() (CLOCK_MONOTONIC) và ghi vào
+//   histogram (common/histogram.h, micro giây) riêng theo (hàm db_*, câu SQL)
+// - Lệnh chạy lâu hơn ngưỡng được ghi vào slow query log kèm tham số đã che
+//   (chỉ giữ số nguyên ngắn như id, chuỗi khác thay bằng độ dài)
+// - Tùy chọn: kèm EXPLAIN (ANALYZE, BUFFERS), tối đa 1 lần / SLOW_QUERY_EXPLAIN_INTERVAL
+//   cho mỗi câu lệnh (EXPLAIN ANALYZE chạy lại câu lệnh trong transaction rồi ROLLBACK;
+//   plan có thể chứa giá trị literal của điều kiện WHERE)
+// Cấu hình: slow_query_ms, slow_query_explain, slow_query_log trong config/database.conf
+// =========================================
+#include "../common/protocol.h"
+#include <stdint.h>
+
+#define QUERY_STATS_MAX 64                  // Số câu lệnh khác nhau tối đa được theo dõi
+#define SLOW_QUERY_MS 200                   // Ngưỡng mặc định, 0 = tắt slow query log
+#define SLOW_QUERY_LOG_FILE "slow_query.log"
+#define SLOW_QUERY_EXPLAIN_INTERVAL 60      // Giây giữa 2 lần EXPLAIN cùng 1 câu lệnh
+#define SLOW_QUERY_SQL_MAX 512              // Độ dài SQL tối đa trong log
+
+// Cờ trả về của query_stats_record
+#define QUERY_SLOW 1        // Vượt ngưỡng: caller gọi query_stats_log_slow
+#define QUERY_EXPLAIN 2     // Nên kèm EXPLAIN (ANALYZE, BUFFERS)
+
+/**
+ * Chức năng: Đặt ngưỡng slow query và mở file log (gọi 1 lần lúc khởi động)
+ * @param slow_ms   Ngưỡng (ms), <= 0 = tắt slow query log
+ * @param explain   1 = kèm EXPLAIN (ANALYZE, BUFFERS) cho lệnh chậm
+ * @param log_path  File log (ghi nối tiếp), NULL = SLOW_QUERY_LOG_FILE
+ * @return 0 nếu thành công, -1 nếu không mở được file log (slow query log tắt)
+ */
+int query_stats_configure(int slow_ms, int explain, const char* log_path);
+
+/**
+ * Chức năng: Ghi 1 lần chạy vào histogram của câu lệnh
+ * @param name        Tên hàm gọi (chuỗi hằng, VD __func__)
+ * @param sql         Câu SQL hoặc tên prepared statement (chuỗi hằng, dùng làm khóa)
+ * @param elapsed_us  Thời gian chạy
+ * @param failed      1 nếu câu lệnh lỗi
+ * @return tổ hợp QUERY_SLOW / QUERY_EXPLAIN
+ */
+int query_stats_record(const char* name, const char* sql, uint64_t elapsed_us, int failed);
+
+/**
+ * Chức năng: Ghi 1 lệnh chậm vào slow query log
+ * @param params  Tham số của lệnh (được che trước khi ghi)
+ * @param plan    Kết quả EXPLAIN (có thể NULL)
+ */
+void query_stats_log_slow(const char* name, const char* sql, int nparams, const char* const* params,
+                          uint64_t elapsed_us, const char* plan);
+
+/**
+ * Chức năng: Ghi bảng thống kê (mỗi câu lệnh 1 dòng: số lần, lỗi, chậm, mean/p50/p90/p99/max ms)
+ * @return 0 nếu thành công, -1 nếu hết bộ nhớ
+ */
+int query_stats_report(Buffer* out);
+
+// Đóng file log
+void query_stats_close(void);
+
+#endif // QUERY_STATS_H
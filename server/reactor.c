@@ -0,0 +1,312 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "reactor.h"
+#include "server.h"
+#include "metrics.h"
+#include "../common/protocol.h"
+#include "../common/probes.h"
+
+typedef struct Connection {
+    int sock;
+    struct Connection* next;        // Hàng đợi worker
+    Buffer in;                      // Phần request chưa đủ dòng (rỗng = không giữ bộ nhớ)
+} Connection;
+
+static int epoll_fd = -1;
+static SessionManager* reactor_sm = NULL;
+
+// Dừng reactor (reactor_stop gọi được trong signal handler)
+static volatile sig_atomic_t stop_requested = 0;
+static int wake_fd = -1;                // eventfd trong epoll: đánh thức epoll_wait khi dừng
+static char wake_marker;                // data.ptr của wake_fd
+static int stopping = 0;                // Worker thoát (đọc / ghi dưới queue_mutex)
+
+// Hàng đợi kết nối có dữ liệu, chờ worker
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static Connection* queue_head = NULL;
+static Connection* queue_tail = NULL;
+
+static void queue_push(Connection* conn) {
+    conn->next = NULL;
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_tail) queue_tail->next = conn; else queue_head = conn;
+    queue_tail = conn;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+// NULL khi reactor dừng
+static Connection* queue_pop(void) {
+    pthread_mutex_lock(&queue_mutex);
+    while (queue_head == NULL && !stopping) {
+        pthread_cond_wait(&queue_cond, &queue_mutex);
+    }
+    if (stopping) {
+        pthread_mutex_unlock(&queue_mutex);
+        return NULL;
+    }
+    Connection* conn = queue_head;
+    queue_head = conn->next;
+    if (queue_head == NULL) queue_tail = NULL;
+    pthread_mutex_unlock(&queue_mutex);
+    return conn;
+}
+
+static void connection_close(Connection* conn) {
+    printf("[CLIENT] Client disconnected (socket: %d)\n", conn->sock);
+
+    // Cleanup session when client disconnects
+    Session* session = session_find_by_socket(reactor_sm, conn->sock);
+    if (session != NULL) {
+        session_destroy(reactor_sm, session->token);
+        printf("[SESSION] Session destroyed for socket %d\n", conn->sock);
+    }
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->sock, NULL);
+    close(conn->sock);
+    buffer_free(&conn->in);
+    free(conn);
+    metrics_connection_closed();
+}
+
+/**
+ * Chức năng: Xử lý các dòng request hoàn chỉnh trong conn->in, giữ lại phần dở dang
+ * @return 0 nếu giữ kết nối, -1 nếu phải đóng (dòng rỗng / request quá MAX_BUFFER / gửi response lỗi)
+ */
+static int process_lines(ServerContext* ctx, Connection* conn) {
+    size_t off = 0;
+    char* data = conn->in.data;
+
+    for (;;) {
+        char* crlf = memmem(data + off, conn->in.len - off, "\r\n", 2);
+        if (crlf == NULL) break;
+        *crlf = '\0';
+        // Như receive_message trước đây: dòng rỗng = client ngắt kết nối
+        if (crlf == data + off) return -1;
+        // Peer đã đóng: bỏ các request còn lại trong buffer
+        if (handle_client_request(ctx, conn->sock, data + off) < 0) return -1;
+        off = (size_t)(crlf - data) + 2;
+    }
+
+    size_t rest = conn->in.len - off;
+    if (rest >= MAX_BUFFER - 1) {
+        fprintf(stderr, "[ERROR] Buffer overflow\n");
+        return -1;
+    }
+    if (rest == 0) {
+        buffer_reset(&conn->in);
+    } else if (off > 0) {
+        memmove(data, data + off, rest);
+        conn->in.len = rest;
+        data[rest] = '\0';
+    }
+    return 0;
+}
+
+/**
+ * Chức năng: Đọc dữ liệu đang có trên socket và xử lý
+ * @return 0 nếu giữ kết nối, -1 nếu đã ngắt / lỗi
+ */
+static int serve_connection(ServerContext* ctx, Connection* conn) {
+    for (int reads = 0; reads < REACTOR_READS_PER_WAKE; reads++) {
+        if (buffer_reserve(&conn->in, REACTOR_READ_CHUNK) < 0) return -1;
+        ssize_t n = recv(conn->sock, conn->in.data + conn->in.len, conn->in.cap - conn->in.len - 1, MSG_DONTWAIT);
+        PROBE2(receive__message, conn->sock, (int)n);
+        if (n == 0) return -1;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            perror("[ERROR] recv failed");
+            return -1;
+        }
+
+        protocol_mark_receive_start();
+        conn->in.len += (size_t)n;
+        conn->in.data[conn->in.len] = '\0';
+        if (process_lines(ctx, conn) < 0) return -1;
+    }
+
+    // Kết nối rảnh không giữ buffer
+    if (conn->in.len == 0) buffer_free(&conn->in);
+    return 0;
+}
+
+static void* worker_thread(void* arg) {
+    (void)arg;
+    ServerContext ctx;
+    ctx.sm = reactor_sm;
+    buffer_init(&ctx.response);
+    arena_init(&ctx.arena);
+
+    for (;;) {
+        Connection* conn = queue_pop();
+        if (conn == NULL) break;
+        ctx.socket = conn->sock;
+        if (serve_connection(&ctx, conn) < 0) {
+            connection_close(conn);
+            continue;
+        }
+
+        // Đăng ký đọc lại (EPOLLONESHOT đã tắt sự kiện của kết nối này)
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->sock, &ev) < 0) {
+            perror("[ERROR] epoll_ctl rearm failed");
+            connection_close(conn);
+        }
+    }
+
+    buffer_free(&ctx.response);
+    arena_free(&ctx.arena);
+    return NULL;
+}
+
+static void accept_connections(int listen_sock) {
+    for (;;) {
+        int client_sock = accept4(listen_sock, NULL, NULL, SOCK_CLOEXEC);
+        if (client_sock < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EMFILE || errno == ENFILE) {
+                // Hết file descriptor: chờ kết nối khác đóng thay vì quay vòng
+                perror("Accept failed");
+                usleep(10000);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Accept failed");
+            }
+            return;
+        }
+
+        Connection* conn = calloc(1, sizeof(Connection));
+        if (conn == NULL) {
+            close(client_sock);
+            continue;
+        }
+        conn->sock = client_sock;
+        buffer_init(&conn->in);
+
+        // Worker gửi response kiểu chặn: giới hạn thời gian chờ buffer gửi có chỗ trống
+        // (hết hạn => sendmsg lỗi EAGAIN => handle_client_request < 0 => đóng kết nối)
+        struct timeval send_timeout = { REACTOR_SEND_TIMEOUT_MS / 1000,
+                                        (REACTOR_SEND_TIMEOUT_MS % 1000) * 1000 };
+        setsockopt(client_sock, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_sock, &ev) < 0) {
+            perror("[ERROR] epoll_ctl add failed");
+            close(client_sock);
+            free(conn);
+            continue;
+        }
+
+        printf("[CLIENT] New client connected (socket: %d)\n", client_sock);
+        metrics_connection_opened();
+    }
+}
+
+void reactor_stop(void) {
+    stop_requested = 1;
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t rc = write(wake_fd, &one, sizeof(one));
+        (void)rc;
+    }
+}
+
+// Báo worker thoát (worker đang xử lý thì làm xong kết nối hiện tại) rồi chờ hết
+static void stop_workers(pthread_t* threads, int count) {
+    pthread_mutex_lock(&queue_mutex);
+    stopping = 1;
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+int reactor_run(int listen_sock, int workers, SessionManager* sm) {
+    if (workers <= 0) workers = REACTOR_DEFAULT_WORKERS;
+    reactor_sm = sm;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1 failed");
+        return -1;
+    }
+
+    int flags = fcntl(listen_sock, F_GETFL, 0);
+    fcntl(listen_sock, F_SETFL, flags | O_NONBLOCK);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;                 // NULL = listen socket
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_sock, &ev) < 0) {
+        perror("epoll_ctl failed");
+        close(epoll_fd);
+        return -1;
+    }
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &wake_marker;
+    if (wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) < 0) {
+        perror("eventfd failed");
+        if (wake_fd >= 0) close(wake_fd);
+        wake_fd = -1;
+        close(epoll_fd);
+        return -1;
+    }
+
+    pthread_t* threads = malloc((size_t)workers * sizeof(pthread_t));
+    int started = 0;
+    while (threads && started < workers) {
+        if (pthread_create(&threads[started], NULL, worker_thread, NULL) != 0) break;
+        started++;
+    }
+    int rc = 0;
+    if (started < workers) {
+        perror("Thread creation failed");
+        rc = -1;
+    } else {
+        printf("[SERVER] Reactor started with %d worker threads\n", workers);
+    }
+
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    while (rc == 0 && !stop_requested) {
+        int n = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            rc = -1;
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == &wake_marker) {
+                continue;               // stop_requested đã được đặt
+            } else if (events[i].data.ptr == NULL) {
+                accept_connections(listen_sock);
+            } else {
+                queue_push((Connection*)events[i].data.ptr);
+            }
+        }
+    }
+
+    if (rc == 0) printf("[SERVER] Stopping reactor...\n");
+    if (threads) stop_workers(threads, started);
+    free(threads);
+    return rc;
+}
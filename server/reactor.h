@@ -0,0 +1,35 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+// =========================================
+// REACTOR: epoll + pool worker thay cho 1 thread / kết nối
+// - Thread gọi reactor_run() accept kết nối mới và chờ sự kiện đọc trên mọi socket
+//   (EPOLLONESHOT: tại 1 thời điểm mỗi kết nối chỉ do 1 worker xử lý, request giữ thứ tự)
+// - Worker đọc dữ liệu đang có (không chặn), xử lý từng dòng request hoàn chỉnh, rồi đăng ký đọc lại;
+//   response vẫn gửi kiểu chặn trên worker như trước, nhưng tối đa REACTOR_SEND_TIMEOUT_MS:
+//   client không đọc response (buffer gửi đầy) bị ngắt thay vì giữ worker của cả pool
+// - Kết nối rảnh chỉ tốn struct Connection + đăng ký epoll: Buffer nhận chỉ được cấp khi còn
+//   request dở dang, response Buffer + arena thuộc về worker (dùng chung cho mọi kết nối)
+// =========================================
+#include "session.h"
+
+#define REACTOR_DEFAULT_WORKERS 32      // Worker chặn khi chờ DB / password pool nên nhiều hơn số core
+#define REACTOR_MAX_EVENTS 256
+#define REACTOR_READ_CHUNK 4096         // Byte mỗi lần recv
+#define REACTOR_READS_PER_WAKE 16       // Sau số lần recv này trả worker cho kết nối khác (công bằng)
+#define REACTOR_SEND_TIMEOUT_MS 2000    // SO_SNDTIMEO: gửi không tiến triển quá lâu => đóng kết nối
+
+/**
+ * Chức năng: Chạy vòng lặp reactor trên socket đang listen, đến khi reactor_stop() hoặc lỗi
+ *            (trước khi trả về: chờ mọi worker xử lý xong kết nối đang cầm và thoát)
+ * @param listen_sock  Socket đã listen
+ * @param workers      Số worker thread (<= 0 = REACTOR_DEFAULT_WORKERS)
+ * @param sm           Session manager (hủy session khi kết nối đóng)
+ * @return 0 nếu dừng bằng reactor_stop(), -1 nếu lỗi epoll / worker
+ */
+int reactor_run(int listen_sock, int workers, SessionManager* sm);
+
+// Yêu cầu reactor_run trả về (an toàn trong signal handler: chỉ ghi cờ + eventfd)
+void reactor_stop(void);
+
+#endif // REACTOR_H
@@ -6,19 +6,96 @@
 #include <pthread.h>
 #include <time.h>
 #include <errno.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/resource.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "server.h"
 #include "config.h"
+#include "list_cache.h"
+#include "password_hash.h"
+#include "activity_log.h"
+#include "query_stats.h"
+#include "metrics.h"
+#include "trace.h"
+#include "reactor.h"
+#include "../common/histogram.h"
 #include "../common/protocol.h"
-
-#define PORT 8888
-#define MAX_CLIENTS 100
+#include "../common/probes.h"
 
 SessionManager sm;
 
+// User của kết nối trước khi xử lý request hiện tại (LOGOUT xóa session trước khi trả response)
+static __thread int tls_request_user_id = 0;
+
+/**
+ * Hook activity log của protocol: đẩy thêm mỗi dòng log vào bảng activity_logs
+ * - action = tên lệnh viết thường (LOGIN -> login)
+ * - REGISTER/LOGIN: không lưu field (mật khẩu) và extra (token) vào DB
+ */
+// Thay mọi dãy chữ/số dài đúng SESSION_TOKEN_LEN (dạng session token) bằng "<token>"
+static void redact_tokens(char* s) {
+    static const char mask[] = "<token>";
+    char* out = s;
+    while (*s) {
+        size_t run = 0;
+        while (isalnum((unsigned char)s[run])) run++;
+        if (run == SESSION_TOKEN_LEN) {
+            memcpy(out, mask, sizeof(mask) - 1);
+            out += sizeof(mask) - 1;
+            s += run;
+        } else if (run > 0) {
+            memmove(out, s, run);
+            out += run;
+            s += run;
+        } else {
+            *out++ = *s++;
+        }
+    }
+    *out = '\0';
+}
+
+static void ship_activity_log(int client_sock, const char* ip, const char* request, const char* result) {
+    Session* session = session_find_by_socket(&sm, client_sock);
+    int user_id = session ? session->user_id : tls_request_user_id;
+
+    char action[MAX_COMMAND];
+    size_t command_len = strcspn(request, "|");
+    size_t n = command_len;
+    if (n == 0) return;
+    if (n >= sizeof(action)) n = sizeof(action) - 1;
+    for (size_t i = 0; i < n; i++) action[i] = (char)tolower((unsigned char)request[i]);
+    action[n] = '\0';
+
+    char details[1100];
+    if (strcmp(action, "login") == 0 || strcmp(action, "register") == 0) {
+        const char* p1 = strchr(result, '|');
+        const char* p2 = p1 ? strchr(p1 + 1, '|') : NULL;
+        int result_len = p2 ? (int)(p2 - result) : (int)strlen(result);
+        snprintf(details, sizeof(details), "%s -> %.*s", action, result_len, result);
+    } else {
+        // Field 0 là session token: ghi "<token>" thay cho token thật
+        const char* fields = request + command_len;
+        const char* after_token = *fields ? strchr(fields + 1, '|') : NULL;
+        snprintf(details, sizeof(details), "%.*s%s%s -> %s", (int)command_len, request,
+                 *fields ? "|<token>" : "", after_token ? after_token : "", result);
+    }
+    // Chốt chặn: không dòng nào mang token (VD token nằm trong field khác) được ghi vào DB
+    redact_tokens(details);
+
+    activity_log_record(user_id, action, details, ip);
+}
+
+// Tra session theo token, đánh dấu phase validate / auth cho trace
+static Session* lookup_session(ServerContext* ctx, const char* token) {
+    trace_phase("validate");
+    Session* session = session_find_by_token(ctx->sm, token);
+    trace_phase("auth");
+    return session;
+}
+
 // Handle REGISTER 
 void handle_register(ServerContext* ctx, int client_sock, char** fields, int field_count) {
     // Check if already logged in
@@ -72,6 +149,10 @@ void handle_register(ServerContext* ctx, int client_sock, char** fields, int fie
        
         send_response_with_log(client_sock, RESPONSE_UNPROCESSABLE, "Invalid email format", NULL);
         printf("[REGISTER] Failed - Invalid email '%s'\n", email);
+    } else if (user_id == -5) {
+        
+        send_response_with_log(client_sock, RESPONSE_SERVICE_UNAVAILABLE, "Server busy, please try again", NULL);
+        printf("[REGISTER] Failed - Password pool busy\n");
     } else {
         
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
@@ -98,19 +179,23 @@ void handle_login(ServerContext* ctx, int client_sock, char** fields, int field_
     const char* username = fields[0];
     const char* password = fields[1];
     
-    // Verify password first
-    if (!db_verify_password(username, password)) {
+    // Verify password + get user info (1 query)
+    int user_id = 0;
+    int is_active = 0;
+    
+    int login_rc = db_check_login(username, password, &user_id, &is_active);
+    if (login_rc == -2) {
+        send_response_with_log(client_sock, RESPONSE_SERVICE_UNAVAILABLE, "Server busy, please try again", NULL);
+        printf("[LOGIN] Failed - Password pool busy\n");
+        return;
+    }
+    if (login_rc <= 0) {
         send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid username or password", NULL);
         printf("[LOGIN] Failed - Invalid credentials for user '%s'\n", username);
         return;
     }
     
-    // Get user info
-    int user_id;
-    char email[MAX_EMAIL];
-    int is_active;
-    
-    if (db_find_user_by_username(username, &user_id, email, sizeof(email), &is_active) <= 0 || !is_active) {
+    if (!is_active) {
         send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid username or password", NULL);
         printf("[LOGIN] Failed - User '%s' not found or inactive\n", username);
         return;
@@ -148,7 +233,7 @@ void handle_logout(ServerContext* ctx, int client_sock, char** fields, int field
     const char* session_id = fields[0];
     
     // Find session
-    Session* session = session_find_by_token(ctx->sm, session_id);
+    Session* session = lookup_session(ctx, session_id);
     
     if (session == NULL) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
@@ -185,7 +270,7 @@ void handle_send_friend_request(ServerContext* ctx, int client_sock, char** fiel
     }
     const char* session_id = fields[0];
     const char* friend_username = fields[1];
-    Session* session = session_find_by_token(ctx->sm, session_id);
+    Session* session = lookup_session(ctx, session_id);
     if (session == NULL || !session->is_active) {
         send_response(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[SEND_FRIEND_REQUEST] Failed - Invalid session ID\n");
@@ -243,7 +328,7 @@ void handle_accept_friend_request(ServerContext* ctx, int client_sock, char** fi
     const char* requester_username = fields[1];
     
     // Validate session
-    Session* session = session_find_by_token(ctx->sm, session_id);
+    Session* session = lookup_session(ctx, session_id);
     if (session == NULL || !session->is_active) {
         send_response(client_sock, RESPONSE_UNAUTHORIZED, "Invalid or expired session", NULL);
         printf("[ACCEPT_FRIEND_REQUEST] Failed - Invalid session\n");
@@ -281,7 +366,7 @@ void handle_reject_friend_request(ServerContext* ctx, int client_sock, char** fi
     const char* requester_username = fields[1];
     
     // Validate session
-    Session* session = session_find_by_token(ctx->sm, session_id);
+    Session* session = lookup_session(ctx, session_id);
     if (session == NULL || !session->is_active) {
         send_response(client_sock, RESPONSE_UNAUTHORIZED, "Invalid or expired session", NULL);
         printf("[REJECT_FRIEND_REQUEST] Failed - Invalid session\n");
@@ -319,7 +404,7 @@ void handle_unfriend(ServerContext* ctx, int client_sock, char** fields, int fie
     const char* friend_username = fields[1];
     
     // Validate session
-    Session* session = session_find_by_token(ctx->sm, session_id);
+    Session* session = lookup_session(ctx, session_id);
     if (session == NULL || !session->is_active) {
         send_response(client_sock, RESPONSE_UNAUTHORIZED, "Invalid or expired session", NULL);
         printf("[UNFRIEND] Failed - Invalid session\n");
@@ -362,7 +447,7 @@ void handle_create_event(ServerContext* ctx, int client_sock, char** fields, int
     const char* event_type        = fields[4];
     const char* event_description = fields[5];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED,"Invalid or expired session. Please login again.",NULL);
         printf("[CREATE_EVENT] Failed - Invalid session\n");
@@ -387,16 +472,46 @@ void handle_create_event(ServerContext* ctx, int client_sock, char** fields, int
 
 
 
-// GET_EVENTS|session_id
+// Đọc các field phân trang (tùy chọn) của GET_EVENTS / GET_FRIENDS: [limit[|after]]
+// return: 1 nếu có phân trang, 0 nếu không (trả toàn bộ như cũ), -1 nếu limit sai
+static int parse_page(char** fields, int field_count, Page* page) {
+    memset(page, 0, sizeof(*page));
+    if (field_count < 2) return 0;
+
+    char* end = NULL;
+    long limit = strtol(fields[1], &end, 10);
+    if (end == fields[1] || *end != '\0' || limit <= 0) return -1;
+
+    page->limit = limit > PAGE_MAX_LIMIT ? PAGE_MAX_LIMIT : (int)limit;
+    page->after = field_count > 2 ? fields[2] : NULL;
+    return 1;
+}
+
+// Thêm dòng cuối "next=<cursor>" vào payload của 1 trang
+static int append_next_cursor(Buffer* out, const Page* page) {
+    if (out->len > 0 && buffer_append_str(out, "\n") < 0) return -1;
+    if (buffer_append_str(out, PAGE_NEXT_PREFIX) < 0) return -1;
+    return buffer_append_str(out, page->next);
+}
+
+// GET_EVENTS|session_id[|limit[|after]]
 void handle_get_events(ServerContext* ctx, int client_sock, char** fields, int field_count) {
-    if (field_count != 1) {
+    if (field_count < 1 || field_count > 3) {
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
         return;
     }
 
     const char* session_token = fields[0];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Page page;
+    int paged = parse_page(fields, field_count, &page);
+    if (paged < 0) {
+        send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid limit", NULL);
+        printf("[GET_EVENTS] Failed - Invalid limit\n");
+        return;
+    }
+
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[GET_EVENTS] Failed - Invalid session ID\n");
@@ -404,46 +519,46 @@ void handle_get_events(ServerContext* ctx, int client_sock, char** fields, int f
     }
 
     int user_id = session->user_id;
-    char** results = NULL;
     int count = 0;
-
-    if (db_get_user_events(user_id, &results, &count) < 0) {
-        send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
-        printf("[GET_EVENTS] Failed - DB error\n");
+    Buffer* out = &ctx->response;
+    buffer_reset(out);
+
+    if (paged) {
+        // Chỉ cache danh sách đầy đủ, từng trang thì query trực tiếp (đã giới hạn bởi limit)
+        int rc = db_get_user_events(user_id, &page, out, &count);
+        if (rc == -2) {
+            send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid cursor", NULL);
+            printf("[GET_EVENTS] Failed - Invalid cursor\n");
+            return;
+        }
+        if (rc < 0 || append_next_cursor(out, &page) < 0) {
+            send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
+            printf("[GET_EVENTS] Failed - DB error\n");
+            return;
+        }
+        send_response_data_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", out->data, out->len);
+        printf("[GET_EVENTS] Success - user %d page of %d events\n", user_id, count);
         return;
     }
 
-    if (count == 0) {
-        send_response_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", ""); 
-        printf("[GET_EVENTS] Success - user %d has no events\n", user_id);
+    // Payload đã cache => gửi thẳng từ bộ nhớ
+    if (list_cache_get(LIST_CACHE_EVENTS, user_id, out, &count) > 0) {
+        send_response_data_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", out->data, out->len);
+        printf("[GET_EVENTS] Success (cached) - user %d has %d events\n", user_id, count);
         return;
     }
+    unsigned long generation = list_cache_generation(LIST_CACHE_EVENTS);
 
     // mỗi event 1 dòng, mỗi dòng: event_id;title;location;time;type;status
-    size_t buf_size = 0;
-    for (int i = 0; i < count; i++) {
-        buf_size += strlen(results[i]) + 1; // + '\n'
-    }
-
-    char* buffer = (char*)malloc(buf_size + 1);
-    if (!buffer) {
-        db_free_results(&results, count);
+    if (db_get_user_events(user_id, NULL, out, &count) < 0) {
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
+        printf("[GET_EVENTS] Failed - DB error\n");
         return;
     }
 
-    buffer[0] = '\0';
-    for (int i = 0; i < count; i++) {
-        strcat(buffer, results[i]);
-        if (i < count - 1) strcat(buffer, "\n");
-    }
-
-    db_free_results(&results, count);
-
-    send_response_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", buffer);
+    list_cache_put(LIST_CACHE_EVENTS, user_id, out->data, out->len, count, generation);
+    send_response_data_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", out->data, out->len);
     printf("[GET_EVENTS] Success - user %d has %d events\n", user_id, count);
-
-    free(buffer);
 }
 
 // GET_EVENTS|session_id
@@ -455,7 +570,7 @@ void handle_get_events_crebyuser(ServerContext* ctx, int client_sock, char** fie
 
     const char* session_token = fields[0];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[GET_EVENTS] Failed - Invalid session ID\n");
@@ -463,46 +578,18 @@ void handle_get_events_crebyuser(ServerContext* ctx, int client_sock, char** fie
     }
 
     int user_id = session->user_id;
-
-    char** results = NULL;
     int count = 0;
+    Buffer* out = &ctx->response;
+    buffer_reset(out);
 
-    if (db_get_user_events_crebyuser(user_id, &results, &count) < 0) {
+    if (db_get_user_events_crebyuser(user_id, out, &count) < 0) {
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
         printf("[GET_EVENTS] Failed - DB error\n");
         return;
     }
 
-    if (count == 0) {
-        send_response_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", ""); // extra rỗng
-        printf("[GET_EVENTS] Success - user %d has no events\n", user_id);
-        return;
-    }
-
-    size_t buf_size = 0;
-    for (int i = 0; i < count; i++) {
-        buf_size += strlen(results[i]) + 1; // + '\n'
-    }
-
-    char* buffer = (char*)malloc(buf_size + 1);
-    if (!buffer) {
-        db_free_results(&results, count);
-        send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
-        return;
-    }
-
-    buffer[0] = '\0';
-    for (int i = 0; i < count; i++) {
-        strcat(buffer, results[i]);
-        if (i < count - 1) strcat(buffer, "\n");
-    }
-
-    db_free_results(&results, count);
-
-    send_response_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", buffer);
+    send_response_data_with_log(client_sock, RESPONSE_OK, "Event list retrieved successfully", out->data, out->len);
     printf("[GET_EVENTS] Success - user %d has %d events\n", user_id, count);
-
-    free(buffer);
 }
 
 // GET_EVENT_DETAIL|session_id|event_id
@@ -513,7 +600,7 @@ void handle_get_event_detail(ServerContext* ctx, int client_sock, char** fields,
     }
     const char* session_token = fields[0];
     const char* event_id_str  = fields[1];
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[GET_EVENTS] Failed - Invalid session ID\n");
@@ -522,8 +609,9 @@ void handle_get_event_detail(ServerContext* ctx, int client_sock, char** fields,
     int user_id = session->user_id;
     int event_id = atoi(event_id_str);
 
-    char* extra = NULL;
-    int rc = db_get_event_detail_by_creator(user_id, event_id, &extra);
+    Buffer* out = &ctx->response;
+    buffer_reset(out);
+    int rc = db_get_event_detail_by_creator(user_id, event_id, out);
     if (rc < 0) {
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
         return;
@@ -533,8 +621,7 @@ void handle_get_event_detail(ServerContext* ctx, int client_sock, char** fields,
         return;
     }
 
-    send_response_with_log(client_sock, RESPONSE_OK, "Event detail retrieved successfully", extra);
-    free(extra);
+    send_response_data_with_log(client_sock, RESPONSE_OK, "Event detail retrieved successfully", out->data, out->len);
 }
 
 // EDIT_EVENT|session_id|event_id|title|description|location|event_time|event_type
@@ -552,7 +639,7 @@ void handle_update_event(ServerContext* ctx, int client_sock, char** fields, int
     const char* event_time = fields[5];
     const char* event_type  = fields[6];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (!session || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         return;
@@ -592,7 +679,7 @@ void handle_delete_event(ServerContext* ctx, int client_sock, char** fields, int
     const char* session_token = fields[0];
     const char* event_id_str  = fields[1];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (!session || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         return;
@@ -613,58 +700,66 @@ void handle_delete_event(ServerContext* ctx, int client_sock, char** fields, int
     send_response_with_log(client_sock, RESPONSE_OK, "Event deleted successfully", NULL);
 }
 
+// GET_FRIENDS|session_id[|limit[|after]]
 void handle_get_friends(ServerContext* ctx, int client_sock, char** fields, int field_count) {
-    if (field_count != 1) {
+    if (field_count < 1 || field_count > 3) {
         send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid request", NULL);
         return;
     }
 
     const char* session_token = fields[0];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Page page;
+    int paged = parse_page(fields, field_count, &page);
+    if (paged < 0) {
+        send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid limit", NULL);
+        return;
+    }
+
+    Session* session = lookup_session(ctx, session_token);
     if (!session || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         return;
     }
 
     int user_id = session->user_id;
-
-    char** results = NULL;
     int count = 0;
-
-    if (db_get_friends_list(user_id, &results, &count) < 0) {
-        send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Database error", NULL);
-        return;
-    }
-
-    if (count == 0) {
-        send_response_with_log(client_sock, RESPONSE_OK, "You have no friends", "");
+    Buffer* out = &ctx->response;
+    buffer_reset(out);
+
+    if (paged) {
+        int rc = db_get_friends_list(user_id, &page, out, &count);
+        if (rc == -2) {
+            send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid cursor", NULL);
+            return;
+        }
+        if (rc < 0 || append_next_cursor(out, &page) < 0) {
+            send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Database error", NULL);
+            return;
+        }
+        send_response_data_with_log(client_sock, RESPONSE_OK,
+                                    count == 0 ? "You have no friends" : "Friends list retrieved successfully",
+                                    out->data, out->len);
         return;
     }
 
-    //results thành 1 chuỗi
-    size_t buf_size = 0;
-    for (int i = 0; i < count; i++) {
-        buf_size += strlen(results[i]) + 1; // + '\n'
+    // Payload đã cache => gửi thẳng từ bộ nhớ
+    int cached = list_cache_get(LIST_CACHE_FRIENDS, user_id, out, &count) > 0;
+    if (!cached) {
+        unsigned long generation = list_cache_generation(LIST_CACHE_FRIENDS);
+        if (db_get_friends_list(user_id, NULL, out, &count) < 0) {
+            send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Database error", NULL);
+            return;
+        }
+        list_cache_put(LIST_CACHE_FRIENDS, user_id, out->data, out->len, count, generation);
     }
 
-    char* buffer = (char*)malloc(buf_size + 1);
-    if (!buffer) {
-        db_free_results(&results, count);
-        send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Memory error", NULL);
+    if (count == 0) {
+        send_response_with_log(client_sock, RESPONSE_OK, "You have no friends", "");
         return;
     }
 
-    buffer[0] = '\0';
-    for (int i = 0; i < count; i++) {
-        strcat(buffer, results[i]);
-        if (i < count - 1) strcat(buffer, "\n");
-    }
-
-    db_free_results(&results, count);
-
-    send_response_with_log(client_sock, RESPONSE_OK, "Friends list retrieved successfully", buffer);
-    free(buffer);
+    send_response_data_with_log(client_sock, RESPONSE_OK, "Friends list retrieved successfully", out->data, out->len);
 }
 
 
@@ -680,7 +775,7 @@ void handle_send_invitation_event(ServerContext* ctx, int client_sock, char** fi
     const char* friend_username = fields[1];
     const char* event_id_str = fields[2];
     
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[SEND_FRIEND_REQUEST] Failed - Invalid session\n");
@@ -751,7 +846,7 @@ void handle_accept_invitation_request(ServerContext* ctx, int client_sock, char*
     const char* requester_username = fields[1];
     const char* event_id_str = fields[2];
     int event_id = atoi(event_id_str);
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[ACCEPT_INVITATION_REQUEST] Failed - Invalid session\n");
@@ -791,7 +886,7 @@ void handle_join_event(ServerContext* ctx, int client_sock, char** fields, int f
     const char* session_token = fields[0];
     const char* event_id_str = fields[1];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[ACCEPT_INVITATION_REQUEST] Failed - Invalid session\n");
@@ -860,7 +955,7 @@ void handle_accept_join_request(ServerContext* ctx, int client_sock, char** fiel
     const char* event_id_str = fields[1];
     const char* join_username = fields[2];
 
-    Session* session = session_find_by_token(ctx->sm, session_token);
+    Session* session = lookup_session(ctx, session_token);
     if (session == NULL || !session->is_active) {
         send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Invalid session ID", NULL);
         printf("[ACCEPT_INVITATION_REQUEST] Failed - Invalid session\n");
@@ -890,13 +985,54 @@ void handle_accept_join_request(ServerContext* ctx, int client_sock, char** fiel
     }
 }
 
-// Handle incoming client requests
-void handle_client_request(ServerContext* ctx, int client_sock, const char* buffer) {
-    char command[MAX_COMMAND];
+// STATS: số liệu server (metrics theo command + thống kê câu lệnh DB)
+//   Lệnh quản trị nên chỉ nhận kết nối từ localhost, không cần session
+void handle_stats(ServerContext* ctx, int client_sock, char** fields, int field_count) {
+    (void)fields;
+    if (field_count > 1) {
+        send_response_with_log(client_sock, RESPONSE_BAD_REQUEST, "Invalid request", NULL);
+        return;
+    }
+
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    int local = 0;
+    if (getpeername(client_sock, (struct sockaddr*)&peer, &peer_len) == 0) {
+        if (peer.ss_family == AF_INET) {
+            const struct sockaddr_in* in = (const struct sockaddr_in*)&peer;
+            local = (ntohl(in->sin_addr.s_addr) >> 24) == 127;
+        } else if (peer.ss_family == AF_INET6) {
+            const struct sockaddr_in6* in6 = (const struct sockaddr_in6*)&peer;
+            local = IN6_IS_ADDR_LOOPBACK(&in6->sin6_addr);
+        }
+    }
+    if (!local) {
+        send_response_with_log(client_sock, RESPONSE_UNAUTHORIZED, "Stats only available from localhost", NULL);
+        printf("[STATS] Rejected - remote client (socket: %d)\n", client_sock);
+        return;
+    }
+
+    Buffer* out = &ctx->response;
+    buffer_reset(out);
+    if (metrics_report_text(out) < 0 || buffer_append_str(out, "-- queries --\n") < 0 ||
+        query_stats_report(out) < 0) {
+        send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
+        return;
+    }
+    send_response_data_with_log(client_sock, RESPONSE_OK, "Stats retrieved successfully", out->data, out->len);
+    printf("[STATS] Sent (%zu bytes)\n", out->len);
+}
+
+// Parse + điều phối 1 request; command nhận tên lệnh (cho metrics)
+static void dispatch_request(ServerContext* ctx, int client_sock, const char* buffer, char* command) {
     int field_count;
     protocol_set_current_request_for_log(buffer);
-    // Parse chuỗi request (cấp phát động)
-    char** fields = parse_request(buffer, command, &field_count);
+    Session* current = session_find_by_socket(ctx->sm, client_sock);
+    tls_request_user_id = current ? current->user_id : 0;
+    // Parse chuỗi request vào arena của kết nối (thu hồi khi xong request)
+    char** fields = parse_request_arena(&ctx->arena, buffer, command, &field_count);
+    PROBE2(request__start, command, tls_request_user_id);
+    trace_phase("parse");
     
     if (fields == NULL && field_count > 0) {
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
@@ -905,6 +1041,13 @@ void handle_client_request(ServerContext* ctx, int client_sock, const char* buff
     
     printf("[REQUEST] Received command: %s\n", command);
     
+    // Circuit breaker: database đang mất kết nối thì trả 503 ngay (LOGOUT, STATS không cần DB)
+    if (!db_available() && strcmp(command, CMD_LOGOUT) != 0 && strcmp(command, CMD_STATS) != 0) {
+        send_response_with_log(client_sock, RESPONSE_SERVICE_UNAVAILABLE, "Database unavailable, please try again", NULL);
+        printf("[REQUEST] Rejected %s - database unavailable\n", command);
+        return;
+    }
+    
     if (strcmp(command, CMD_REGISTER) == 0) {
         handle_register(ctx, client_sock, fields, field_count);
     } else if (strcmp(command, CMD_LOGIN) == 0) {
@@ -941,54 +1084,70 @@ void handle_client_request(ServerContext* ctx, int client_sock, const char* buff
         handle_accept_join_request(ctx, client_sock, fields, field_count);
     } else if (strcmp(command, CMD_GET_EVENTS_CREBYUSER) == 0) {
         handle_get_events_crebyuser(ctx, client_sock, fields, field_count);
+    } else if (strcmp(command, CMD_STATS) == 0) {
+        handle_stats(ctx, client_sock, fields, field_count);
     } else {
         send_response_with_log(client_sock, RESPONSE_SERVER_ERROR, "Internal server error", NULL);
         printf("[ERROR] Unknown command: %s\n", command);
     }
-    
-    // Giải phóng fields
-    free_fields(fields, field_count);
 }
 
-// Thread function for handling each client
-void* client_thread(void* arg) {
-    int client_sock = *(int*)arg;
-    free(arg);
-    
-    char buffer[MAX_BUFFER];
-    ServerContext ctx;
-    
-    ctx.sm = &sm;
-    ctx.socket = client_sock;
-    
-    printf("[CLIENT] New client connected (socket: %d)\n", client_sock);
-    
-    // Handle client requests
-    while (1) {
-        int result = receive_message(client_sock, buffer, MAX_BUFFER);
-        if (result <= 0) {
-            printf("[CLIENT] Client disconnected (socket: %d)\n", client_sock);
-            break;
-        }
-        
-        handle_client_request(&ctx, client_sock, buffer);
-    }
-    
-    // Cleanup session when client disconnects
-    Session* session = session_find_by_socket(&sm, client_sock);
-    if (session != NULL) {
-        session_destroy(&sm, session->token);
-        printf("[SESSION] Session destroyed for socket %d\n", client_sock);
+// Handle incoming client requests
+int handle_client_request(ServerContext* ctx, int client_sock, const char* buffer) {
+    char command[MAX_COMMAND] = "";
+    uint64_t start = hist_now_us();
+    uint64_t receive_start, send_start, send_end;
+    protocol_take_response_code();
+    protocol_take_send_failed();
+    protocol_take_phase_times(&receive_start, NULL, NULL);
+    trace_request_begin(receive_start);
+    trace_phase("receive");
+
+    dispatch_request(ctx, client_sock, buffer, command);
+
+    int code = protocol_take_response_code();
+    protocol_take_phase_times(NULL, &send_start, &send_end);
+    trace_response(send_start, send_end);
+    uint64_t elapsed = hist_now_us() - start;
+    metrics_record_request(command, code, elapsed);
+    trace_request_end(command, code, tls_request_user_id);
+    PROBE4(request__done, command, tls_request_user_id, code, elapsed);
+    arena_reset(&ctx->arena);
+    return protocol_take_send_failed() ? -1 : 0;
+}
+
+// SIGINT / SIGTERM: dừng reactor để main chạy tiếp phần dọn dẹp (checkpoint WAL, thống kê db)
+// SA_RESETHAND: tín hiệu lần 2 kết thúc ngay
+static void handle_shutdown_signal(int sig) {
+    (void)sig;
+    reactor_stop();
+}
+
+static void install_shutdown_handlers(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_shutdown_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+// Cho phép giữ nhiều kết nối: nâng giới hạn file descriptor mềm lên giới hạn cứng
+static void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0) return;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
     }
-    
-    close(client_sock);
-    return NULL;
+    printf("[SERVER] File descriptor limit: %llu\n", (unsigned long long)rl.rlim_cur);
 }
 
 int main() {
-    int server_sock, client_sock;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
+    int server_sock;
+    struct sockaddr_in server_addr;
     
     printf("=== TCP Socket Server ===\n");
     printf("Initializing...\n");
@@ -1000,11 +1159,31 @@ int main() {
         return 1;
     }
     
+    // Pool băm mật khẩu (KDF) tách khỏi các thread xử lý request
+    if (password_pool_init(PASSWORD_POOL_THREADS, PASSWORD_POOL_QUEUE) < 0) {
+        fprintf(stderr, "Failed to start password hashing pool\n");
+        return 1;
+    }
+    
     // Build connection string and initialize PostgreSQL database
     char* conninfo = config_build_conninfo(&db_config);
     printf("[CONFIG] Connecting to database: %s@%s:%s/%s\n", 
            db_config.user, db_config.host, db_config.port, db_config.dbname);
     
+    // Thống kê độ trễ + slow query log của tầng dữ liệu
+    if (query_stats_configure(db_config.slow_query_ms, db_config.slow_query_explain,
+                              db_config.slow_query_log) < 0) {
+        fprintf(stderr, "Warning: cannot open slow query log %s\n", db_config.slow_query_log);
+    }
+    
+    // Trace theo phase (tắt mặc định)
+    if (trace_init(db_config.trace_file, db_config.trace_sample, db_config.trace_slow_ms) < 0) {
+        fprintf(stderr, "Warning: cannot open trace file %s\n", db_config.trace_file);
+    } else if (trace_enabled()) {
+        printf("[TRACE] Writing request traces to %s\n", db_config.trace_file);
+    }
+    
+    db_set_write_coalescing(db_config.write_coalesce);
     if (db_init(conninfo) < 0) {
         fprintf(stderr, "Failed to initialize database\n");
         return 1;
@@ -1012,9 +1191,21 @@ int main() {
     
     // Initialize session manager
     session_init(&sm);
+    protocol_set_activity_log_hook(ship_activity_log);
     printf("[DATABASE] PostgreSQL database connected successfully\n");
     printf("[SESSION] Session manager initialized\n");
     
+    // Metrics theo command + endpoint Prometheus trên loopback
+    if (metrics_init(&sm, METRICS_PORT) < 0) {
+        fprintf(stderr, "Failed to initialize metrics\n");
+        return 1;
+    }
+    
+    raise_fd_limit();
+    // Ghi vào socket client đã reset trả EPIPE thay vì kết thúc server
+    signal(SIGPIPE, SIG_IGN);
+    install_shutdown_handlers();
+    
     server_sock = socket(AF_INET, SOCK_STREAM, 0);
     if (server_sock < 0) {
         perror("Socket creation failed");
@@ -1049,27 +1240,17 @@ int main() {
     printf("[SERVER] Listening on port %d\n", PORT);
     printf("[SERVER] Waiting for connections...\n\n");
     
-    while (1) {
-        client_sock = accept(server_sock, (struct sockaddr*)&client_addr, &client_addr_len);
-        if (client_sock < 0) {
-            perror("Accept failed");
-            continue;
-        }
-        
-        pthread_t thread;
-        int* client_sock_ptr = malloc(sizeof(int));
-        *client_sock_ptr = client_sock;
-        
-        if (pthread_create(&thread, NULL, client_thread, client_sock_ptr) != 0) {
-            perror("Thread creation failed");
-            close(client_sock);
-            free(client_sock_ptr);
-        } else {
-            pthread_detach(thread);
-        }
+    // epoll + pool worker (reactor.h) thay cho 1 thread / kết nối
+    if (reactor_run(server_sock, db_config.worker_threads, &sm) < 0) {
+        fprintf(stderr, "Failed to start reactor\n");
     }
+    printf("[SERVER] Shutting down\n");
     
     close(server_sock);
+    protocol_set_activity_log_hook(NULL);
+    metrics_shutdown();
+    trace_shutdown();
     db_cleanup();
+    password_pool_destroy();
     return 0;
 }
@@ -9,11 +9,13 @@
 #include "session.h"
 
 #define PORT 8888
-#define MAX_CLIENTS 100
+#define MAX_CLIENTS SOMAXCONN   // Backlog của listen() (số kết nối do reactor quyết định)
 
 typedef struct {
     int socket;
     SessionManager* sm;
+    Buffer response;   // Buffer response của worker, dùng lại giữa các request
+    Arena arena;       // Bộ nhớ tạm của request (fields...), reset sau mỗi request
 } ServerContext;
 
 // Handler functions
@@ -25,7 +27,8 @@ void handle_accept_friend_request(ServerContext* ctx, int client_sock, char** fi
 void handle_reject_friend_request(ServerContext* ctx, int client_sock, char** fields, int field_count);
 void handle_unfriend(ServerContext* ctx, int client_sock, char** fields, int field_count);
 
-void handle_client_request(ServerContext* ctx, int client_sock, const char* buffer);
+// Xử lý 1 dòng request; trả về -1 nếu gửi response thất bại (kết nối phải đóng), 0 nếu không
+int handle_client_request(ServerContext* ctx, int client_sock, const char* buffer);
 
 void handle_create_event(ServerContext* ctx, int client_sock, char** fields, int field_count); // New
 void handle_get_events(ServerContext* ctx, int client_sock, char** fields, int field_count); // New
@@ -37,4 +40,5 @@ void handle_send_invitation_event(ServerContext* ctx, int client_sock, char** fi
 void handle_accept_invitation_request(ServerContext* ctx, int client_sock, char** fields, int field_count); // Tuan3
 void handle_join_event(ServerContext* ctx, int client_sock, char** fields, int field_count); // Tuan3
 void handle_accept_join_request(ServerContext* ctx, int client_sock, char** fields, int field_count); // Tuan3
+void handle_stats(ServerContext* ctx, int client_sock, char** fields, int field_count);
 #endif 
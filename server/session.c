@@ -1,4 +1,5 @@
 #include "session.h"
+#include "../common/probes.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,11 +8,14 @@
 
 static pthread_mutex_t session_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Chuỗi băm mà slot thuộc về
+enum { CHAIN_TOKEN, CHAIN_SOCKET, CHAIN_USER };
+
 // Generate random token
 static void generate_token(char* token) {
     const char charset[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    int len = 32;
-    
+    int len = SESSION_TOKEN_LEN;
+
     for (int i = 0; i < len; i++) {
         int index = rand() % (sizeof(charset) - 1);
         token[i] = charset[index];
@@ -19,74 +23,138 @@ static void generate_token(char* token) {
     token[len] = '\0';
 }
 
+static unsigned int hash_token(const char* token) {
+    unsigned int h = 2166136261u;
+    for (; *token; token++) h = (h ^ (unsigned char)*token) * 16777619u;
+    return h & (SESSION_HASH_SIZE - 1);
+}
+
+static unsigned int hash_int(int value) {
+    return ((unsigned int)value * 2654435761u) & (SESSION_HASH_SIZE - 1);
+}
+
+static int* chain_head(SessionManager* sm, int chain, const Session* s) {
+    switch (chain) {
+    case CHAIN_TOKEN: return &sm->by_token[hash_token(s->token)];
+    case CHAIN_SOCKET: return &sm->by_socket[hash_int(s->client_socket)];
+    default: return &sm->by_user[hash_int(s->user_id)];
+    }
+}
+
+static int* chain_next(Session* s, int chain) {
+    switch (chain) {
+    case CHAIN_TOKEN: return &s->next_by_token;
+    case CHAIN_SOCKET: return &s->next_by_socket;
+    default: return &s->next_by_user;
+    }
+}
+
+static void chain_remove(SessionManager* sm, int chain, int index) {
+    int* link = chain_head(sm, chain, &sm->sessions[index]);
+    while (*link != -1) {
+        if (*link == index) {
+            *link = *chain_next(&sm->sessions[index], chain);
+            return;
+        }
+        link = chain_next(&sm->sessions[*link], chain);
+    }
+}
+
+// Tìm slot theo token (caller giữ session_mutex), -1 nếu không có
+static int find_token(SessionManager* sm, const char* token) {
+    for (int i = sm->by_token[hash_token(token)]; i != -1; i = sm->sessions[i].next_by_token) {
+        if (strcmp(sm->sessions[i].token, token) == 0) return i;
+    }
+    return -1;
+}
+
+// Hủy slot: gỡ khỏi các chỉ mục, trả về free list (caller giữ session_mutex)
+static void release_slot(SessionManager* sm, int index) {
+    Session* s = &sm->sessions[index];
+    chain_remove(sm, CHAIN_TOKEN, index);
+    chain_remove(sm, CHAIN_SOCKET, index);
+    chain_remove(sm, CHAIN_USER, index);
+    s->is_active = 0;
+    s->next_by_token = sm->free_head;
+    sm->free_head = index;
+    sm->active_count--;
+}
+
+static void release_expired(SessionManager* sm) {
+    time_t now = time(NULL);
+    for (int i = 0; i < sm->session_count; i++) {
+        if (sm->sessions[i].is_active && now - sm->sessions[i].last_activity > SESSION_TIMEOUT) {
+            release_slot(sm, i);
+        }
+    }
+}
+
 // Initialize session manager
 void session_init(SessionManager* sm) {
-    sm->session_count = 0;
     memset(sm->sessions, 0, sizeof(sm->sessions));
+    memset(sm->by_token, 0xff, sizeof(sm->by_token));     // -1
+    memset(sm->by_socket, 0xff, sizeof(sm->by_socket));
+    memset(sm->by_user, 0xff, sizeof(sm->by_user));
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        sm->sessions[i].next_by_token = i + 1 < MAX_SESSIONS ? i + 1 : -1;
+    }
+    sm->free_head = 0;
+    sm->session_count = 0;
+    sm->active_count = 0;
     srand(time(NULL));
 }
 
 // Create new session
 char* session_create(SessionManager* sm, int user_id, int client_socket) {
     pthread_mutex_lock(&session_mutex);
-    
-    if (sm->session_count >= MAX_SESSIONS) {
-        
-        time_t now = time(NULL);
-        for (int i = 0; i < sm->session_count; i++) {
-            if (sm->sessions[i].is_active) {
-                if (now - sm->sessions[i].last_activity > SESSION_TIMEOUT) {
-                    sm->sessions[i].is_active = 0;
-                }
-            }
-        }
-    }
-    
 
-    int slot_index = -1;
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (!sm->sessions[i].is_active) {
-            slot_index = i;
-            break;
-        }
+    // Bảng đầy: thu hồi session hết hạn
+    if (sm->free_head == -1) {
+        release_expired(sm);
     }
-    
+
+    int slot_index = sm->free_head;
     if (slot_index == -1) {
         pthread_mutex_unlock(&session_mutex);
-        return NULL; 
+        PROBE3(session__create, user_id, client_socket, (const char*)NULL);
+        return NULL;
     }
-    
-   
+
+    Session* new_session = &sm->sessions[slot_index];
+    sm->free_head = new_session->next_by_token;
     if (slot_index >= sm->session_count) {
         sm->session_count = slot_index + 1;
     }
-    
-    // Create new session
-    Session* new_session = &sm->sessions[slot_index];
-    generate_token(new_session->token);
+
+    // Create new session (token trùng thì sinh lại)
+    do {
+        generate_token(new_session->token);
+    } while (find_token(sm, new_session->token) != -1);
     new_session->user_id = user_id;
     new_session->client_socket = client_socket;
     new_session->created_at = time(NULL);
     new_session->last_activity = time(NULL);
     new_session->is_active = 1;
-    
+
+    for (int chain = CHAIN_TOKEN; chain <= CHAIN_USER; chain++) {
+        int* head = chain_head(sm, chain, new_session);
+        *chain_next(new_session, chain) = *head;
+        *head = slot_index;
+    }
+    sm->active_count++;
+
     pthread_mutex_unlock(&session_mutex);
+    PROBE3(session__create, user_id, client_socket, new_session->token);
     return new_session->token;
 }
 
 // Find session by token
 Session* session_find_by_token(SessionManager* sm, const char* token) {
     pthread_mutex_lock(&session_mutex);
-    Session* result = NULL;
-    
-    for (int i = 0; i < sm->session_count; i++) {
-        if (sm->sessions[i].is_active && strcmp(sm->sessions[i].token, token) == 0) {
-            result = &sm->sessions[i];
-            break;
-        }
-    }
-    
+    int index = find_token(sm, token);
+    Session* result = index != -1 ? &sm->sessions[index] : NULL;
     pthread_mutex_unlock(&session_mutex);
+    PROBE2(session__lookup, token, result ? result->user_id : -1);
     return result;
 }
 
@@ -94,14 +162,14 @@ Session* session_find_by_token(SessionManager* sm, const char* token) {
 Session* session_find_by_socket(SessionManager* sm, int client_socket) {
     pthread_mutex_lock(&session_mutex);
     Session* result = NULL;
-    
-    for (int i = 0; i < sm->session_count; i++) {
-        if (sm->sessions[i].is_active && sm->sessions[i].client_socket == client_socket) {
+
+    for (int i = sm->by_socket[hash_int(client_socket)]; i != -1; i = sm->sessions[i].next_by_socket) {
+        if (sm->sessions[i].client_socket == client_socket) {
             result = &sm->sessions[i];
             break;
         }
     }
-    
+
     pthread_mutex_unlock(&session_mutex);
     return result;
 }
@@ -109,59 +177,46 @@ Session* session_find_by_socket(SessionManager* sm, int client_socket) {
 // Destroy session
 void session_destroy(SessionManager* sm, const char* token) {
     pthread_mutex_lock(&session_mutex);
-    
-    for (int i = 0; i < sm->session_count; i++) {
-        if (sm->sessions[i].is_active && strcmp(sm->sessions[i].token, token) == 0) {
-            sm->sessions[i].is_active = 0;
-            break;
-        }
+
+    int index = find_token(sm, token);
+    if (index != -1) {
+        PROBE2(session__destroy, sm->sessions[index].user_id, sm->sessions[index].client_socket);
+        release_slot(sm, index);
     }
-    
+
     pthread_mutex_unlock(&session_mutex);
 }
 
 // Cleanup expired sessions
 void session_cleanup_expired(SessionManager* sm) {
     pthread_mutex_lock(&session_mutex);
-    time_t now = time(NULL);
-    
-    for (int i = 0; i < sm->session_count; i++) {
-        if (sm->sessions[i].is_active) {
-            if (now - sm->sessions[i].last_activity > SESSION_TIMEOUT) {
-                sm->sessions[i].is_active = 0;
-            }
-        }
-    }
-    
+    release_expired(sm);
     pthread_mutex_unlock(&session_mutex);
 }
 
 // Validate session and update last activity
 int session_validate(SessionManager* sm, const char* token) {
     pthread_mutex_lock(&session_mutex);
-    Session* session = NULL;
-    
-    for (int i = 0; i < sm->session_count; i++) {
-        if (sm->sessions[i].is_active && strcmp(sm->sessions[i].token, token) == 0) {
-            session = &sm->sessions[i];
-            break;
-        }
-    }
-    
-    if (session == NULL) {
+
+    int index = find_token(sm, token);
+    if (index == -1) {
         pthread_mutex_unlock(&session_mutex);
+        PROBE2(session__validate, token, 0);
         return 0;
     }
-    
+
+    Session* session = &sm->sessions[index];
     time_t now = time(NULL);
     if (now - session->last_activity > SESSION_TIMEOUT) {
-        session->is_active = 0;
+        release_slot(sm, index);
         pthread_mutex_unlock(&session_mutex);
+        PROBE2(session__validate, token, 0);
         return 0;
     }
-    
+
     session->last_activity = now;
     pthread_mutex_unlock(&session_mutex);
+    PROBE2(session__validate, token, 1);
     return 1;
 }
 
@@ -169,16 +224,23 @@ int session_validate(SessionManager* sm, const char* token) {
 // Inspired by previous assignment's is_user_logged_in function
 int session_is_user_logged_in(SessionManager* sm, int user_id, int exclude_socket) {
     pthread_mutex_lock(&session_mutex);
-    
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (sm->sessions[i].is_active &&
-            sm->sessions[i].user_id == user_id &&
+
+    for (int i = sm->by_user[hash_int(user_id)]; i != -1; i = sm->sessions[i].next_by_user) {
+        if (sm->sessions[i].user_id == user_id &&
             sm->sessions[i].client_socket != exclude_socket) {
             pthread_mutex_unlock(&session_mutex);
             return 1;  // User already logged in on another client
         }
     }
-    
+
     pthread_mutex_unlock(&session_mutex);
     return 0;  // User not logged in anywhere else
 }
+
+// Count active sessions (metrics gauge)
+int session_active_count(SessionManager* sm) {
+    pthread_mutex_lock(&session_mutex);
+    int count = sm->active_count;
+    pthread_mutex_unlock(&session_mutex);
+    return count;
+}
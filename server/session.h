@@ -4,9 +4,14 @@
 #include <time.h>
 #include "postgres_db.h"
 
-#define MAX_SESSIONS 1000
+// Bảng session cố định + chỉ mục băm theo token / socket / user_id
+// - Tìm / tạo / hủy O(1) thay vì quét cả bảng => đủ cho ~100k kết nối đã đăng nhập
+// - Slot trống nằm trong free list; con trỏ Session* trả về luôn trỏ vào bảng (không realloc)
+#define MAX_SESSIONS 131072
+#define SESSION_HASH_SIZE (MAX_SESSIONS * 2)   // Lũy thừa của 2
 #define SESSION_TIMEOUT 3600 
 #define MAX_TOKEN 64
+#define SESSION_TOKEN_LEN 32    // Số ký tự chữ/số của token (generate_token)
 
 typedef struct {
     char token[MAX_TOKEN];
@@ -15,11 +20,19 @@ typedef struct {
     time_t created_at;
     time_t last_activity; 
     int is_active;
+    int next_by_token;      // Slot kế trong chuỗi băm (-1 = hết); slot trống: slot trống kế tiếp
+    int next_by_socket;
+    int next_by_user;
 } Session;
 
 typedef struct {
     Session sessions[MAX_SESSIONS];
-    int session_count;
+    int session_count;      // Số slot đầu bảng đã từng dùng
+    int active_count;
+    int free_head;          // Slot trống đầu tiên, -1 = bảng đầy
+    int by_token[SESSION_HASH_SIZE];
+    int by_socket[SESSION_HASH_SIZE];
+    int by_user[SESSION_HASH_SIZE];
 } SessionManager;
 
 // Session functions
@@ -31,5 +44,6 @@ void session_destroy(SessionManager* sm, const char* token);
 void session_cleanup_expired(SessionManager* sm);
 int session_validate(SessionManager* sm, const char* token);
 int session_is_user_logged_in(SessionManager* sm, int user_id, int exclude_socket);
+int session_active_count(SessionManager* sm);    // Số session đang active (gauge metrics)
 
 #endif 
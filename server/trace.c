@@ -0,0 +1,200 @@
+#include "trace.h"
+#include "../common/histogram.h"
+#include "../common/protocol.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+typedef struct {
+    const char* name;
+    const char* cat;            // "phase" hoặc "sql"
+    uint64_t start;
+    uint64_t end;
+} TraceSpan;
+
+typedef struct {
+    int recording;
+    int tid;                    // Số thứ tự thread trong file trace
+    uint64_t start;
+    uint64_t mark;              // Mốc kết thúc phase gần nhất
+    uint64_t db_first;          // Lệnh DB đầu tiên / cuối cùng kể từ mốc (0 = chưa có)
+    uint64_t db_last;
+    int sent;                   // Đã gửi response
+    int count;
+    int dropped;
+    TraceSpan spans[TRACE_MAX_SPANS];
+} TraceBuffer;
+
+static __thread TraceBuffer tls_trace;
+
+static int trace_on = 0;
+static int sample_every = 0;
+static uint64_t slow_us = 0;
+static unsigned long request_seq = 0;
+static int next_tid = 0;
+static uint64_t epoch_us = 0;     // ts trong file tính từ lúc trace_init
+static int pid = 0;
+
+static pthread_mutex_t file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE* trace_file = NULL;
+static unsigned long events_written = 0;
+
+int trace_init(const char* path, int every, int slow_ms) {
+    if (every <= 0 && slow_ms <= 0) return 0;
+
+    trace_file = fopen(path ? path : TRACE_FILE, "w");
+    if (!trace_file) return -1;
+    fputs("[\n", trace_file);
+
+    sample_every = every > 0 ? every : 0;
+    slow_us = slow_ms > 0 ? (uint64_t)slow_ms * 1000 : 0;
+    epoch_us = hist_now_us();
+    pid = (int)getpid();
+    trace_on = 1;
+    protocol_set_phase_timing(1);
+    return 0;
+}
+
+void trace_shutdown(void) {
+    trace_on = 0;
+    protocol_set_phase_timing(0);
+    pthread_mutex_lock(&file_mutex);
+    if (trace_file) {
+        fputs("\n]\n", trace_file);
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    pthread_mutex_unlock(&file_mutex);
+}
+
+int trace_enabled(void) {
+    return trace_on;
+}
+
+static void push_span(TraceBuffer* t, const char* name, const char* cat, uint64_t start, uint64_t end) {
+    if (t->count == TRACE_MAX_SPANS) {
+        t->dropped++;
+        return;
+    }
+    TraceSpan* s = &t->spans[t->count++];
+    s->name = name;
+    s->cat = cat;
+    s->start = start;
+    s->end = end < start ? start : end;
+}
+
+void trace_request_begin(uint64_t start_us) {
+    TraceBuffer* t = &tls_trace;
+    t->recording = trace_on;
+    if (!t->recording) return;
+
+    uint64_t now = hist_now_us();
+    t->start = t->mark = (start_us && start_us <= now) ? start_us : now;
+    t->db_first = t->db_last = 0;
+    t->sent = 0;
+    t->count = 0;
+    t->dropped = 0;
+}
+
+// Đóng phase tại end; nếu có lệnh DB từ mốc trước thì tách thành handler / db / name
+static void close_phase(TraceBuffer* t, const char* name, uint64_t end) {
+    if (t->db_first) {
+        if (t->db_first > t->mark) push_span(t, "handler", "phase", t->mark, t->db_first);
+        push_span(t, "db", "phase", t->db_first, t->db_last);
+        t->mark = t->db_last;
+        t->db_first = t->db_last = 0;
+    }
+    if (end < t->mark) end = t->mark;
+    push_span(t, name, "phase", t->mark, end);
+    t->mark = end;
+}
+
+void trace_phase(const char* name) {
+    TraceBuffer* t = &tls_trace;
+    if (!t->recording) return;
+    close_phase(t, name, hist_now_us());
+}
+
+void trace_db_span(const char* name, uint64_t start_us, uint64_t end_us) {
+    TraceBuffer* t = &tls_trace;
+    if (!t->recording) return;
+    push_span(t, name, "sql", start_us, end_us);
+    if (!t->db_first) t->db_first = start_us;
+    if (end_us > t->db_last) t->db_last = end_us;
+}
+
+void trace_response(uint64_t send_start_us, uint64_t send_end_us) {
+    TraceBuffer* t = &tls_trace;
+    if (!t->recording || !send_start_us) return;
+    close_phase(t, t->db_first ? "serialize" : "handler", send_start_us);
+    close_phase(t, "send", send_end_us);
+    t->sent = 1;
+}
+
+// Chuỗi JSON (lệnh do client gửi: phải escape)
+static void append_json_string(Buffer* b, const char* s) {
+    buffer_append(b, "\"", 1);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            buffer_append(b, esc, 2);
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            buffer_append_str(b, esc);
+        } else {
+            buffer_append(b, (const char*)&c, 1);
+        }
+    }
+    buffer_append(b, "\"", 1);
+}
+
+static void append_event(Buffer* b, const char* name, const char* cat, uint64_t start, uint64_t end,
+                         int tid, const char* args) {
+    char tail[256];
+    buffer_append_str(b, b->len ? ",\n{\"name\":" : "{\"name\":");
+    append_json_string(b, name);
+    snprintf(tail, sizeof(tail), ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%d%s}",
+             cat, (unsigned long long)(start - epoch_us), (unsigned long long)(end - start), pid, tid,
+             args ? args : "");
+    buffer_append_str(b, tail);
+}
+
+void trace_request_end(const char* command, int code, int user_id) {
+    TraceBuffer* t = &tls_trace;
+    if (!t->recording) return;
+    t->recording = 0;
+
+    uint64_t end = hist_now_us();
+    int sampled = sample_every > 0 &&
+                  __atomic_fetch_add(&request_seq, 1, __ATOMIC_RELAXED) % (unsigned long)sample_every == 0;
+    int slow = slow_us > 0 && end - t->start >= slow_us;
+    if (!sampled && !slow) return;
+
+    // Phần còn lại sau khi gửi (activity log, giải phóng)
+    close_phase(t, t->sent ? "log" : "handler", end);
+
+    if (!t->tid) t->tid = __atomic_add_fetch(&next_tid, 1, __ATOMIC_RELAXED);
+
+    Buffer out;
+    buffer_init(&out);
+    char args[160];
+    snprintf(args, sizeof(args), ",\"args\":{\"code\":%d,\"user\":%d,\"sampled\":%d,\"dropped_spans\":%d}",
+             code, user_id, sampled, t->dropped);
+    append_event(&out, command[0] ? command : "UNKNOWN", "request", t->start, end, t->tid, args);
+    for (int i = 0; i < t->count; i++) {
+        const TraceSpan* s = &t->spans[i];
+        append_event(&out, s->name, s->cat, s->start, s->end, t->tid, NULL);
+    }
+
+    pthread_mutex_lock(&file_mutex);
+    if (trace_file && out.data) {
+        if (events_written++) fputs(",\n", trace_file);
+        fwrite(out.data, 1, out.len, trace_file);
+        fflush(trace_file);
+    }
+    pthread_mutex_unlock(&file_mutex);
+    buffer_free(&out);
+}
@@ -0,0 +1,65 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// =========================================
+// TRACE THEO PHASE CỦA REQUEST
+// - Mỗi request ghi mốc thời gian ở ranh giới các phase vào buffer thread-local
+//   (không lock, không cấp phát):
+//     receive   byte đầu tiên -> nhận đủ dòng request
+//     parse     parse_request
+//     validate  kiểm tra tham số trước khi tra session
+//     auth      tra session theo token
+//     handler   xử lý trước / không có lệnh DB
+//     db        lệnh DB đầu tiên -> lệnh DB cuối (từng câu lệnh là span con, cat "sql")
+//     serialize sau lệnh DB cuối -> bắt đầu gửi
+//     send      gửi response
+//     log       ghi activity log sau khi gửi
+// - Xuất có lấy mẫu: 1 / trace_sample request, và mọi request >= trace_slow_ms
+// - File: Chrome trace JSON (mở bằng ui.perfetto.dev hoặc chrome://tracing),
+//   mỗi phase là 1 event "X" lồng trong event của request; thiếu "]" cuối
+//   (server bị kill) vẫn đọc được
+// - Span DB hiện có ở backend postgres; backend memory/embedded chạy trong tiến trình
+//   nên thời gian đó nằm trong "handler"
+// Cấu hình: trace_sample, trace_slow_ms, trace_file trong config/database.conf
+// =========================================
+#include <stdint.h>
+
+#define TRACE_MAX_SPANS 64          // Span tối đa / request, vượt thì bỏ (đếm dropped)
+#define TRACE_FILE "trace.json"
+
+/**
+ * Chức năng: Mở file trace và bật đo phase (gọi 1 lần lúc khởi động)
+ * @param path          File trace (ghi đè), NULL = TRACE_FILE
+ * @param sample_every  Xuất 1 / N request, <= 0 = không lấy mẫu theo số lượng
+ * @param slow_ms       Luôn xuất request chậm hơn ngưỡng, <= 0 = tắt
+ * @return 0 nếu thành công (cả 2 tham số <= 0 = trace tắt), -1 nếu không mở được file
+ */
+int trace_init(const char* path, int sample_every, int slow_ms);
+
+// Đóng mảng JSON và file trace
+void trace_shutdown(void);
+
+// 1 nếu trace đang bật
+int trace_enabled(void);
+
+// Bắt đầu request trên thread hiện tại (start_us: lúc nhận byte đầu tiên, 0 = bây giờ)
+void trace_request_begin(uint64_t start_us);
+
+// Phase vừa kết thúc (tính từ mốc trước đến bây giờ); name là chuỗi hằng
+void trace_phase(const char* name);
+
+// Span 1 câu lệnh DB (name là chuỗi hằng, VD __func__); không dời mốc phase
+void trace_db_span(const char* name, uint64_t start_us, uint64_t end_us);
+
+// Đóng phase trước khi gửi (serialize hoặc handler) và ghi phase send
+void trace_response(uint64_t send_start_us, uint64_t send_end_us);
+
+/**
+ * Chức năng: Kết thúc request, xuất ra file nếu được lấy mẫu hoặc chậm
+ * @param command  Tên lệnh
+ * @param code     Mã response (0 = không gửi)
+ * @param user_id  User của kết nối (0 = chưa đăng nhập)
+ */
+void trace_request_end(const char* command, int code, int user_id);
+
+#endif // TRACE_H
@@ -0,0 +1,123 @@
+#include "user_cache.h"
+#include "lru_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    LruEntry lru;             // Phải là thành viên đầu tiên
+    CachedUser user;
+} UserEntry;
+
+// 2 index của cùng dữ liệu dùng chung 1 generation
+static unsigned long generation = 0;
+static LruCache by_name;
+static LruCache by_id;
+
+static int match_username(const LruEntry* e, const void* key) {
+    return strcmp(((const UserEntry*)e)->user.username, (const char*)key) == 0;
+}
+
+static int match_user_id(const LruEntry* e, const void* key) {
+    return ((const UserEntry*)e)->user.user_id == *(const int*)key;
+}
+
+static void free_user_entry(LruEntry* e) {
+    free(e);
+}
+
+static int index_get(LruCache* idx, unsigned int hash, const void* key, CachedUser* out) {
+    LruShard* shard = lru_cache_shard(idx, hash);
+    pthread_mutex_lock(&shard->lock);
+    UserEntry* e = (UserEntry*)lru_cache_find_locked(idx, shard, hash, key);
+    if (e) *out = e->user;
+    pthread_mutex_unlock(&shard->lock);
+    return e != NULL;
+}
+
+// Gọi khi đang giữ shard->lock
+static void index_put_locked(LruCache* idx, LruShard* shard, unsigned int hash, const void* key,
+                             const CachedUser* user) {
+    UserEntry* e = (UserEntry*)lru_cache_find_locked(idx, shard, hash, key);
+    if (e) {
+        e->user = *user;
+        lru_cache_touch_locked(idx, &e->lru);
+        return;
+    }
+    e = (UserEntry*)calloc(1, sizeof(UserEntry));
+    if (!e) return;
+    e->user = *user;
+    lru_cache_insert_locked(idx, shard, hash, &e->lru);
+}
+
+void user_cache_init(void) {
+    lru_cache_init(&by_name, USER_CACHE_SHARD_CAPACITY, USER_CACHE_TTL, match_username, free_user_entry,
+                   &generation);
+    lru_cache_init(&by_id, USER_CACHE_SHARD_CAPACITY, USER_CACHE_TTL, match_user_id, free_user_entry,
+                   &generation);
+}
+
+void user_cache_destroy(void) {
+    user_cache_clear();
+}
+
+unsigned long user_cache_generation(void) {
+    return lru_cache_generation(&by_id);
+}
+
+int user_cache_get_by_username(const char* username, CachedUser* out) {
+    if (!username || !out) return 0;
+    return index_get(&by_name, lru_hash_string(username), username, out);
+}
+
+int user_cache_get_by_id(int user_id, CachedUser* out) {
+    if (user_id <= 0 || !out) return 0;
+    return index_get(&by_id, lru_hash_int(user_id), &user_id, out);
+}
+
+void user_cache_put(const CachedUser* user, unsigned long gen) {
+    if (!user || user->user_id <= 0 || user->username[0] == '\0') return;
+
+    LruCache* indexes[2] = { &by_name, &by_id };
+    unsigned int hashes[2] = { lru_hash_string(user->username), lru_hash_int(user->user_id) };
+    const void* keys[2] = { user->username, &user->user_id };
+
+    for (int k = 0; k < 2; k++) {
+        LruShard* shard = lru_cache_shard(indexes[k], hashes[k]);
+        pthread_mutex_lock(&shard->lock);
+        // Kiểm tra generation dưới khóa shard: invalidate luôn tăng generation trước khi xóa
+        if (user_cache_generation() == gen) {
+            index_put_locked(indexes[k], shard, hashes[k], keys[k], user);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+void user_cache_invalidate(int user_id, const char* username) {
+    lru_cache_bump_generation(&by_id);
+
+    // Username cũ lấy từ index theo id (trường hợp caller chỉ biết user_id)
+    char cached_name[MAX_USERNAME] = "";
+    if (user_id > 0) {
+        unsigned int hash = lru_hash_int(user_id);
+        LruShard* shard = lru_cache_shard(&by_id, hash);
+        pthread_mutex_lock(&shard->lock);
+        UserEntry* e = (UserEntry*)lru_cache_find_locked(&by_id, shard, hash, &user_id);
+        if (e) {
+            snprintf(cached_name, sizeof(cached_name), "%s", e->user.username);
+            lru_cache_remove_locked(&by_id, shard, &e->lru);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    if (username && username[0] != '\0') {
+        lru_cache_invalidate(&by_name, lru_hash_string(username), username);
+    }
+    if (cached_name[0] != '\0' && (!username || strcmp(cached_name, username) != 0)) {
+        lru_cache_invalidate(&by_name, lru_hash_string(cached_name), cached_name);
+    }
+}
+
+void user_cache_clear(void) {
+    lru_cache_clear(&by_name);
+    lru_cache_clear(&by_id);
+}
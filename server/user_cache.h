@@ -0,0 +1,53 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include "../common/protocol.h"
+
+// =========================================
+// USER CACHE
+// Cache in-process cho db_find_user_by_username / db_find_user_by_id
+// - 2 index (username, user_id) trên sharded LRU + TTL (lru_cache.h), chung 1 generation
+// - Thay đổi users (kể cả từ nơi khác: SQL trực tiếp, server_app khác) được xóa khỏi cache
+//   qua LISTEN/NOTIFY (cache_listener.h); mất kết nối listener thì chỉ còn TTL
+// =========================================
+#define USER_CACHE_SHARD_CAPACITY 256   // Số entry tối đa mỗi shard (mỗi index)
+#define USER_CACHE_TTL 60               // Giây
+
+typedef struct {
+    int user_id;
+    char username[MAX_USERNAME];
+    char email[MAX_EMAIL];
+    int is_active;
+} CachedUser;
+
+void user_cache_init(void);
+void user_cache_destroy(void);
+
+/**
+ * Chức năng: Lấy generation hiện tại của cache
+ * - Đọc trước khi query DB, truyền vào user_cache_put() sau đó
+ * - Nếu có invalidate xảy ra trong lúc query thì kết quả cũ sẽ bị bỏ qua
+ */
+unsigned long user_cache_generation(void);
+
+/**
+ * Chức năng: Tra cứu user trong cache
+ * @return 1 nếu có (và chưa hết hạn), 0 nếu không có
+ */
+int user_cache_get_by_username(const char* username, CachedUser* out);
+int user_cache_get_by_id(int user_id, CachedUser* out);
+
+// Lưu user vào cả 2 index (username và user_id)
+void user_cache_put(const CachedUser* user, unsigned long generation);
+
+/**
+ * Chức năng: Xóa user khỏi cache (cache_listener gọi khi trigger báo users thay đổi)
+ * @param user_id  ID user (<= 0 nếu không biết)
+ * @param username Tên user (NULL nếu không biết)
+ */
+void user_cache_invalidate(int user_id, const char* username);
+
+// Xóa toàn bộ cache
+void user_cache_clear(void);
+
+#endif // USER_CACHE_H
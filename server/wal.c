@@ -0,0 +1,511 @@
+#include "wal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#define WAL_SNAPSHOT_MAGIC "EVSNAP01"
+#define WAL_SNAPSHOT_MAGIC_LEN 8
+#define WAL_PATH_SIZE 512
+
+static pthread_mutex_t wal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;     // Đánh thức flusher
+static pthread_cond_t durable_cond = PTHREAD_COND_INITIALIZER;  // durable_lsn tăng / hết flushing
+static pthread_cond_t checkpoint_cond = PTHREAD_COND_INITIALIZER;
+static Buffer pending;                      // Record đã append, chưa write
+static unsigned long long appended_lsn = 0; // LSN = số thứ tự record
+static unsigned long long durable_lsn = 0;
+static int flushing = 0;                    // Flusher đang write/fsync ngoài lock
+static int wal_fd = -1;
+static unsigned int segment = 0;
+static size_t bytes_since_checkpoint = 0;
+static time_t last_checkpoint = 0;
+static int wal_running = 0;
+static int wal_stop = 0;
+static int checkpoint_stop = 0;
+static pthread_t flusher_thread;
+static pthread_t checkpointer_thread;
+static char wal_dir[WAL_PATH_SIZE / 2];
+static WalSnapshotFn snapshot_fn = NULL;
+static uint32_t crc_table[256];
+
+static void crc32_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_of(const unsigned char* p, size_t n) {
+    uint32_t c = 0xFFFFFFFFu;
+    while (n--) c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+// Không biết phần nào đã xuống đĩa => không thể tiếp tục an toàn (như PANIC của PostgreSQL)
+static void wal_fatal(const char* what) {
+    fprintf(stderr, "[WAL] %s failed: %s - shutting down\n", what, strerror(errno));
+    abort();
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void fsync_dir(void) {
+    int fd = open(wal_dir, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+static void segment_path(char* out, size_t size, unsigned int seg) {
+    snprintf(out, size, "%s/wal.%08u", wal_dir, seg);
+}
+
+static int open_segment(unsigned int seg) {
+    char path[WAL_PATH_SIZE];
+    segment_path(path, sizeof(path), seg);
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "[WAL] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fsync_dir();
+    return fd;
+}
+
+size_t wal_record_begin(Buffer* b) {
+    size_t start = b->len;
+    static const char header[WAL_RECORD_HEADER] = { 0 };
+    if (buffer_append(b, header, sizeof(header)) < 0) return (size_t)-1;
+    return start;
+}
+
+int wal_record_end(Buffer* b, size_t start) {
+    if (start == (size_t)-1 || start + WAL_RECORD_HEADER > b->len) return -1;
+    uint32_t len = (uint32_t)(b->len - start - WAL_RECORD_HEADER);
+    uint32_t crc = crc32_of((const unsigned char*)b->data + start + WAL_RECORD_HEADER, len);
+    memcpy(b->data + start, &len, 4);
+    memcpy(b->data + start + 4, &crc, 4);
+    return 0;
+}
+
+/**
+ * Áp dụng lần lượt các record trong data[0..size)
+ * @param valid_end Vị trí sau record hợp lệ cuối cùng
+ * @return 0 nếu đọc hết, 1 nếu gặp đuôi ghi dở/hỏng, -1 nếu apply lỗi
+ */
+static int apply_records(const unsigned char* data, size_t size, WalApplyFn apply, size_t* valid_end) {
+    size_t pos = 0;
+    *valid_end = 0;
+    while (pos < size) {
+        uint32_t len, crc;
+        if (size - pos < WAL_RECORD_HEADER) return 1;
+        memcpy(&len, data + pos, 4);
+        memcpy(&crc, data + pos + 4, 4);
+        if (len > size - pos - WAL_RECORD_HEADER) return 1;
+        const unsigned char* rec = data + pos + WAL_RECORD_HEADER;
+        if (crc32_of(rec, len) != crc) return 1;
+        if (apply(rec, len) < 0) return -1;
+        pos += WAL_RECORD_HEADER + len;
+        *valid_end = pos;
+    }
+    return 0;
+}
+
+static unsigned char* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    unsigned char* data = NULL;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long n = ftell(f);
+        if (n >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+            data = (unsigned char*)malloc((size_t)n + 1);
+            if (data && fread(data, 1, (size_t)n, f) != (size_t)n) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)n;
+        }
+    }
+    fclose(f);
+    return data;
+}
+
+// Nạp data/snapshot, return segment đầu tiên cần replay (0 nếu chưa có snapshot), -1 nếu lỗi
+static long load_snapshot(WalApplyFn apply) {
+    char path[WAL_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/snapshot", wal_dir);
+    if (access(path, F_OK) != 0) return 0;
+
+    size_t size = 0;
+    unsigned char* data = read_file(path, &size);
+    if (!data || size < WAL_SNAPSHOT_MAGIC_LEN + 4 ||
+        memcmp(data, WAL_SNAPSHOT_MAGIC, WAL_SNAPSHOT_MAGIC_LEN) != 0) {
+        fprintf(stderr, "[WAL] Invalid snapshot file %s\n", path);
+        free(data);
+        return -1;
+    }
+
+    uint32_t seg;
+    memcpy(&seg, data + WAL_SNAPSHOT_MAGIC_LEN, 4);
+    size_t header = WAL_SNAPSHOT_MAGIC_LEN + 4;
+    size_t valid_end;
+    // Snapshot chỉ được rename sau khi fsync xong => phải đọc trọn vẹn
+    int rc = apply_records(data + header, size - header, apply, &valid_end);
+    free(data);
+    if (rc != 0) {
+        fprintf(stderr, "[WAL] Corrupted snapshot file %s\n", path);
+        return -1;
+    }
+    return (long)seg;
+}
+
+static int cmp_uint(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+// Liệt kê các segment >= from (đã sắp xếp), return số lượng hoặc -1
+static int list_segments(unsigned int from, unsigned int** out) {
+    DIR* d = opendir(wal_dir);
+    if (!d) return -1;
+
+    int n = 0, cap = 16;
+    unsigned int* segs = (unsigned int*)malloc(sizeof(unsigned int) * (size_t)cap);
+    struct dirent* ent;
+    while (segs && (ent = readdir(d)) != NULL) {
+        unsigned int seg;
+        char tail;
+        if (sscanf(ent->d_name, "wal.%u%c", &seg, &tail) != 1 || seg < from) continue;
+        if (n == cap) {
+            unsigned int* grown = (unsigned int*)realloc(segs, sizeof(unsigned int) * (size_t)(cap *= 2));
+            if (!grown) {
+                free(segs);
+                segs = NULL;
+                break;
+            }
+            segs = grown;
+        }
+        segs[n++] = seg;
+    }
+    closedir(d);
+    if (!segs) return -1;
+
+    qsort(segs, (size_t)n, sizeof(unsigned int), cmp_uint);
+    *out = segs;
+    return n;
+}
+
+// Replay các segment sau snapshot, return segment lớn nhất đã thấy hoặc -1
+// replayed: tổng số byte record hợp lệ đã áp dụng
+static long replay_segments(unsigned int from, WalApplyFn apply, size_t* replayed) {
+    unsigned int* segs = NULL;
+    int n = list_segments(from, &segs);
+    if (n < 0) return -1;
+    *replayed = 0;
+
+    long last = from > 0 ? (long)from - 1 : 0;
+    for (int i = 0; i < n; i++) {
+        char path[WAL_PATH_SIZE];
+        segment_path(path, sizeof(path), segs[i]);
+
+        size_t size = 0;
+        unsigned char* data = read_file(path, &size);
+        if (!data) {
+            fprintf(stderr, "[WAL] Cannot read %s\n", path);
+            free(segs);
+            return -1;
+        }
+        size_t valid_end;
+        int rc = apply_records(data, size, apply, &valid_end);
+        free(data);
+        *replayed += valid_end;
+
+        if (rc == 1 && i == n - 1) {
+            // Đuôi ghi dở lúc crash: các record này chưa được báo thành công cho client
+            fprintf(stderr, "[WAL] Truncating torn tail of %s at %zu/%zu bytes\n", path, valid_end, size);
+            if (truncate(path, (off_t)valid_end) < 0) rc = -1; else rc = 0;
+        }
+        if (rc != 0) {
+            fprintf(stderr, "[WAL] Recovery failed at %s\n", path);
+            free(segs);
+            return -1;
+        }
+        last = (long)segs[i];
+    }
+    free(segs);
+    return last;
+}
+
+// Ghi snapshot (đã gồm các record) ra file tạm, fsync rồi rename; xóa segment cũ hơn seg
+static int write_snapshot(const Buffer* state, unsigned int seg) {
+    char path[WAL_PATH_SIZE], tmp[WAL_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/snapshot", wal_dir);
+    snprintf(tmp, sizeof(tmp), "%s/snapshot.tmp", wal_dir);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return -1;
+    uint32_t seg32 = seg;
+    int rc = write_all(fd, WAL_SNAPSHOT_MAGIC, WAL_SNAPSHOT_MAGIC_LEN);
+    if (rc == 0) rc = write_all(fd, (const char*)&seg32, 4);
+    if (rc == 0 && state->len > 0) rc = write_all(fd, state->data, state->len);
+    if (rc == 0) rc = fsync(fd);
+    close(fd);
+    if (rc != 0 || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    fsync_dir();
+
+    unsigned int* segs = NULL;
+    int n = list_segments(0, &segs);
+    for (int i = 0; i < n; i++) {
+        if (segs[i] >= seg) break;
+        char old[WAL_PATH_SIZE];
+        segment_path(old, sizeof(old), segs[i]);
+        unlink(old);
+    }
+    free(segs);
+    return 0;
+}
+
+// Gọi từ thread checkpoint, không giữ wal_mutex
+static void checkpoint(void) {
+    Buffer state;
+    buffer_init(&state);
+    unsigned int seg = snapshot_fn(&state);
+    if (seg == 0 || write_snapshot(&state, seg) < 0) {
+        fprintf(stderr, "[WAL] Checkpoint failed, keeping WAL segments\n");
+    } else {
+        printf("[WAL] Checkpoint written (%zu bytes), WAL now at segment %u\n", state.len, seg);
+    }
+    buffer_free(&state);
+
+    // Lỗi thì thử lại ở lần hẹn sau, không lặp liên tục
+    pthread_mutex_lock(&wal_mutex);
+    last_checkpoint = time(NULL);
+    if (seg == 0) bytes_since_checkpoint = 0;
+    pthread_mutex_unlock(&wal_mutex);
+}
+
+// Gọi khi đang giữ wal_mutex; write + fdatasync ngay trên thread hiện tại
+static void flush_pending_locked(void) {
+    if (pending.len == 0) return;
+    if (write_all(wal_fd, pending.data, pending.len) < 0) wal_fatal("WAL write");
+    if (fdatasync(wal_fd) < 0) wal_fatal("WAL fdatasync");
+    bytes_since_checkpoint += pending.len;
+    durable_lsn = appended_lsn;
+    buffer_reset(&pending);
+    pthread_cond_broadcast(&durable_cond);
+}
+
+unsigned int wal_rotate(void) {
+    pthread_mutex_lock(&wal_mutex);
+    while (flushing) pthread_cond_wait(&durable_cond, &wal_mutex);
+
+    // Backend đang giữ lock => không có append mới, pending thuộc về segment cũ
+    flush_pending_locked();
+    int fd = open_segment(segment + 1);
+    if (fd < 0) {
+        pthread_mutex_unlock(&wal_mutex);
+        return 0;
+    }
+    close(wal_fd);
+    wal_fd = fd;
+    segment++;
+    bytes_since_checkpoint = 0;
+    unsigned int seg = segment;
+    pthread_mutex_unlock(&wal_mutex);
+    return seg;
+}
+
+static void* flusher_main(void* arg) {
+    (void)arg;
+    Buffer batch;
+    buffer_init(&batch);
+
+    pthread_mutex_lock(&wal_mutex);
+    while (1) {
+        while (pending.len == 0 && !wal_stop) {
+            pthread_cond_wait(&work_cond, &wal_mutex);
+        }
+        if (pending.len == 0) break;  // wal_stop và đã ghi hết
+
+        // Group commit: mọi record tới trong lúc fsync trước sẽ đi chung lô này
+        Buffer tmp = pending;
+        pending = batch;
+        batch = tmp;
+        unsigned long long target = appended_lsn;
+        flushing = 1;
+        pthread_mutex_unlock(&wal_mutex);
+
+        if (write_all(wal_fd, batch.data, batch.len) < 0) wal_fatal("WAL write");
+        if (fdatasync(wal_fd) < 0) wal_fatal("WAL fdatasync");
+
+        pthread_mutex_lock(&wal_mutex);
+        bytes_since_checkpoint += batch.len;
+        buffer_reset(&batch);
+        flushing = 0;
+        durable_lsn = target;
+        pthread_cond_broadcast(&durable_cond);
+        if (bytes_since_checkpoint >= WAL_CHECKPOINT_BYTES) pthread_cond_signal(&checkpoint_cond);
+    }
+    pthread_mutex_unlock(&wal_mutex);
+
+    buffer_free(&batch);
+    return NULL;
+}
+
+// Checkpoint chạy trên thread riêng: flusher vẫn fsync lô mới trong lúc ghi snapshot
+static void* checkpointer_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&wal_mutex);
+    while (1) {
+        if (!checkpoint_stop) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += 1;
+            pthread_cond_timedwait(&checkpoint_cond, &wal_mutex, &ts);
+        }
+        int stopping = checkpoint_stop;
+        int due = bytes_since_checkpoint > 0 &&
+                  (stopping || bytes_since_checkpoint >= WAL_CHECKPOINT_BYTES ||
+                   time(NULL) - last_checkpoint >= WAL_CHECKPOINT_INTERVAL);
+        if (due) {
+            pthread_mutex_unlock(&wal_mutex);
+            checkpoint();
+            pthread_mutex_lock(&wal_mutex);
+        }
+        if (stopping) break;
+    }
+    pthread_mutex_unlock(&wal_mutex);
+    return NULL;
+}
+
+int wal_open(const char* dir, WalApplyFn apply, WalSnapshotFn snapshot) {
+    if (wal_running || !dir || !apply || !snapshot) return -1;
+
+    crc32_init();
+    snprintf(wal_dir, sizeof(wal_dir), "%s", dir);
+    if (mkdir(wal_dir, 0700) < 0 && errno != EEXIST) {
+        fprintf(stderr, "[WAL] Cannot create %s: %s\n", wal_dir, strerror(errno));
+        return -1;
+    }
+
+    long first = load_snapshot(apply);
+    if (first < 0) return -1;
+    size_t replayed = 0;
+    long last = replay_segments((unsigned int)first, apply, &replayed);
+    if (last < 0) return -1;
+
+    // Luôn ghi tiếp vào segment mới, segment đã replay giữ nguyên tới checkpoint sau
+    segment = (unsigned int)last + 1;
+    wal_fd = open_segment(segment);
+    if (wal_fd < 0) return -1;
+
+    buffer_init(&pending);
+    appended_lsn = durable_lsn = 0;
+    bytes_since_checkpoint = replayed;  // WAL đã replay sẽ được gộp vào snapshot ở checkpoint sau
+    last_checkpoint = time(NULL);
+    snapshot_fn = snapshot;
+    wal_stop = 0;
+    checkpoint_stop = 0;
+    wal_running = 1;
+
+    if (pthread_create(&flusher_thread, NULL, flusher_main, NULL) != 0) {
+        perror("[WAL] Thread creation failed");
+        close(wal_fd);
+        wal_fd = -1;
+        wal_running = 0;
+        return -1;
+    }
+    if (pthread_create(&checkpointer_thread, NULL, checkpointer_main, NULL) != 0) {
+        perror("[WAL] Thread creation failed");
+        pthread_mutex_lock(&wal_mutex);
+        wal_stop = 1;
+        pthread_cond_signal(&work_cond);
+        pthread_mutex_unlock(&wal_mutex);
+        pthread_join(flusher_thread, NULL);
+        close(wal_fd);
+        wal_fd = -1;
+        wal_running = 0;
+        return -1;
+    }
+    printf("[WAL] Recovered from %s, writing segment %u\n", wal_dir, segment);
+    return 0;
+}
+
+void wal_close(void) {
+    pthread_mutex_lock(&wal_mutex);
+    if (!wal_running) {
+        pthread_mutex_unlock(&wal_mutex);
+        return;
+    }
+    wal_stop = 1;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&wal_mutex);
+    pthread_join(flusher_thread, NULL);
+
+    // Checkpoint cuối => lần khởi động sau không phải replay WAL
+    pthread_mutex_lock(&wal_mutex);
+    checkpoint_stop = 1;
+    pthread_cond_signal(&checkpoint_cond);
+    pthread_mutex_unlock(&wal_mutex);
+    pthread_join(checkpointer_thread, NULL);
+
+    pthread_mutex_lock(&wal_mutex);
+    wal_running = 0;
+    close(wal_fd);
+    wal_fd = -1;
+    buffer_free(&pending);
+    pthread_mutex_unlock(&wal_mutex);
+}
+
+int wal_enabled(void) {
+    return __atomic_load_n(&wal_running, __ATOMIC_ACQUIRE);
+}
+
+unsigned long long wal_append(const Buffer* records) {
+    if (!records || records->len == 0) return 0;
+
+    pthread_mutex_lock(&wal_mutex);
+    if (!wal_running || wal_stop) {
+        pthread_mutex_unlock(&wal_mutex);
+        return 0;
+    }
+    if (buffer_append(&pending, records->data, records->len) < 0) {
+        errno = ENOMEM;
+        wal_fatal("WAL append");
+    }
+    unsigned long long lsn = ++appended_lsn;
+    if (!flushing) pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&wal_mutex);
+    return lsn;
+}
+
+void wal_wait(unsigned long long lsn) {
+    if (lsn == 0) return;
+
+    pthread_mutex_lock(&wal_mutex);
+    while (durable_lsn < lsn) pthread_cond_wait(&durable_cond, &wal_mutex);
+    pthread_mutex_unlock(&wal_mutex);
+}
@@ -0,0 +1,70 @@
+#ifndef WAL_H
+#define WAL_H
+
+// =========================================
+// WRITE-AHEAD LOG (embedded backend, make DB_BACKEND=embedded)
+// - Mỗi thay đổi dữ liệu = 1 record, ghi nối tiếp vào segment data/wal.NNNNNNNN
+// - Group commit: thread flusher gom mọi record đang chờ vào 1 lần write + fdatasync,
+//   các thread request chỉ chờ LSN của mình được fsync (wal_wait)
+// - Checkpoint định kỳ (thread riêng): ghi toàn bộ trạng thái ra data/snapshot, xóa các segment cũ
+// - Khởi động: nạp snapshot rồi replay các segment sau nó (bỏ đuôi ghi dở của segment cuối)
+// - Lỗi write/fsync => dừng server (không thể biết dữ liệu nào đã xuống đĩa)
+// Record: [u32 len][u32 crc32][payload]; nội dung payload do backend tự định nghĩa
+// =========================================
+#include "../common/protocol.h"
+#include <stddef.h>
+
+#define WAL_DATA_DIR "data"                          // Thư mục dữ liệu (tương đối với nơi chạy server)
+#define WAL_CHECKPOINT_INTERVAL 300                  // Giây giữa 2 lần checkpoint
+#define WAL_CHECKPOINT_BYTES (64UL * 1024 * 1024)    // Checkpoint sớm khi WAL lớn hơn
+#define WAL_RECORD_HEADER 8
+
+/**
+ * Áp dụng 1 record khi khôi phục (snapshot hoặc WAL)
+ * @return 0 nếu thành công, -1 nếu record không hợp lệ (dừng khôi phục)
+ */
+typedef int (*WalApplyFn)(const unsigned char* rec, size_t len);
+
+/**
+ * Ghi toàn bộ trạng thái vào out (mỗi dòng dữ liệu 1 record) cho checkpoint.
+ * Phải chặn mọi thay đổi của backend trong lúc ghi và gọi wal_rotate() trước khi nhả lock.
+ * @return số segment do wal_rotate() trả về, 0 nếu lỗi
+ */
+typedef unsigned int (*WalSnapshotFn)(Buffer* out);
+
+/**
+ * Chức năng: Khôi phục dữ liệu từ dir rồi mở WAL để ghi tiếp
+ * @return 0 nếu thành công, -1 nếu lỗi (thư mục, file hỏng)
+ */
+int wal_open(const char* dir, WalApplyFn apply, WalSnapshotFn snapshot);
+
+// Checkpoint lần cuối (nếu có thay đổi), fsync rồi dừng thread flusher
+void wal_close(void);
+
+// 1 nếu WAL đang mở (backend cần ghi record)
+int wal_enabled(void);
+
+// Bắt đầu record mới ở cuối b (chừa header), return vị trí bắt đầu
+size_t wal_record_begin(Buffer* b);
+
+// Điền header (độ dài + crc) cho record bắt đầu tại start, return 0 hoặc -1
+int wal_record_end(Buffer* b, size_t start);
+
+/**
+ * Chức năng: Thêm các record đã đóng khung (wal_record_end) vào hàng chờ ghi
+ * Gọi khi đang giữ lock ghi của backend để thứ tự WAL = thứ tự áp dụng
+ * @return LSN để truyền cho wal_wait(), 0 nếu WAL không mở
+ */
+unsigned long long wal_append(const Buffer* records);
+
+// Chờ tới khi mọi record <= lsn đã được fsync (gọi sau khi nhả lock backend)
+void wal_wait(unsigned long long lsn);
+
+/**
+ * Chức năng: Đóng segment hiện tại (ghi + fsync phần còn chờ), mở segment mới
+ * Chỉ gọi từ WalSnapshotFn, khi backend đang chặn mọi thay đổi
+ * @return số segment mới, 0 nếu lỗi
+ */
+unsigned int wal_rotate(void);
+
+#endif // WAL_H
@@ -0,0 +1,301 @@
+#include "write_coalescer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+enum { OP_QUEUED = 0, OP_RUNNING, OP_DONE, OP_SKIPPED };
+
+// 1 lệnh ghi đang chờ (nằm trên stack của thread request)
+typedef struct WriteOp {
+    const char* sql;
+    int nparams;
+    const char* const* params;
+    PGresult* res;
+    int state;
+    struct WriteOp* next;
+} WriteOp;
+
+static pthread_mutex_t wc_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wc_cond = PTHREAD_COND_INITIALIZER;       // Có lệnh mới / dừng
+static pthread_cond_t wc_done_cond = PTHREAD_COND_INITIALIZER;  // Có lô vừa xong
+static WriteOp* queue_head = NULL;
+static WriteOp* queue_tail = NULL;
+static int queue_len = 0;
+static int window_us = WRITE_COALESCE_WINDOW_US;
+static int max_batch = WRITE_COALESCE_MAX_BATCH;
+static int wc_running = 0;
+static int wc_ready = 0;          // Kết nối riêng đang dùng được (0 cả khi lô đang chạy bị treo)
+static int wc_stop = 0;
+static pthread_t wc_thread;
+static char* wc_conninfo = NULL;
+
+static PGconn* coalescer_connect(void) {
+    PGconn* c = PQconnectdb(wc_conninfo);
+    if (PQstatus(c) != CONNECTION_OK) {
+        fprintf(stderr, "[WRITE_COALESCER] Connection failed: %s", PQerrorMessage(c));
+        PQfinish(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void deadline_after_us(struct timespec* ts, long us) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += us / 1000000L;
+    ts->tv_nsec += (us % 1000000L) * 1000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// Chạy lệnh điều khiển transaction (có thể nhiều câu), return 0 nếu thành công
+static int exec_control(PGconn* c, const char* sql) {
+    PGresult* res = PQexec(c, sql);
+    int ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) fprintf(stderr, "[WRITE_COALESCER] %s failed: %s", sql, PQerrorMessage(c));
+    PQclear(res);
+    return ok ? 0 : -1;
+}
+
+static int result_ok(const PGresult* res) {
+    ExecStatusType st = PQresultStatus(res);
+    return st == PGRES_COMMAND_OK || st == PGRES_TUPLES_OK;
+}
+
+// Lô hỏng sau khi đã gửi lệnh: không biết chắc đã ghi hay chưa => mọi lệnh nhận lỗi
+static void fail_batch(PGconn* c, WriteOp* ops) {
+    for (WriteOp* op = ops; op; op = op->next) {
+        PQclear(op->res);
+        op->res = PQmakeEmptyPGresult(c, PGRES_FATAL_ERROR);
+    }
+}
+
+/**
+ * Chạy 1 lô trong 1 transaction
+ * - Mỗi lệnh có savepoint riêng: lỗi thì ROLLBACK TO (savepoint vẫn còn, dùng tiếp cho lệnh sau),
+ *   thành công thì RELEASE + mở savepoint mới trong cùng 1 round trip
+ * - Lô 1 lệnh chạy autocommit luôn, không tốn thêm BEGIN/SAVEPOINT/COMMIT
+ * Không đụng op->state: caller có thể rời hàm ngay khi thấy state đổi
+ * @return OP_DONE nếu mọi lệnh đã có kết quả, OP_SKIPPED nếu chưa lệnh nào được gửi
+ */
+static int run_batch(PGconn* c, WriteOp* ops, int n) {
+    if (n == 1) {
+        ops->res = PQexecParams(c, ops->sql, ops->nparams, NULL, ops->params, NULL, NULL, 0);
+        return OP_DONE;
+    }
+
+    if (exec_control(c, "BEGIN; SAVEPOINT wc") < 0) {
+        // Chưa lệnh nào chạy: trả về cho caller tự chạy autocommit
+        PQclear(PQexec(c, "ROLLBACK"));
+        return OP_SKIPPED;
+    }
+
+    for (WriteOp* op = ops; op; op = op->next) {
+        op->res = PQexecParams(c, op->sql, op->nparams, NULL, op->params, NULL, NULL, 0);
+        if (!op->next) break; // Savepoint của lệnh cuối để COMMIT giải phóng luôn
+
+        const char* next_sql = result_ok(op->res) ? "RELEASE SAVEPOINT wc; SAVEPOINT wc"
+                                                   : "ROLLBACK TO SAVEPOINT wc";
+        if (exec_control(c, next_sql) < 0) {
+            PQclear(PQexec(c, "ROLLBACK"));
+            fail_batch(c, ops);
+            return OP_DONE;
+        }
+    }
+
+    // Lệnh cuối lỗi thì bỏ riêng nó trước khi COMMIT
+    WriteOp* last = ops;
+    while (last->next) last = last->next;
+    if (!result_ok(last->res) && exec_control(c, "ROLLBACK TO SAVEPOINT wc") < 0) {
+        PQclear(PQexec(c, "ROLLBACK"));
+        fail_batch(c, ops);
+        return OP_DONE;
+    }
+
+    // Transaction bị abort thì COMMIT vẫn trả COMMAND_OK nhưng tag là ROLLBACK
+    PGresult* res = PQexec(c, "COMMIT");
+    int committed = PQresultStatus(res) == PGRES_COMMAND_OK && strcmp(PQcmdStatus(res), "COMMIT") == 0;
+    PQclear(res);
+    if (!committed) {
+        fprintf(stderr, "[WRITE_COALESCER] COMMIT of %d writes failed: %s", n, PQerrorMessage(c));
+        fail_batch(c, ops);
+    }
+    return OP_DONE;
+}
+
+// Trả các lệnh chưa gửi về cho caller (gọi khi đang giữ wc_mutex)
+static void skip_queued(void) {
+    for (WriteOp* op = queue_head; op; op = op->next) op->state = OP_SKIPPED;
+    queue_head = queue_tail = NULL;
+    queue_len = 0;
+    pthread_cond_broadcast(&wc_done_cond);
+}
+
+static void* coalescer_main(void* arg) {
+    (void)arg;
+    PGconn* c = NULL;
+    int backoff = 1;
+
+    pthread_mutex_lock(&wc_mutex);
+    while (1) {
+        if (!c) {
+            if (wc_stop) break;
+            pthread_mutex_unlock(&wc_mutex);
+            c = coalescer_connect();
+            pthread_mutex_lock(&wc_mutex);
+            if (!c) {
+                struct timespec ts;
+                deadline_after_us(&ts, backoff * 1000000L);
+                backoff = backoff * 2 > WRITE_COALESCE_MAX_BACKOFF ? WRITE_COALESCE_MAX_BACKOFF : backoff * 2;
+                pthread_cond_timedwait(&wc_cond, &wc_mutex, &ts);
+                continue;
+            }
+            backoff = 1;
+            wc_ready = 1;
+        }
+
+        while (!wc_stop && queue_len == 0) {
+            pthread_cond_wait(&wc_cond, &wc_mutex);
+        }
+        if (queue_len == 0) break; // Dừng và không còn lệnh chờ
+
+        // Chỉ 1 lệnh chờ và không lô nào đang chạy: không có gì để gom, chạy ngay.
+        // Nhiều lệnh dồn lại trong lúc lô trước chạy = đang ghi đồng thời: gom thêm trong cửa sổ
+        if (queue_len > 1) {
+            struct timespec deadline;
+            deadline_after_us(&deadline, window_us);
+            while (!wc_stop && queue_len < max_batch) {
+                if (pthread_cond_timedwait(&wc_cond, &wc_mutex, &deadline) == ETIMEDOUT) break;
+            }
+        }
+
+        // Tách tối đa max_batch lệnh đầu hàng chờ
+        WriteOp* batch = queue_head;
+        WriteOp* tail = batch;
+        int n = 1;
+        while (n < max_batch && tail->next) {
+            tail = tail->next;
+            n++;
+        }
+        queue_head = tail->next;
+        if (!queue_head) queue_tail = NULL;
+        tail->next = NULL;
+        queue_len -= n;
+        for (WriteOp* op = batch; op; op = op->next) op->state = OP_RUNNING;
+        pthread_mutex_unlock(&wc_mutex);
+
+        int state = run_batch(c, batch, n);
+
+        pthread_mutex_lock(&wc_mutex);
+        for (WriteOp* op = batch; op; op = op->next) op->state = state;
+        pthread_cond_broadcast(&wc_done_cond);
+        wc_ready = 1;                   // Hết treo (nếu có); mất kết nối thì tắt lại ngay dưới đây
+
+        if (PQstatus(c) != CONNECTION_OK) {
+            fprintf(stderr, "[WRITE_COALESCER] Connection lost, writes fall back to autocommit\n");
+            PQfinish(c);
+            c = NULL;
+            wc_ready = 0;
+            skip_queued();
+        }
+    }
+    wc_ready = 0;
+    skip_queued();
+    pthread_mutex_unlock(&wc_mutex);
+
+    if (c) PQfinish(c);
+    return NULL;
+}
+
+int write_coalescer_start(const char* conninfo, int window, int batch) {
+    if (wc_running || !conninfo || window <= 0 || batch <= 0) return -1;
+
+    wc_conninfo = strdup(conninfo);
+    if (!wc_conninfo) return -1;
+
+    pthread_mutex_lock(&wc_mutex);
+    queue_head = queue_tail = NULL;
+    queue_len = 0;
+    window_us = window;
+    max_batch = batch;
+    wc_stop = 0;
+    wc_ready = 0;
+    wc_running = 1;
+    pthread_mutex_unlock(&wc_mutex);
+
+    if (pthread_create(&wc_thread, NULL, coalescer_main, NULL) != 0) {
+        perror("[WRITE_COALESCER] Thread creation failed");
+        pthread_mutex_lock(&wc_mutex);
+        wc_running = 0;
+        pthread_mutex_unlock(&wc_mutex);
+        free(wc_conninfo);
+        wc_conninfo = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void write_coalescer_stop(void) {
+    pthread_mutex_lock(&wc_mutex);
+    if (!wc_running) {
+        pthread_mutex_unlock(&wc_mutex);
+        return;
+    }
+    wc_stop = 1;
+    pthread_cond_signal(&wc_cond);
+    pthread_mutex_unlock(&wc_mutex);
+
+    pthread_join(wc_thread, NULL);
+
+    pthread_mutex_lock(&wc_mutex);
+    wc_running = 0;
+    pthread_mutex_unlock(&wc_mutex);
+
+    free(wc_conninfo);
+    wc_conninfo = NULL;
+}
+
+int write_coalescer_exec(const char* sql, int nparams, const char* const* params, PGresult** out) {
+    if (!sql || !out) return -1;
+
+    WriteOp op = { sql, nparams, params, NULL, OP_QUEUED, NULL };
+
+    pthread_mutex_lock(&wc_mutex);
+    if (!wc_running || !wc_ready || wc_stop) {
+        pthread_mutex_unlock(&wc_mutex);
+        return -1;
+    }
+    if (queue_tail) queue_tail->next = &op;
+    else queue_head = &op;
+    queue_tail = &op;
+    queue_len++;
+    // Lệnh đầu tiên đánh thức thread để mở cửa sổ, lô đầy thì chạy ngay
+    if (queue_len == 1 || queue_len >= max_batch) pthread_cond_signal(&wc_cond);
+
+    // Chờ trong hàng quá WRITE_COALESCE_STALL_MS = lô đang chạy bị treo (DB / mạng): trả mọi lệnh
+    // chưa gửi về autocommit (kết nối chính có circuit breaker), lệnh mới không vào hàng chờ tới
+    // khi lô đó xong. Lệnh đã gửi (OP_RUNNING) phải chờ kết quả: giới hạn bởi timeout của kết nối
+    struct timespec deadline;
+    deadline_after_us(&deadline, WRITE_COALESCE_STALL_MS * 1000L);
+    while (op.state == OP_QUEUED) {
+        if (pthread_cond_timedwait(&wc_done_cond, &wc_mutex, &deadline) == ETIMEDOUT &&
+            op.state == OP_QUEUED) {
+            fprintf(stderr, "[WRITE_COALESCER] Batch stalled, %d queued writes fall back to autocommit\n",
+                    queue_len);
+            wc_ready = 0;
+            skip_queued();
+        }
+    }
+    while (op.state == OP_RUNNING) {
+        pthread_cond_wait(&wc_done_cond, &wc_mutex);
+    }
+    pthread_mutex_unlock(&wc_mutex);
+
+    if (op.state == OP_SKIPPED) return -1;
+    *out = op.res;
+    return 0;
+}
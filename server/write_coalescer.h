@@ -0,0 +1,49 @@
+#ifndef WRITE_COALESCER_H
+#define WRITE_COALESCER_H
+
+// =========================================
+// WRITE COALESCER (group commit phía client)
+// Gom các lệnh ghi độc lập của nhiều thread request vào 1 transaction
+// - Thread riêng, kết nối PostgreSQL riêng
+// - Bật bằng write_coalesce=1 trong database.conf (mặc định tắt: mọi lệnh ghi chạy autocommit)
+// - Lệnh ghi đơn lẻ (hàng chờ chỉ có nó, không lô nào đang chạy) chạy ngay, không chờ
+// - Lệnh dồn lại trong lúc lô trước chạy: mở cửa sổ WRITE_COALESCE_WINDOW_US; hết cửa sổ hoặc đủ
+//   WRITE_COALESCE_MAX_BATCH lệnh thì chạy cả lô: BEGIN, mỗi lệnh trong 1 SAVEPOINT, COMMIT
+//   => 1 lần flush WAL của database cho cả lô thay vì 1 lần mỗi lệnh
+// - Lệnh lỗi chỉ rollback savepoint của nó, các lệnh khác trong lô vẫn commit
+// - Mỗi caller nhận lại PGresult của chính lệnh mình, chỉ sau khi COMMIT xong
+// - Chưa chạy / mất kết nối / lô đang chạy treo quá WRITE_COALESCE_STALL_MS: write_coalescer_exec
+//   trả -1 cho lệnh chưa gửi, caller tự chạy autocommit như cũ
+// Chỉ dùng cho lệnh 1 câu SQL, không phụ thuộc kết quả của lệnh khác trong cùng lô
+// =========================================
+#include <libpq-fe.h>
+
+#define WRITE_COALESCE_WINDOW_US 2000     // Thời gian gom tối đa khi có nhiều lệnh ghi đồng thời
+#define WRITE_COALESCE_MAX_BATCH 64       // Số lệnh tối đa mỗi transaction
+#define WRITE_COALESCE_MAX_BACKOFF 30     // Giây
+#define WRITE_COALESCE_STALL_MS 1000      // Lệnh chờ trong hàng lâu hơn => lô đang chạy bị treo
+
+/**
+ * Chức năng: Khởi động thread gom lệnh ghi
+ * @param conninfo   Chuỗi kết nối PostgreSQL (được copy)
+ * @param window_us  Cửa sổ gom (micro giây)
+ * @param max_batch  Số lệnh tối đa mỗi lô
+ * @return 0 nếu thành công, -1 nếu lỗi tạo thread
+ */
+int write_coalescer_start(const char* conninfo, int window_us, int max_batch);
+
+// Chạy nốt các lệnh đang chờ rồi dừng thread
+void write_coalescer_stop(void);
+
+/**
+ * Chức năng: Chạy 1 lệnh ghi trong transaction chung (chặn tới khi lô COMMIT xong)
+ * @param sql      Câu lệnh có tham số $1..$n (như PQexecParams)
+ * @param nparams  Số tham số
+ * @param params   Giá trị tham số (text format, phải còn hợp lệ tới khi hàm trả về)
+ * @param out      Nhận PGresult của lệnh (caller PQclear); COMMIT lỗi => kết quả PGRES_FATAL_ERROR
+ * @return 0 nếu đã chạy qua coalescer, -1 nếu coalescer không sẵn sàng hoặc lệnh bị trả về vì
+ *         lô trước treo (lệnh chưa được gửi, *out không đổi)
+ */
+int write_coalescer_exec(const char* sql, int nparams, const char* const* params, PGresult** out);
+
+#endif // WRITE_COALESCER_H